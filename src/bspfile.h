@@ -12,7 +12,7 @@
 #define MAX_MAP_PLANES 32767
 #define MAX_MAP_NODES 32767     // because negative shorts are contents
 #define MAX_MAP_CLIPNODES 32767 //
-#define MAX_MAP_LEAFS 8192
+#define MAX_MAP_LEAFS 0x40000 // BSP2, version 29 files stop well short of it
 #define MAX_MAP_VERTS 65535
 #define MAX_MAP_FACES 65535
 #define MAX_MAP_MARKSURFACES 65535
@@ -34,6 +34,7 @@
 //=============================================================================
 
 #define BSPVERSION 29
+#define BSP2VERSION ('B' | ('S' << 8) | ('P' << 16) | ('2' << 24))
 #define TOOLVERSION 2
 
 typedef struct
@@ -195,3 +196,52 @@ typedef struct
 
     uint8_t ambient_level[NUM_AMBIENTS];
 } dleaf_t;
+
+// BSP2 keeps the version 29 lumps but widens every index that was 16 bits,
+// and stores node and leaf bounds as floats.  The lumps not listed here are
+// the same in both.
+
+typedef struct
+{
+    int32_t planenum;
+    int32_t children[2]; // negative numbers are -(leafs+1), not nodes
+    float mins[3];
+    float maxs[3];
+    uint32_t firstface;
+    uint32_t numfaces;
+} dl2node_t;
+
+typedef struct
+{
+    int32_t planenum;
+    int32_t children[2]; // negative numbers are contents
+} dlclipnode_t;
+
+typedef struct
+{
+    uint32_t v[2];
+} dledge_t;
+
+typedef struct
+{
+    int32_t planenum;
+    int32_t side;
+    int32_t firstedge;
+    int32_t numedges;
+    int32_t texinfo;
+    uint8_t styles[MAXLIGHTMAPS];
+    int32_t lightofs;
+} dlface_t;
+
+typedef struct
+{
+    int32_t contents;
+    int32_t visofs;
+    float mins[3];
+    float maxs[3];
+    uint32_t firstmarksurface;
+    uint32_t nummarksurfaces;
+    uint8_t ambient_level[NUM_AMBIENTS];
+} dl2leaf_t;
+
+// marksurfaces are uint32_t
@@ -1,71 +1,238 @@
+#include <pthread.h>
+#include <time.h>
 #include <raylib.h>
 #include "quakedef.h"
 
+//
+// Music runs on a thread of its own.  The track's raylib stream is the ring
+// buffer between it and the audio device: the thread keeps it topped up with
+// UpdateMusicStream and the device drains it, so the game thread never
+// decodes.  A new track is opened on the thread as soon as it is asked for,
+// usually by svc_cdtrack during signon, and the old one keeps playing until
+// it is ready.
+//
+#define CD_UPDATE_NSEC (10 * 1000000) // well inside the stream's buffer
+
+static pthread_t cd_thread;
+static pthread_mutex_t cd_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t cd_wake = PTHREAD_COND_INITIALIZER;
+static bool cd_threaded; // false if the thread couldn't start, the game thread services music instead
+
+// requests from the game thread, under cd_lock
+static int32_t cd_wanttrack = -1; // -1 for no change, 0 to stop
+static bool cd_wantloop;
+static bool cd_paused;
+static bool cd_quit;
+static int32_t cd_failedtrack; // reported on the game thread
+
+// only touched by whoever services music
 static Music music = (Music){ 0 };
+static bool music_paused;
+static float music_volume = -1;
 
-int32_t CDAudio_Init(void)
-{
-    return 0;
-}
+/*
+================
+CDAudio_Open
 
-void CDAudio_Play(uint8_t track, bool looping)
+Loading a track reads and scans the whole file, the slow part
+================
+*/
+static void CDAudio_Open(int32_t track, bool looping)
 {
-    if (IsMusicValid(music))
-    {
-        UnloadMusicStream(music);
-    }
-
+    Music next;
     char filename[256];
+
     snprintf(filename, sizeof(filename), "id1/music/%d.mp3", track);
-    
-    music = LoadMusicStream(filename);
+    next = LoadMusicStream(filename);
 
-    if (!IsMusicValid(music))
+    if (!IsMusicValid(next))
     {
-        Con_Printf("Could not load music file: %s\n", filename);
+        pthread_mutex_lock(&cd_lock);
+        cd_failedtrack = track;
+        pthread_mutex_unlock(&cd_lock);
         return;
     }
 
+    if (IsMusicValid(music))
+    {
+        StopMusicStream(music);
+        UnloadMusicStream(music);
+    }
+
+    music = next;
     music.looping = looping;
     PlayMusicStream(music);
+    music_paused = false;
+    music_volume = -1;
 }
 
-void CDAudio_Stop(void)
+/*
+================
+CDAudio_Service
+
+Acts on whatever the game thread asked for and decodes the next stretch
+================
+*/
+static void CDAudio_Service(void)
 {
-    if (IsMusicValid(music))
+    int32_t track;
+    bool looping, paused;
+
+    pthread_mutex_lock(&cd_lock);
+    track = cd_wanttrack;
+    looping = cd_wantloop;
+    cd_wanttrack = -1;
+    pthread_mutex_unlock(&cd_lock);
+
+    if (track == 0 && IsMusicValid(music))
     {
         StopMusicStream(music);
         UnloadMusicStream(music);
         music = (Music){ 0 };
     }
-}
+    else if (track > 0)
+        CDAudio_Open(track, looping);
 
-void CDAudio_Pause(void)
-{
-    if (IsMusicValid(music))
+    if (!IsMusicValid(music))
+        return;
+
+    pthread_mutex_lock(&cd_lock);
+    paused = cd_paused;
+    pthread_mutex_unlock(&cd_lock);
+
+    if (paused != music_paused)
+    {
+        if (paused)
+            PauseMusicStream(music);
+        else
+            ResumeMusicStream(music);
+        music_paused = paused;
+    }
+
+    // a float cvar read across threads is at worst a frame stale
+    if (bgmvolume.value != music_volume)
     {
-        PauseMusicStream(music);
+        music_volume = bgmvolume.value;
+        SetMusicVolume(music, music_volume);
     }
+
+    UpdateMusicStream(music);
 }
 
-void CDAudio_Resume(void)
+/*
+================
+CDAudio_Thread
+================
+*/
+static void *CDAudio_Thread(void *unused)
 {
-    if (IsMusicValid(music))
+    struct timespec ts;
+
+    pthread_mutex_lock(&cd_lock);
+    while (!cd_quit)
     {
-        ResumeMusicStream(music);
+        pthread_mutex_unlock(&cd_lock);
+        CDAudio_Service();
+        pthread_mutex_lock(&cd_lock);
+
+        if (cd_quit || cd_wanttrack != -1)
+            continue;
+
+        clock_gettime(CLOCK_REALTIME, &ts);
+        ts.tv_nsec += CD_UPDATE_NSEC;
+        if (ts.tv_nsec >= 1000000000)
+        {
+            ts.tv_sec++;
+            ts.tv_nsec -= 1000000000;
+        }
+        pthread_cond_timedwait(&cd_wake, &cd_lock, &ts);
     }
+    pthread_mutex_unlock(&cd_lock);
+
+    return NULL;
 }
 
-void CDAudio_Shutdown(void)
+/*
+================
+CDAudio_Request
+================
+*/
+static void CDAudio_Request(int32_t track, bool looping)
 {
-    CDAudio_Stop();
+    pthread_mutex_lock(&cd_lock);
+    cd_wanttrack = track;
+    cd_wantloop = looping;
+    cd_paused = false;
+    pthread_cond_signal(&cd_wake);
+    pthread_mutex_unlock(&cd_lock);
 }
 
-void CDAudio_Update(void)
+int32_t CDAudio_Init(void)
 {
+    cd_threaded = !pthread_create(&cd_thread, NULL, CDAudio_Thread, NULL);
+    if (!cd_threaded)
+        Con_Printf("CDAudio_Init: no music thread, decoding on the game thread\n");
+
+    return 0;
+}
+
+void CDAudio_Play(uint8_t track, bool looping)
+{
+    Prof_Mark("music", "id1/music/%d.mp3", track);
+    CDAudio_Request(track, looping);
+}
+
+void CDAudio_Stop(void)
+{
+    CDAudio_Request(0, false);
+}
+
+void CDAudio_Pause(void)
+{
+    pthread_mutex_lock(&cd_lock);
+    cd_paused = true;
+    pthread_mutex_unlock(&cd_lock);
+}
+
+void CDAudio_Resume(void)
+{
+    pthread_mutex_lock(&cd_lock);
+    cd_paused = false;
+    pthread_mutex_unlock(&cd_lock);
+}
+
+void CDAudio_Shutdown(void)
+{
+    if (cd_threaded)
+    {
+        pthread_mutex_lock(&cd_lock);
+        cd_quit = true;
+        pthread_cond_signal(&cd_wake);
+        pthread_mutex_unlock(&cd_lock);
+        pthread_join(cd_thread, NULL);
+        cd_threaded = false;
+    }
+
     if (IsMusicValid(music))
     {
-        UpdateMusicStream(music);
-        SetMusicVolume(music, bgmvolume.value);
+        StopMusicStream(music);
+        UnloadMusicStream(music);
+        music = (Music){ 0 };
     }
 }
+
+void CDAudio_Update(void)
+{
+    int32_t failed;
+
+    pthread_mutex_lock(&cd_lock);
+    failed = cd_failedtrack;
+    cd_failedtrack = 0;
+    pthread_mutex_unlock(&cd_lock);
+
+    if (failed)
+        Con_Printf("Could not load music file: id1/music/%d.mp3\n", failed);
+
+    if (!cd_threaded)
+        CDAudio_Service();
+}
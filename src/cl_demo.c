@@ -2,6 +2,34 @@
 
 static void CL_FinishTimeDemo(void);
 
+cvar_t bench_baseline = {"bench_baseline", ""};   // results file to compare against
+cvar_t bench_threshold = {"bench_threshold", "5"}; // percent slower that counts as a regression
+
+#define MAX_BENCH_DEMOS 16
+#define MAX_BENCH_RUNS 32
+
+typedef struct
+{
+    int32_t frames;
+    double time;
+    float mean, median, p95, p99, low1; // all in frames per second
+} benchstats_t;
+
+static float *td_times; // seconds per frame of the timedemo, pooled over benchmark runs
+static int32_t td_numtimes, td_maxtimes;
+static double td_lastrealtime;
+static char td_name[MAX_QPATH];
+
+static struct
+{
+    bool active;
+    int32_t runs, run;
+    int32_t numdemos, demo;
+    char demos[MAX_BENCH_DEMOS][MAX_QPATH];
+    float runfps[MAX_BENCH_DEMOS][MAX_BENCH_RUNS];
+    benchstats_t stats[MAX_BENCH_DEMOS];
+} bench;
+
 /*
 ==============================================================================
 
@@ -60,6 +88,27 @@ static void CL_WriteDemoMessage(void)
     fflush(cls.demofile);
 }
 
+/*
+====================
+CL_TimeDemoFrame
+====================
+*/
+static void CL_TimeDemoFrame(float time)
+{
+    float *times;
+
+    if (td_numtimes == td_maxtimes)
+    {
+        times = realloc(td_times, (td_maxtimes + 4096) * sizeof(*td_times));
+        if (!times)
+            return;
+        td_times = times;
+        td_maxtimes += 4096;
+    }
+
+    td_times[td_numtimes++] = time;
+}
+
 /*
 ====================
 CL_GetMessage
@@ -86,6 +135,9 @@ int32_t CL_GetMessage(void)
                 // so the bogus time on the first frame doesn't count
                 if (host_framecount == cls.td_startframe + 1)
                     cls.td_starttime = realtime;
+                else if (host_framecount > cls.td_startframe + 1)
+                    CL_TimeDemoFrame(realtime - td_lastrealtime);
+                td_lastrealtime = realtime;
             }
             else if (/* cl.time > 0 && */ cl.time <= cl.mtime[0])
             {
@@ -295,6 +347,218 @@ void CL_PlayDemo_f(void)
     //	fscanf (cls.demofile, "%i\n", &cls.forcetrack);
 }
 
+/*
+====================
+CL_TimeDemoStats
+
+Sorts the frame times and reduces them to frame rates
+====================
+*/
+static int CL_CompareTimes(const void *a, const void *b)
+{
+    float fa = *(const float *)a, fb = *(const float *)b;
+
+    return (fa > fb) - (fa < fb);
+}
+
+static float CL_FPS(double time)
+{
+    return time > 0 ? 1.0 / time : 0;
+}
+
+static void CL_TimeDemoStats(benchstats_t *st)
+{
+    int32_t i, n, slow;
+    double total, worst;
+
+    memset(st, 0, sizeof(*st));
+    n = td_numtimes;
+    if (!n)
+        return;
+
+    qsort(td_times, n, sizeof(*td_times), CL_CompareTimes);
+
+    for (i = 0, total = 0; i < n; i++)
+        total += td_times[i];
+
+    // the 1% low is the average rate over the slowest 1% of frames
+    slow = n / 100;
+    if (slow < 1)
+        slow = 1;
+    for (i = n - slow, worst = 0; i < n; i++)
+        worst += td_times[i];
+
+    st->frames = n;
+    st->time = total;
+    st->mean = n / total;
+    st->median = CL_FPS(td_times[n / 2]);
+    st->p95 = CL_FPS(td_times[(int32_t)(n * 0.95)]);
+    st->p99 = CL_FPS(td_times[(int32_t)(n * 0.99)]);
+    st->low1 = slow / worst;
+}
+
+static void CL_PrintTimeDemoStats(char *name, benchstats_t *st)
+{
+    Con_Printf("%s: %5.1f mean %5.1f median %5.1f p95 %5.1f p99 %5.1f 1%% low\n", name, st->mean, st->median,
+               st->p95, st->p99, st->low1);
+}
+
+/*
+====================
+CL_BaselineValue
+
+Finds field for demo name in a results file written by CL_WriteBenchmark
+====================
+*/
+static float CL_BaselineValue(char *data, char *name, char *field)
+{
+    char *p, *end;
+    char key[MAX_QPATH + 16];
+
+    snprintf(key, sizeof(key), "\"name\":\"%s\"", name);
+    p = strstr(data, key);
+    if (!p)
+        return -1;
+
+    // stay within this demo's object
+    end = strchr(p, '}');
+    snprintf(key, sizeof(key), "\"%s\":", field);
+    p = strstr(p, key);
+    if (!p || (end && p > end))
+        return -1;
+
+    return strtof(p + strlen(key), NULL);
+}
+
+/*
+====================
+CL_CompareBenchmark
+
+Returns true if any demo is slower than the baseline by more than
+bench_threshold percent
+====================
+*/
+static bool CL_CompareBenchmark(void)
+{
+    FILE *f;
+    char *data;
+    long len;
+    int32_t i;
+    float base, cur, limit;
+    bool regressed;
+    static char *fields[] = {"mean_fps", "low1_fps"};
+    int32_t j;
+
+    f = fopen(bench_baseline.string, "rb");
+    if (!f)
+    {
+        Con_Printf("Couldn't read baseline %s\n", bench_baseline.string);
+        return true;
+    }
+
+    fseek(f, 0, SEEK_END);
+    len = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    data = malloc(len + 1);
+    if (!data || fread(data, 1, len, f) != (size_t)len)
+    {
+        fclose(f);
+        free(data);
+        Con_Printf("Couldn't read baseline %s\n", bench_baseline.string);
+        return true;
+    }
+    data[len] = 0;
+    fclose(f);
+
+    regressed = false;
+    limit = 1 - bench_threshold.value / 100;
+
+    for (i = 0; i < bench.numdemos; i++)
+    {
+        for (j = 0; j < 2; j++)
+        {
+            base = CL_BaselineValue(data, bench.demos[i], fields[j]);
+            if (base <= 0)
+            {
+                Con_Printf("%s: no %s in baseline\n", bench.demos[i], fields[j]);
+                continue;
+            }
+
+            cur = j ? bench.stats[i].low1 : bench.stats[i].mean;
+            Con_Printf("%s %s: %5.1f -> %5.1f (%+.1f%%)%s\n", bench.demos[i], fields[j], base, cur,
+                       (cur - base) * 100 / base, cur < base * limit ? " REGRESSION" : "");
+            if (cur < base * limit)
+                regressed = true;
+        }
+    }
+
+    free(data);
+    return regressed;
+}
+
+/*
+====================
+CL_WriteBenchmark
+====================
+*/
+static void CL_WriteBenchmark(void)
+{
+    FILE *f;
+    int32_t i, j;
+    benchstats_t *st;
+    char name[MAX_OSPATH];
+
+    snprintf(name, sizeof(name), "%s/benchmark.json", com_gamedir);
+    f = fopen(name, "w");
+    if (!f)
+    {
+        Con_Printf("Couldn't write benchmark.json\n");
+        return;
+    }
+
+    fprintf(f, "{\"runs\":%d,\"demos\":[\n", bench.runs);
+    for (i = 0; i < bench.numdemos; i++)
+    {
+        st = &bench.stats[i];
+        fprintf(f,
+                "{\"name\":\"%s\",\"frames\":%d,\"seconds\":%.3f,\"mean_fps\":%.2f,\"median_fps\":%.2f,"
+                "\"p95_fps\":%.2f,\"p99_fps\":%.2f,\"low1_fps\":%.2f,\"run_fps\":[",
+                bench.demos[i], st->frames, st->time, st->mean, st->median, st->p95, st->p99, st->low1);
+        for (j = 0; j < bench.runs; j++)
+            fprintf(f, "%s%.2f", j ? "," : "", bench.runfps[i][j]);
+        fprintf(f, "]}%s\n", i < bench.numdemos - 1 ? "," : "");
+    }
+    fprintf(f, "]}\n");
+    fclose(f);
+
+    Con_Printf("Wrote benchmark.json\n");
+}
+
+/*
+====================
+CL_FinishBenchmark
+====================
+*/
+static void CL_FinishBenchmark(void)
+{
+    bool regressed;
+    int32_t i;
+
+    bench.active = false;
+
+    Con_Printf("\nbenchmark, %d runs of each demo:\n", bench.runs);
+    for (i = 0; i < bench.numdemos; i++)
+        CL_PrintTimeDemoStats(bench.demos[i], &bench.stats[i]);
+
+    CL_WriteBenchmark();
+
+    regressed = false;
+    if (bench_baseline.string[0])
+        regressed = CL_CompareBenchmark();
+
+    Sys_Exit(regressed ? 1 : 0);
+}
+
 /*
 ====================
 CL_FinishTimeDemo
@@ -305,6 +569,7 @@ static void CL_FinishTimeDemo(void)
 {
     int32_t frames;
     float time;
+    benchstats_t st;
 
     cls.timedemo = false;
 
@@ -314,7 +579,29 @@ static void CL_FinishTimeDemo(void)
     if (!time)
         time = 1;
     Con_Printf("%i frames %5.1f seconds %5.1f fps\n", frames, time, frames / time);
-    Sys_Quit();
+    HWPerf_TimeDemoSummary();
+
+    if (!bench.active)
+    {
+        CL_TimeDemoStats(&st);
+        CL_PrintTimeDemoStats(td_name, &st);
+        Sys_Quit();
+    }
+
+    bench.runfps[bench.demo][bench.run] = frames / time;
+    if (++bench.run == bench.runs)
+    {
+        // every run of this demo is pooled into td_times
+        CL_TimeDemoStats(&bench.stats[bench.demo]);
+        bench.run = 0;
+        if (++bench.demo == bench.numdemos)
+        {
+            CL_FinishBenchmark();
+            return;
+        }
+    }
+
+    Cbuf_AddText(va("timedemo %s\n", bench.demos[bench.demo]));
 }
 
 /*
@@ -337,10 +624,60 @@ void CL_TimeDemo_f(void)
 
     CL_PlayDemo_f();
 
+    if (bench.active && !cls.demoplayback)
+    {
+        Con_Printf("benchmark: couldn't play %s\n", Cmd_Argv(1));
+        Sys_Exit(2);
+    }
+
     // cls.td_starttime will be grabbed at the second frame of the demo, so
     // all the loading time doesn't get counted
 
     cls.timedemo = true;
+    HWPerf_ResetTotals();
+    snprintf(td_name, sizeof(td_name), "%s", Cmd_Argv(1));
     cls.td_startframe = host_framecount;
     cls.td_lastframe = -1; // get a new message this frame
+
+    // benchmark runs of the same demo share their frame times
+    if (!bench.active || !bench.run)
+        td_numtimes = 0;
+}
+
+/*
+====================
+CL_Benchmark_f
+
+benchmark <runs> <demoname> [demoname...]
+
+Timedemos every demo runs times, writes benchmark.json to the game
+directory and, if bench_baseline names an earlier results file, exits with
+a non-zero status when a demo has become slower than bench_threshold allows
+====================
+*/
+void CL_Benchmark_f(void)
+{
+    int32_t i;
+
+    if (cmd_source != src_command)
+        return;
+
+    if (Cmd_Argc() < 3)
+    {
+        Con_Printf("benchmark <runs> <demoname> [demoname...] : timedemo each demo several times\n");
+        return;
+    }
+
+    memset(&bench, 0, sizeof(bench));
+    bench.runs = (int32_t)strtol(Cmd_Argv(1), NULL, 0);
+    if (bench.runs < 1)
+        bench.runs = 1;
+    if (bench.runs > MAX_BENCH_RUNS)
+        bench.runs = MAX_BENCH_RUNS;
+
+    for (i = 2; i < Cmd_Argc() && bench.numdemos < MAX_BENCH_DEMOS; i++)
+        snprintf(bench.demos[bench.numdemos++], MAX_QPATH, "%s", Cmd_Argv(i));
+
+    bench.active = true;
+    Cbuf_AddText(va("timedemo %s\n", bench.demos[0]));
 }
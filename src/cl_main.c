@@ -11,6 +11,7 @@ cvar_t cl_color = {"_cl_color", "0", true};
 
 cvar_t cl_shownet = {"cl_shownet", "0"}; // can be 0, 1, or 2
 cvar_t cl_nolerp = {"cl_nolerp", "0"};
+cvar_t cl_cmdrate = {"cl_cmdrate", "72", true}; // moves sent per second to a remote server
 
 cvar_t lookspring = {"lookspring", "0", true};
 cvar_t lookstrafe = {"lookstrafe", "0", true};
@@ -80,6 +81,7 @@ void CL_Disconnect(void)
 {
     // stop sounds (especially looping!)
     S_StopAllSounds(true);
+    S_ClearPrecache();
 
     // bring the console down and fade the colors back to normal
     //	SCR_BringDownConsole ();
@@ -369,7 +371,7 @@ static float CL_LerpPoint(void)
 
     f = cl.mtime[0] - cl.mtime[1];
 
-    if (!f || cl_nolerp.value || cls.timedemo || sv.active)
+    if (!f || cl_nolerp.value || cls.timedemo || (sv.active && !host_fixedtick))
     {
         cl.time = cl.mtime[0];
         return 1;
@@ -607,6 +609,35 @@ int32_t CL_ReadFromServer(void)
     return 0;
 }
 
+static usercmd_t cl_basecmd;  // keyboard movement, as of the latest frame
+static usercmd_t cl_mousecmd; // mouse movement summed since the last send
+
+/*
+=================
+CL_AccumulateCmd
+
+Called every frame so the view turns at the frame rate, even when moves
+are sent less often
+=================
+*/
+void CL_AccumulateCmd(void)
+{
+    usercmd_t mouse;
+
+    if (cls.state != ca_connected || cls.signon != SIGNONS)
+        return;
+
+    // get basic movement from keyboard
+    CL_BaseMove(&cl_basecmd);
+
+    // allow mice or other external controllers to add to the move
+    memset(&mouse, 0, sizeof(mouse));
+    IN_Move(&mouse);
+    cl_mousecmd.forwardmove += mouse.forwardmove;
+    cl_mousecmd.sidemove += mouse.sidemove;
+    cl_mousecmd.upmove += mouse.upmove;
+}
+
 /*
 =================
 CL_SendCmd
@@ -621,11 +652,11 @@ void CL_SendCmd(void)
 
     if (cls.signon == SIGNONS)
     {
-        // get basic movement from keyboard
-        CL_BaseMove(&cmd);
-
-        // allow mice or other external controllers to add to the move
-        IN_Move(&cmd);
+        cmd = cl_basecmd;
+        cmd.forwardmove += cl_mousecmd.forwardmove;
+        cmd.sidemove += cl_mousecmd.sidemove;
+        cmd.upmove += cl_mousecmd.upmove;
+        memset(&cl_mousecmd, 0, sizeof(cl_mousecmd));
 
         // send the unreliable message
         CL_SendMove(&cmd);
@@ -680,6 +711,9 @@ void CL_Init(void)
     Cvar_RegisterVariable(&cl_anglespeedkey);
     Cvar_RegisterVariable(&cl_shownet);
     Cvar_RegisterVariable(&cl_nolerp);
+    Cvar_RegisterVariable(&cl_cmdrate);
+    Cvar_RegisterVariable(&bench_baseline);
+    Cvar_RegisterVariable(&bench_threshold);
     Cvar_RegisterVariable(&lookspring);
     Cvar_RegisterVariable(&lookstrafe);
     Cvar_RegisterVariable(&sensitivity);
@@ -697,4 +731,5 @@ void CL_Init(void)
     Cmd_AddCommand("stop", CL_Stop_f);
     Cmd_AddCommand("playdemo", CL_PlayDemo_f);
     Cmd_AddCommand("timedemo", CL_TimeDemo_f);
+    Cmd_AddCommand("benchmark", CL_Benchmark_f);
 }
@@ -174,12 +174,15 @@ static void CL_ParseServerInfo(void)
     int32_t nummodels, numsounds;
     char model_precache[MAX_MODELS][MAX_QPATH];
     char sound_precache[MAX_SOUNDS][MAX_QPATH];
+    double start, prefetchtime, modeltime, soundtime, decodetime;
 
     Con_DPrintf("Serverinfo packet received.\n");
     //
     // wipe the client_state_t struct
     //
     CL_ClearState();
+    if (!sv.active)
+        Memory_BeginMap(); // a local server began it before spawning
 
     // parse protocol version number
     i = MSG_ReadLong();
@@ -230,6 +233,8 @@ static void CL_ParseServerInfo(void)
         }
         strcpy(model_precache[nummodels], str);
         Mod_TouchModel(str);
+        if (str[0] != '*')
+            COM_Prefetch(str);
     }
 
     // precache sounds
@@ -246,12 +251,19 @@ static void CL_ParseServerInfo(void)
         }
         strcpy(sound_precache[numsounds], str);
         S_TouchSound(str);
+        COM_Prefetch(va("sound/%s", str));
     }
 
     //
-    // now we try to load everything else until a cache allocation fails
+    // now we try to load everything else until a cache allocation fails.
+    // The files were being read in on the workers while the lists were
+    // parsed, parsing them into the hunk and cache stays on this thread.
     //
+    start = Sys_FloatTime();
+    COM_PrefetchWait();
+    prefetchtime = Sys_FloatTime() - start;
 
+    start = Sys_FloatTime();
     for (i = 1; i < nummodels; i++)
     {
         cl.model_precache[i] = Mod_ForName(model_precache[i], false);
@@ -262,14 +274,25 @@ static void CL_ParseServerInfo(void)
         }
         CL_KeepaliveMessage();
     }
+    modeltime = Sys_FloatTime() - start;
 
+    // resampling of sounds in paks waits for S_EndPrecaching to fan out
+    start = Sys_FloatTime();
     S_BeginPrecaching();
     for (i = 1; i < numsounds; i++)
     {
         cl.sound_precache[i] = S_PrecacheSound(sound_precache[i]);
         CL_KeepaliveMessage();
     }
+    soundtime = Sys_FloatTime() - start;
+
+    start = Sys_FloatTime();
     S_EndPrecaching();
+    decodetime = Sys_FloatTime() - start;
+
+    Con_DPrintf("precache: read %.1f ms, %i models %.1f ms, %i sounds %.1f ms + %.1f ms resampling\n",
+                prefetchtime * 1000, nummodels - 1, modeltime * 1000, numsounds - 1, soundtime * 1000,
+                decodetime * 1000);
 
     // local state
     cl_entities[0].model = cl.worldmodel = cl.model_precache[1];
@@ -278,6 +301,8 @@ static void CL_ParseServerInfo(void)
 
     Hunk_Check(); // make sure nothing is hurt
 
+    Memory_MapReport(true, cl.worldmodel->name);
+
     noclip_anglehack = false; // noclip is turned off at start
 }
 
@@ -867,6 +892,7 @@ void CL_ParseServerMessage(void)
         case svc_cdtrack:
             cl.cdtrack = MSG_ReadByte();
             cl.looptrack = MSG_ReadByte();
+            // only queued here, the track is opened on the music thread while signon goes on
             if ((cls.demoplayback || cls.demorecording) && (cls.forcetrack != -1))
                 CDAudio_Play((uint8_t)cls.forcetrack, true);
             else
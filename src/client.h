@@ -222,6 +222,7 @@ extern cvar_t cl_autofire;
 
 extern cvar_t cl_shownet;
 extern cvar_t cl_nolerp;
+extern cvar_t cl_cmdrate;
 
 extern cvar_t cl_pitchdriftspeed;
 extern cvar_t lookspring;
@@ -285,6 +286,7 @@ extern kbutton_t in_strafe;
 extern kbutton_t in_speed;
 
 void CL_InitInput(void);
+void CL_AccumulateCmd(void);
 void CL_SendCmd(void);
 void CL_SendMove(usercmd_t *cmd);
 
@@ -310,6 +312,10 @@ void CL_Stop_f(void);
 void CL_Record_f(void);
 void CL_PlayDemo_f(void);
 void CL_TimeDemo_f(void);
+void CL_Benchmark_f(void);
+
+extern cvar_t bench_baseline;
+extern cvar_t bench_threshold;
 
 //
 // cl_parse.c
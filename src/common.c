@@ -395,6 +395,23 @@ void SZ_Print(sizebuf_t *buf, char *data)
 
 //============================================================================
 
+/*
+============
+COM_HashName
+
+FNV-1a, used to index file and lump names
+============
+*/
+uint32_t COM_HashName(char *name)
+{
+    uint32_t h;
+
+    for (h = 2166136261u; *name; name++)
+        h = (h ^ (uint8_t)*name) * 16777619u;
+
+    return h;
+}
+
 /*
 ============
 COM_SkipPath
@@ -585,6 +602,7 @@ int32_t COM_CheckParm(char *parm)
 
 
 static void COM_Path_f(void);
+static void COM_Benchmark_f(void);
 
 /*
 ================
@@ -662,6 +680,7 @@ void COM_Init(char *basedir)
     Cvar_RegisterVariable(&registered);
     Cvar_RegisterVariable(&cmdline);
     Cmd_AddCommand("path", COM_Path_f);
+    Cmd_AddCommand("fs_benchmark", COM_Benchmark_f);
 
     COM_InitFilesystem();
 }
@@ -705,6 +724,9 @@ typedef struct
 {
     char name[MAX_QPATH];
     int32_t filepos, filelen;
+    int32_t complen; // bytes taken in the pak, only differs from filelen when deflated
+    bool deflated;   // a pk3 entry that has to be inflated, never viewed in place
+    uint32_t crc;    // of the inflated data
 } packfile_t;
 
 typedef struct pack_s
@@ -713,6 +735,7 @@ typedef struct pack_s
     int32_t handle;
     int32_t numfiles;
     packfile_t *files;
+    uint8_t *base; // the whole pak mapped read-only, NULL if it couldn't be
 } pack_t;
 
 //
@@ -745,6 +768,106 @@ typedef struct searchpath_s
 
 static searchpath_t *com_searchpaths;
 
+static uint8_t *com_view; // the file COM_FindFile found, if it is in a mapped pak
+static int32_t com_filepos; // where in the handle it starts
+static pack_t *com_filepack; // the pak it is in, if any
+static packfile_t *com_deflated; // its entry when it has to be inflated first
+static int32_t com_filetime;     // a loose file's modification time
+
+//
+// every pak entry by name, pointing at the highest priority pak holding it
+//
+#define FILEINDEX_BUCKETS 4096 // must be a power of two
+
+typedef struct fileindex_s
+{
+    uint32_t hash;
+    packfile_t *file;
+    searchpath_t *search;
+    struct fileindex_s *next;
+} fileindex_t;
+
+static fileindex_t *com_fileindex[FILEINDEX_BUCKETS];
+static int32_t com_numindexed;
+
+/*
+============
+COM_IndexLookup
+============
+*/
+static fileindex_t *COM_IndexLookup(char *filename, uint32_t hash)
+{
+    fileindex_t *ent;
+
+    for (ent = com_fileindex[hash & (FILEINDEX_BUCKETS - 1)]; ent; ent = ent->next)
+        if (ent->hash == hash && !strcmp(ent->file->name, filename))
+            return ent;
+
+    return NULL;
+}
+
+/*
+============
+COM_IndexPack
+
+Adds the entries of a pak that was just put at the head of the search path,
+so it outranks everything already indexed
+============
+*/
+static void COM_IndexPack(searchpath_t *search)
+{
+    int32_t i;
+    uint32_t hash;
+    pack_t *pak;
+    fileindex_t *ent, *entries;
+
+    pak = search->pack;
+    entries = Hunk_AllocName(pak->numfiles * sizeof(fileindex_t), "fileindex");
+
+    for (i = 0; i < pak->numfiles; i++)
+    {
+        hash = COM_HashName(pak->files[i].name);
+        ent = COM_IndexLookup(pak->files[i].name, hash);
+        if (ent)
+        {
+            // a name repeated inside one pak resolves to its first entry
+            if (ent->search != search)
+            {
+                ent->file = &pak->files[i];
+                ent->search = search;
+            }
+            continue;
+        }
+
+        ent = &entries[i];
+        ent->hash = hash;
+        ent->file = &pak->files[i];
+        ent->search = search;
+        ent->next = com_fileindex[hash & (FILEINDEX_BUCKETS - 1)];
+        com_fileindex[hash & (FILEINDEX_BUCKETS - 1)] = ent;
+        com_numindexed++;
+    }
+}
+
+/*
+============
+COM_FindInPack
+
+The lookup the index replaces, still used when the search doesn't start at
+the head of the path
+============
+*/
+static packfile_t *COM_FindInPack(pack_t *pak, char *filename)
+{
+    int32_t i;
+
+    for (i = 0; i < pak->numfiles; i++)
+        if (!strcmp(pak->files[i].name, filename))
+            return &pak->files[i];
+
+    return NULL;
+}
+
 /*
 ============
 COM_Path_f
@@ -767,6 +890,64 @@ static void COM_Path_f(void)
     }
 }
 
+/*
+============
+COM_Benchmark_f
+
+fs_benchmark [passes], looks up every pak entry and wad lump by scanning and
+through the index.  Loose file stats are left out since both paths make them.
+============
+*/
+static void COM_Benchmark_f(void)
+{
+    int32_t i, pass, passes, n;
+    fileindex_t *ent;
+    searchpath_t *s;
+    char **names;
+    double start, linear, hashed;
+    int32_t found;
+
+    passes = Cmd_Argc() > 1 ? (int32_t)strtol(Cmd_Argv(1), NULL, 0) : 20;
+    if (passes < 1)
+        passes = 1;
+
+    if (!com_numindexed)
+    {
+        Con_Printf("No pak files are mounted\n");
+        W_Benchmark(passes);
+        return;
+    }
+
+    names = Hunk_TempAlloc(com_numindexed * sizeof(*names));
+    for (i = n = 0; i < FILEINDEX_BUCKETS; i++)
+        for (ent = com_fileindex[i]; ent; ent = ent->next)
+            names[n++] = ent->file->name;
+
+    found = 0;
+    start = Sys_FloatTime();
+    for (pass = 0; pass < passes; pass++)
+        for (i = 0; i < n; i++)
+            for (s = com_searchpaths; s; s = s->next)
+                if (s->pack && COM_FindInPack(s->pack, names[i]))
+                {
+                    found++;
+                    break;
+                }
+    linear = Sys_FloatTime() - start;
+
+    start = Sys_FloatTime();
+    for (pass = 0; pass < passes; pass++)
+        for (i = 0; i < n; i++)
+            if (COM_IndexLookup(names[i], COM_HashName(names[i])))
+                found++;
+    hashed = Sys_FloatTime() - start;
+
+    Con_Printf("%i pak entries, %i passes, %i found\n", n, passes, found);
+    Con_Printf("scan  %10.0f lookups/sec\n", n * passes / (linear > 0 ? linear : 1e-9));
+    Con_Printf("index %10.0f lookups/sec\n", n * passes / (hashed > 0 ? hashed : 1e-9));
+    W_Benchmark(passes);
+}
+
 /*
 ============
 COM_WriteFile
@@ -848,20 +1029,221 @@ static void COM_CopyFile(char *netpath, char *cachepath)
     Sys_FileClose(out);
 }
 
+/*
+=============================================================================
+
+INFLATED FILES
+
+A deflated pk3 entry is inflated whole into a small cache the first time it
+is wanted, on the worker pool when its pk3 is mapped.  A prefetch or an async
+load starts the inflate and the entry is kept until it is used, a plain open
+waits for it.  Without the mapping the worker reads the compressed data in
+first.  Callers only ever get copies, as the cache may drop an entry
+at the next open.
+
+=============================================================================
+*/
+#define MAX_INFLATED 64
+#define INFLATED_BYTES (32 * 1024 * 1024) // the cache drops old entries to stay under this
+
+typedef struct
+{
+    packfile_t *file; // NULL for a free entry
+    uint8_t *in;      // the compressed data
+    pack_t *readpak;  // set when in is a copy the worker reads from this pack
+    uint8_t *data;
+    bool ok;      // inflated to the right size and crc
+    bool pending; // a worker may still be inflating it
+    bool fresh;   // started ahead of use, kept until it is opened
+    bool held;    // an async load is waiting on it
+    int32_t lastused;
+    taskgroup_t group;
+} inflated_t;
+
+static inflated_t com_inflated[MAX_INFLATED];
+static int32_t com_inflatedbytes;
+static int32_t com_inflatetime;
+
+/*
+============
+COM_InflateTask
+
+Runs on a worker
+============
+*/
+static void COM_InflateTask(void *data)
+{
+    inflated_t *e;
+    packfile_t *f;
+
+    e = data;
+    f = e->file;
+    if (e->readpak && Sys_FileReadAt(e->readpak->handle, f->filepos, e->in, f->complen) != f->complen)
+    {
+        e->ok = false;
+        return;
+    }
+    e->ok = Inflate(e->in, f->complen, e->data, f->filelen) == f->filelen &&
+            CRC32_Block(0, e->data, f->filelen) == f->crc;
+}
+
+/*
+============
+COM_InflateFinish
+============
+*/
+static void COM_InflateFinish(inflated_t *e)
+{
+    if (!e->pending)
+        return;
+    Task_Wait(&e->group);
+    e->pending = false;
+    if (e->readpak)
+    {
+        free(e->in);
+        e->readpak = NULL;
+    }
+    e->in = NULL;
+}
+
+/*
+============
+COM_InflateWaitAll
+============
+*/
+static void COM_InflateWaitAll(void)
+{
+    inflated_t *e;
+
+    for (e = com_inflated; e < com_inflated + MAX_INFLATED; e++)
+        COM_InflateFinish(e);
+}
+
+/*
+============
+COM_InflateOldest
+
+The least recently used entry that can be dropped, NULL if none can
+============
+*/
+static inflated_t *COM_InflateOldest(bool keepfresh)
+{
+    inflated_t *e, *best;
+
+    best = NULL;
+    for (e = com_inflated; e < com_inflated + MAX_INFLATED; e++)
+    {
+        if (!e->file || e->held || (keepfresh && e->fresh))
+            continue;
+        if (e->pending && !Task_Done(&e->group))
+            continue;
+        if (!best || e->lastused < best->lastused)
+            best = e;
+    }
+
+    return best;
+}
+
+/*
+============
+COM_InflateDrop
+============
+*/
+static void COM_InflateDrop(inflated_t *e)
+{
+    COM_InflateFinish(e);
+    com_inflatedbytes -= e->file->filelen;
+    free(e->data);
+    e->data = NULL;
+    e->file = NULL;
+}
+
+/*
+============
+COM_InflateStart
+
+Finds or starts the inflate of a deflated entry.  Started ahead of use, it
+won't push out other entries started ahead of use.  Without wait it gives up
+when no finished entry can be dropped, otherwise it waits for room.  NULL if
+it couldn't be started.
+============
+*/
+static inflated_t *COM_InflateStart(pack_t *pak, packfile_t *file, bool ahead, bool wait)
+{
+    inflated_t *e, *slot;
+
+    slot = NULL;
+    for (e = com_inflated; e < com_inflated + MAX_INFLATED; e++)
+    {
+        if (e->file == file)
+        {
+            e->lastused = ++com_inflatetime;
+            return e;
+        }
+        if (!e->file && !slot)
+            slot = e;
+    }
+
+    // make room under the budget, then for the entry itself
+    while (com_inflatedbytes + file->filelen > INFLATED_BYTES && (e = COM_InflateOldest(true)) != NULL)
+        COM_InflateDrop(e);
+    if (!slot)
+    {
+        slot = COM_InflateOldest(ahead);
+        if (!slot && wait)
+        {
+            COM_InflateWaitAll();
+            slot = COM_InflateOldest(false);
+        }
+        if (!slot)
+            return NULL;
+        COM_InflateDrop(slot);
+    }
+
+    slot->data = malloc(file->filelen + 1);
+    if (!slot->data)
+        return NULL;
+    slot->file = file;
+    slot->ok = false;
+    slot->fresh = ahead;
+    slot->held = false;
+    slot->lastused = ++com_inflatetime;
+    com_inflatedbytes += file->filelen;
+
+    if (pak->base)
+        slot->in = pak->base + file->filepos;
+    else
+    {
+        slot->in = malloc(file->complen + 1);
+        if (!slot->in)
+            return slot; // left not ok
+        slot->readpak = pak;
+    }
+    slot->pending = true;
+    Task_Submit(&slot->group, COM_InflateTask, slot);
+    return slot;
+}
+
 /*
 ===========
 COM_FindFile
 
 Finds the file in the search path.
-Sets com_filesize and one of handle or file
+Sets com_filesize and one of handle or file.  A deflated file is inflated
+into com_view, unless wait is false when only com_deflated is set and the
+handle is no use.
 ===========
 */
-static int32_t COM_FindFile(char *filename, int32_t *handle, FILE **file)
+static int32_t COM_FindFile(char *filename, int32_t *handle, FILE **file, bool wait)
 {
     searchpath_t *search;
     char netpath[MAX_OSPATH];
     char cachepath[MAX_OSPATH];
     pack_t *pak;
+    packfile_t *pakfile;
+    fileindex_t *hit;
+    inflated_t *inflated;
+    bool indexed;
     int32_t i;
     int32_t findtime, cachetime;
 
@@ -870,6 +1252,12 @@ static int32_t COM_FindFile(char *filename, int32_t *handle, FILE **file)
     if (!file && !handle)
         Sys_Error("COM_FindFile: neither handle or file set");
 
+    com_view = NULL;
+    com_filepos = 0;
+    com_filepack = NULL;
+    com_deflated = NULL;
+    com_filetime = 0;
+
     //
     // search through the path, one element at a time
     //
@@ -880,31 +1268,78 @@ static int32_t COM_FindFile(char *filename, int32_t *handle, FILE **file)
             search = search->next;
     }
 
+    // the index only knows the winner over the whole path
+    indexed = search == com_searchpaths;
+    hit = indexed ? COM_IndexLookup(filename, COM_HashName(filename)) : NULL;
+
     for (; search; search = search->next)
     {
         // is the element a pak file?
         if (search->pack)
         {
-            // look through all the pak file elements
             pak = search->pack;
-            for (i = 0; i < pak->numfiles; i++)
-                if (!strcmp(pak->files[i].name, filename))
-                { // found it!
-                    Sys_Printf("PackFile: %s : %s\n", pak->filename, filename);
-                    if (handle)
+            if (indexed)
+                pakfile = hit && hit->search == search ? hit->file : NULL;
+            else
+                pakfile = COM_FindInPack(pak, filename);
+            if (!pakfile)
+                continue;
+
+            // found it!
+            Sys_Printf("PackFile: %s : %s\n", pak->filename, filename);
+            com_view = pak->base ? pak->base + pakfile->filepos : NULL;
+            com_filepos = pakfile->filepos;
+            com_filepack = pak;
+            if (pakfile->deflated)
+            {
+                com_deflated = pakfile;
+                com_view = NULL;
+                com_filesize = pakfile->filelen;
+                if (!wait)
+                {
+                    *handle = pak->handle;
+                    return com_filesize;
+                }
+
+                inflated = COM_InflateStart(pak, pakfile, false, true);
+                if (inflated)
+                {
+                    COM_InflateFinish(inflated);
+                    inflated->fresh = false;
+                }
+                if (!inflated || !inflated->ok)
+                {
+                    Con_Printf("Couldn't inflate %s from %s\n", filename, pak->filename);
+                    break;
+                }
+                com_view = inflated->data;
+
+                if (handle)
+                    *handle = pak->handle;
+                else
+                { // a file of its own holding the inflated data
+                    *file = tmpfile();
+                    if (*file)
                     {
-                        *handle = pak->handle;
-                        Sys_FileSeek(pak->handle, pak->files[i].filepos);
-                    }
-                    else
-                    { // open a new file on the pakfile
-                        *file = fopen(pak->filename, "rb");
-                        if (*file)
-                            fseek(*file, pak->files[i].filepos, SEEK_SET);
+                        fwrite(com_view, 1, com_filesize, *file);
+                        rewind(*file);
                     }
-                    com_filesize = pak->files[i].filelen;
-                    return com_filesize;
                 }
+                return com_filesize;
+            }
+            if (handle)
+            {
+                *handle = pak->handle;
+                Sys_FileSeek(pak->handle, pakfile->filepos);
+            }
+            else
+            { // open a new file on the pakfile
+                *file = fopen(pak->filename, "rb");
+                if (*file)
+                    fseek(*file, pakfile->filepos, SEEK_SET);
+            }
+            com_filesize = pakfile->filelen;
+            return com_filesize;
         }
         else
         {
@@ -944,6 +1379,7 @@ static int32_t COM_FindFile(char *filename, int32_t *handle, FILE **file)
             }
 
             Sys_Printf("FindFile: %s\n", netpath);
+            com_filetime = findtime;
             com_filesize = Sys_FileOpenRead(netpath, &i);
             if (handle)
                 *handle = i;
@@ -977,7 +1413,7 @@ it may actually be inside a pak file
 */
 int32_t COM_OpenFile(char *filename, int32_t *handle)
 {
-    return COM_FindFile(filename, handle, NULL);
+    return COM_FindFile(filename, handle, NULL, true);
 }
 
 /*
@@ -990,7 +1426,7 @@ into the file.
 */
 int32_t COM_FOpenFile(char *filename, FILE **file)
 {
-    return COM_FindFile(filename, NULL, file);
+    return COM_FindFile(filename, NULL, file, true);
 }
 
 /*
@@ -1000,17 +1436,54 @@ COM_CloseFile
 If it is a pak file handle, don't really close it
 ============
 */
-void COM_CloseFile(int32_t h)
+static bool COM_IsPackHandle(int32_t h)
 {
     searchpath_t *s;
 
     for (s = com_searchpaths; s; s = s->next)
         if (s->pack && s->pack->handle == h)
-            return;
+            return true;
+
+    return false;
+}
+
+void COM_CloseFile(int32_t h)
+{
+    if (COM_IsPackHandle(h))
+        return;
 
     Sys_FileClose(h);
 }
 
+/*
+============
+COM_FileStamp
+
+Finds a file without reading it.  The stamp changes with what the file
+holds: the crc stored in a pk3, the pak and place in it, or a loose file's
+modification time.  Sets com_filesize, -1 if the file isn't there.
+============
+*/
+uint32_t COM_FileStamp(char *path)
+{
+    int32_t h;
+    uint32_t stamp;
+
+    COM_FindFile(path, &h, NULL, false);
+    if (h == -1)
+        return 0;
+    COM_CloseFile(h);
+
+    if (com_deflated)
+        return com_deflated->crc;
+    if (com_filepack)
+    {
+        stamp = CRC32_Block(0, (uint8_t *)com_filepack->filename, strlen(com_filepack->filename));
+        return CRC32_Block(stamp, (uint8_t *)&com_filepos, sizeof(com_filepos));
+    }
+    return com_filetime;
+}
+
 /*
 ============
 COM_LoadFile
@@ -1048,7 +1521,7 @@ static uint8_t *COM_LoadFile(char *path, int32_t usehunk)
     else if (usehunk == 0)
         buf = Z_Malloc(len + 1);
     else if (usehunk == 3)
-        buf = Cache_Alloc(loadcache, len + 1, base);
+        buf = Cache_Alloc(loadcache, len + 1, base, MEM_PICS); // only pics are loaded this way
     else if (usehunk == 4)
     {
         if (len + 1 > loadsize)
@@ -1064,10 +1537,22 @@ static uint8_t *COM_LoadFile(char *path, int32_t usehunk)
 
     ((uint8_t *)buf)[len] = 0;
 
-    Draw_BeginDisc();
-    Sys_FileRead(h, buf, len);
-    COM_CloseFile(h);
-    Draw_EndDisc();
+    PROF_BEGIN("COM_LoadFile");
+    if (com_view)
+    {
+        memcpy(buf, com_view, len);
+        COM_CloseFile(h);
+    }
+    else
+    {
+        Draw_BeginDisc();
+        Sys_FileRead(h, buf, len);
+        COM_CloseFile(h);
+        Draw_EndDisc();
+    }
+    PROF_END();
+
+    Prof_Mark("load", "%s %d", path, len);
 
     return buf;
 }
@@ -1100,6 +1585,336 @@ uint8_t *COM_LoadStackFile(char *path, void *buffer, int32_t bufsize)
     return buf;
 }
 
+/*
+============
+COM_ViewFile
+
+Returns the file without copying it when it is stored in a mapped pak, the
+view stays valid for as long as the game runs.  Anything else is read or
+inflated onto the temp hunk.  Either way the data must not be written to and, unlike the
+COM_Load functions, has no 0 appended.  Sets com_fileview to say which it
+was.
+============
+*/
+bool com_fileview;
+
+uint8_t *COM_ViewFile(char *path)
+{
+    int32_t h, len;
+    uint8_t *buf;
+
+    len = COM_OpenFile(path, &h);
+    if (h == -1)
+        return NULL;
+
+    com_fileview = com_view && !com_deflated;
+    if (com_fileview)
+    {
+        COM_CloseFile(h);
+        Prof_Mark("view", "%s %d", path, len);
+        return com_view;
+    }
+
+    buf = Hunk_TempAlloc(len + 1);
+    if (!buf)
+        Sys_Error("COM_ViewFile: not enough space for %s", path);
+
+    PROF_BEGIN("COM_LoadFile");
+    if (com_view)
+    {
+        memcpy(buf, com_view, len);
+        COM_CloseFile(h);
+    }
+    else
+    {
+        Draw_BeginDisc();
+        Sys_FileRead(h, buf, len);
+        COM_CloseFile(h);
+        Draw_EndDisc();
+    }
+    PROF_END();
+
+    Prof_Mark("load", "%s %d", path, len);
+
+    return buf;
+}
+
+/*
+============
+COM_Prefetch
+
+Starts faulting in the pages of a file in a mapped pak on the worker pool,
+so a load that follows doesn't stall on the disk one page at a time, or
+inflating it if it is deflated.  Files outside paks are left alone.
+COM_PrefetchWait returns when everything started has been read.
+============
+*/
+#define MAX_PREFETCH 512
+#define PREFETCH_STRIDE 4096 // smallest page size anywhere
+
+typedef struct
+{
+    uint8_t *data;
+    int32_t len;
+} prefetch_t;
+
+static prefetch_t com_prefetch[MAX_PREFETCH];
+static int32_t com_numprefetch;
+static taskgroup_t com_prefetchgroup;
+
+static void COM_PrefetchTask(void *data)
+{
+    prefetch_t *p;
+    volatile uint8_t sink;
+    uint8_t sum;
+    int32_t i;
+
+    p = data;
+    sum = 0;
+    for (i = 0; i < p->len; i += PREFETCH_STRIDE)
+        sum += p->data[i];
+    sum += p->data[p->len - 1];
+    sink = sum;
+    (void)sink;
+}
+
+void COM_Prefetch(char *path)
+{
+    int32_t h, len;
+    prefetch_t *p;
+
+    if (com_numprefetch == MAX_PREFETCH)
+        COM_PrefetchWait();
+
+    len = COM_FindFile(path, &h, NULL, false);
+    if (h == -1)
+        return;
+    COM_CloseFile(h);
+    if (com_deflated)
+    {
+        COM_InflateStart(com_filepack, com_deflated, true, false);
+        return;
+    }
+    if (!com_view || len <= 0)
+        return;
+
+    p = &com_prefetch[com_numprefetch++];
+    p->data = com_view;
+    p->len = len;
+    Task_Submit(&com_prefetchgroup, COM_PrefetchTask, p);
+}
+
+void COM_PrefetchWait(void)
+{
+    Task_Wait(&com_prefetchgroup);
+    com_numprefetch = 0;
+    COM_InflateWaitAll();
+}
+
+/*
+============
+COM_AsyncLoad
+
+Loads a file without holding up the frame.  The first call for a path
+starts reading it and returns NULL, as does every call until the data is
+in, so the caller just asks again next frame.  com_asyncpending tells that
+NULL apart from a missing file.  Once the data is in, the file comes back
+exactly as COM_ViewFile would have returned it and the read is forgotten.
+
+Files in a mapped pak are faulted in on the worker pool, deflated ones are
+inflated there, anything else is read into a buffer of its own.  All but
+the mapped files are copied to the temp hunk when they are asked for.  A finished read nobody has asked about since the last frame is thrown
+away when its slot or handle is needed.
+============
+*/
+#define MAX_ASYNC_LOADS 16
+#define MAX_ASYNC_HANDLES 4 // a loose file keeps a sys handle open while it is read
+
+typedef struct
+{
+    char name[MAX_QPATH];
+    int32_t handle; // -1 for a mapped or deflated file
+    bool loose;     // holds a handle of its own
+    inflated_t *inflate; // a deflated file's cache entry
+    int32_t lastframe; // host_framecount when it was last asked for
+    int32_t len;
+    uint8_t *data;
+    sysread_t read;
+    prefetch_t prefetch;
+    taskgroup_t group;
+} asyncload_t;
+
+static asyncload_t com_async[MAX_ASYNC_LOADS];
+bool com_asyncpending;
+
+static bool COM_AsyncFinished(asyncload_t *a)
+{
+    if (a->inflate)
+        return !a->inflate->pending || Task_Done(&a->inflate->group);
+    if (a->handle == -1)
+        return Task_Done(&a->group);
+    return Sys_FileReadDone(&a->read);
+}
+
+static void COM_AsyncFree(asyncload_t *a)
+{
+    if (a->inflate)
+    {
+        a->inflate->held = false;
+        a->inflate = NULL;
+    }
+    else if (a->handle != -1)
+    {
+        COM_CloseFile(a->handle);
+        free(a->data);
+    }
+    a->name[0] = 0;
+}
+
+static asyncload_t *COM_AsyncReclaim(bool loose)
+{
+    asyncload_t *a;
+
+    for (a = com_async; a < com_async + MAX_ASYNC_LOADS; a++)
+        if (a->name[0] && (a->loose || !loose) && a->lastframe < host_framecount - 1 && COM_AsyncFinished(a))
+        {
+            COM_AsyncFree(a);
+            return a;
+        }
+
+    return NULL;
+}
+
+uint8_t *COM_AsyncLoad(char *path)
+{
+    asyncload_t *a, *slot;
+    uint8_t *buf, *src;
+    int32_t h, len, numloose;
+    bool ok;
+
+    com_asyncpending = false;
+    if (strlen(path) >= MAX_QPATH)
+        return COM_ViewFile(path); // couldn't be matched up again
+
+    slot = NULL;
+    numloose = 0;
+    for (a = com_async; a < com_async + MAX_ASYNC_LOADS; a++)
+    {
+        if (!a->name[0])
+        {
+            if (!slot)
+                slot = a;
+            continue;
+        }
+        numloose += a->loose;
+        if (strcmp(a->name, path))
+            continue;
+
+        a->lastframe = host_framecount;
+        if (!COM_AsyncFinished(a))
+        {
+            com_asyncpending = true;
+            return NULL;
+        }
+
+        com_filesize = a->len;
+        com_fileview = a->handle == -1 && !a->inflate;
+        src = a->data;
+        ok = a->handle == -1 || a->read.result == a->len;
+        if (a->inflate)
+        {
+            COM_InflateFinish(a->inflate);
+            a->inflate->fresh = false;
+            src = a->inflate->data;
+            ok = a->inflate->ok;
+        }
+
+        if (!ok)
+            buf = NULL;
+        else if (com_fileview)
+            buf = src;
+        else
+        {
+            buf = Hunk_TempAlloc(a->len + 1);
+            if (!buf)
+                Sys_Error("COM_AsyncLoad: not enough space for %s", path);
+            memcpy(buf, src, a->len);
+        }
+        COM_AsyncFree(a);
+
+        if (!buf)
+            Con_Printf("Couldn't read %s\n", path);
+        else
+            Prof_Mark("async", "%s %d", path, com_filesize);
+        return buf;
+    }
+
+    if (!slot)
+        slot = COM_AsyncReclaim(false);
+    if (!slot)
+    {
+        com_asyncpending = true; // try again once a read is done
+        return NULL;
+    }
+
+    len = COM_FindFile(path, &h, NULL, false);
+    if (h == -1)
+        return NULL;
+
+    snprintf(slot->name, sizeof(slot->name), "%s", path);
+    slot->lastframe = host_framecount;
+    slot->len = len;
+
+    if (com_deflated)
+    {
+        COM_CloseFile(h);
+        slot->handle = -1;
+        slot->loose = false;
+        slot->data = NULL;
+        slot->inflate = COM_InflateStart(com_filepack, com_deflated, false, false);
+        if (!slot->inflate)
+        {
+            slot->name[0] = 0;
+            com_asyncpending = true; // no room until an inflate finishes
+            return NULL;
+        }
+        slot->inflate->held = true;
+    }
+    else if (com_view)
+    {
+        COM_CloseFile(h);
+        slot->handle = -1;
+        slot->loose = false;
+        slot->data = com_view;
+        slot->prefetch.data = com_view;
+        slot->prefetch.len = len;
+        if (len > 0)
+            Task_Submit(&slot->group, COM_PrefetchTask, &slot->prefetch);
+    }
+    else
+    {
+        slot->loose = !COM_IsPackHandle(h);
+        if (slot->loose && numloose >= MAX_ASYNC_HANDLES && !COM_AsyncReclaim(true))
+        {
+            COM_CloseFile(h);
+            slot->name[0] = 0;
+            com_asyncpending = true; // try again once a read is done
+            return NULL;
+        }
+        slot->handle = h;
+        slot->data = malloc(len + 1);
+        if (!slot->data || !Sys_FileReadAsync(&slot->read, h, com_filepos, slot->data, len))
+        {
+            COM_AsyncFree(slot);
+            Con_Printf("Couldn't read %s\n", path);
+            return NULL;
+        }
+    }
+
+    com_asyncpending = true;
+    return NULL;
+}
+
 /*
 =================
 COM_LoadPackFile
@@ -1107,7 +1922,8 @@ COM_LoadPackFile
 Takes an explicit (not game tree related) path to a pak file.
 
 Loads the header and directory, adding the files at the beginning
-of the list so they override previous pack files.
+of the list so they override previous pack files.  The pak is mapped
+whole so its files can be handed out without a copy.
 =================
 */
 static pack_t *COM_LoadPackFile(char *packfile)
@@ -1117,11 +1933,12 @@ static pack_t *COM_LoadPackFile(char *packfile)
     packfile_t *newfiles;
     int32_t numpackfiles;
     pack_t *pack;
-    int32_t packhandle;
+    int32_t packhandle, packsize;
     dpackfile_t info[MAX_FILES_IN_PACK];
     uint16_t crc;
+    bool mappable;
 
-    if (Sys_FileOpenRead(packfile, &packhandle) == -1)
+    if ((packsize = Sys_FileOpenRead(packfile, &packhandle)) == -1)
     {
         //              Con_Printf ("Couldn't open %s\n", packfile);
         return NULL;
@@ -1153,11 +1970,16 @@ static pack_t *COM_LoadPackFile(char *packfile)
         com_modified = true;
 
     // parse the directory
+    mappable = true;
     for (i = 0; i < numpackfiles; i++)
     {
         strcpy(newfiles[i].name, info[i].name);
         newfiles[i].filepos =  (info[i].filepos);
         newfiles[i].filelen =  (info[i].filelen);
+        newfiles[i].complen = newfiles[i].filelen;
+        newfiles[i].deflated = false;
+        if (newfiles[i].filepos < 0 || newfiles[i].complen < 0 || newfiles[i].filepos > packsize - newfiles[i].complen)
+            mappable = false; // reading it just comes up short, a view would run off the mapping
     }
 
     pack = Hunk_Alloc(sizeof(pack_t));
@@ -1165,8 +1987,148 @@ static pack_t *COM_LoadPackFile(char *packfile)
     pack->handle = packhandle;
     pack->numfiles = numpackfiles;
     pack->files = newfiles;
+    pack->base = mappable ? Sys_FileMap(packhandle, packsize) : NULL;
+
+    Con_Printf("Added packfile %s (%i files%s)\n", packfile, numpackfiles, pack->base ? ", mapped" : "");
+    return pack;
+}
+
+/*
+=================
+COM_ZipRead
+
+Reads from the mapping when there is one
+=================
+*/
+static bool COM_ZipRead(int32_t handle, uint8_t *base, int32_t pos, void *dest, int32_t len)
+{
+    if (base)
+    {
+        memcpy(dest, base + pos, len);
+        return true;
+    }
+
+    Sys_FileSeek(handle, pos);
+    return Sys_FileRead(handle, dest, len) == len;
+}
+
+static uint32_t COM_ZipShort(uint8_t *p)
+{
+    return p[0] | (p[1] << 8);
+}
+
+static uint32_t COM_ZipLong(uint8_t *p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+/*
+=================
+COM_LoadZipFile
+
+Takes an explicit path to a pk3, a zip archive.  Only its central directory
+is read, to find where each entry's data starts past its local header.
+Stored entries are handed out just like a pak's, deflated ones are inflated
+when they are opened.  Entries that are encrypted, zip64, use any other
+compression or have too long a name are skipped.
+=================
+*/
+#define ZIP_END_SIZE 22 // end of central directory record, without the comment
+#define ZIP_END_SEARCH (ZIP_END_SIZE + 65535) // it may be followed by a comment this long
+#define ZIP_CENTRAL_SIZE 46
+#define ZIP_LOCAL_SIZE 30
+
+static pack_t *COM_LoadZipFile(char *zipfile)
+{
+    int32_t i, handle, size, tail, numentries, dirofs, dirlen, numfiles;
+    int32_t namelen, extralen, commentlen, method, complen, filelen, localofs, datapos;
+    uint8_t *base, *buf, *p, *end, local[ZIP_LOCAL_SIZE];
+    packfile_t *newfiles;
+    pack_t *pack;
+
+    if ((size = Sys_FileOpenRead(zipfile, &handle)) == -1)
+        return NULL;
+    base = Sys_FileMap(handle, size);
+
+    //
+    // find the end of central directory record, searching back over any comment
+    //
+    tail = size < ZIP_END_SEARCH ? size : ZIP_END_SEARCH;
+    buf = malloc(tail);
+    if (!buf || !COM_ZipRead(handle, base, size - tail, buf, tail))
+        Sys_Error("Couldn't read %s", zipfile);
+    for (p = buf + tail - ZIP_END_SIZE; p >= buf; p--)
+        if (COM_ZipLong(p) == 0x06054b50)
+            break;
+    if (p < buf)
+        Sys_Error("%s is not a zip file", zipfile);
+    numentries = COM_ZipShort(p + 10);
+    dirlen = COM_ZipLong(p + 12);
+    dirofs = COM_ZipLong(p + 16);
+    free(buf);
+    if (dirlen < 0 || dirofs < 0 || dirofs > size - dirlen)
+        Sys_Error("%s has a bad central directory", zipfile);
+
+    buf = malloc(dirlen + 1);
+    if (!buf || !COM_ZipRead(handle, base, dirofs, buf, dirlen))
+        Sys_Error("Couldn't read %s", zipfile);
+
+    //
+    // parse the central directory
+    //
+    newfiles = Hunk_AllocName(numentries * sizeof(packfile_t), "packfile");
+    numfiles = 0;
+    end = buf + dirlen;
+    for (i = 0, p = buf; i < numentries; i++, p += ZIP_CENTRAL_SIZE + namelen + extralen + commentlen)
+    {
+        if (end - p < ZIP_CENTRAL_SIZE || COM_ZipLong(p) != 0x02014b50)
+            Sys_Error("%s has a bad central directory", zipfile);
+        method = COM_ZipShort(p + 10);
+        complen = COM_ZipLong(p + 20);
+        filelen = COM_ZipLong(p + 24);
+        namelen = COM_ZipShort(p + 28);
+        extralen = COM_ZipShort(p + 30);
+        commentlen = COM_ZipShort(p + 32);
+        localofs = COM_ZipLong(p + 42);
+        if (end - p - ZIP_CENTRAL_SIZE < namelen + extralen + commentlen)
+            Sys_Error("%s has a bad central directory", zipfile);
+
+        if (!namelen || namelen >= MAX_QPATH || p[ZIP_CENTRAL_SIZE + namelen - 1] == '/')
+            continue; // too long for a quake path, or a directory
+        if (COM_ZipShort(p + 8) & 1)
+            continue; // encrypted
+        if (method != 0 && method != 8)
+            continue;
+        if (complen < 0 || filelen < 0 || localofs < 0 || localofs > size - ZIP_LOCAL_SIZE)
+            continue; // zip64, or too big for us anyway
+
+        if (!COM_ZipRead(handle, base, localofs, local, ZIP_LOCAL_SIZE) || COM_ZipLong(local) != 0x04034b50)
+            continue;
+        datapos = localofs + ZIP_LOCAL_SIZE + COM_ZipShort(local + 26) + COM_ZipShort(local + 28);
+        if (datapos > size - complen || (method == 0 && complen != filelen))
+            continue;
+
+        memcpy(newfiles[numfiles].name, p + ZIP_CENTRAL_SIZE, namelen);
+        newfiles[numfiles].name[namelen] = 0;
+        newfiles[numfiles].filepos = datapos;
+        newfiles[numfiles].filelen = filelen;
+        newfiles[numfiles].complen = complen;
+        newfiles[numfiles].deflated = method == 8;
+        newfiles[numfiles].crc = COM_ZipLong(p + 16);
+        numfiles++;
+    }
+    free(buf);
+
+    com_modified = true; // not the original file
+
+    pack = Hunk_Alloc(sizeof(pack_t));
+    strcpy(pack->filename, zipfile);
+    pack->handle = handle;
+    pack->numfiles = numfiles;
+    pack->files = newfiles;
+    pack->base = base;
 
-    Con_Printf("Added packfile %s (%i files)\n", packfile, numpackfiles);
+    Con_Printf("Added packfile %s (%i files%s)\n", zipfile, numfiles, pack->base ? ", mapped" : "");
     return pack;
 }
 
@@ -1175,15 +2137,45 @@ static pack_t *COM_LoadPackFile(char *packfile)
 COM_AddGameDirectory
 
 Sets com_gamedir, adds the directory to the head of the path,
-then loads and adds pak1.pak pak2.pak ...
+then loads and adds pak1.pak pak2.pak ... and then every .pk3
 ================
 */
+#define MAX_ZIPS_IN_DIR 64
+
+typedef struct
+{
+    int32_t count;
+    char names[MAX_ZIPS_IN_DIR][MAX_QPATH];
+} zipnames_t;
+
+static void COM_ScanZipName(char *name, void *data)
+{
+    zipnames_t *zips = data;
+    char *ext;
+
+    ext = strrchr(name, '.');
+    if (!ext || strcasecmp(ext, ".pk3") || strlen(name) >= MAX_QPATH)
+        return;
+    if (zips->count == MAX_ZIPS_IN_DIR)
+    {
+        Con_Printf("Too many pk3 files, skipping %s\n", name);
+        return;
+    }
+    strcpy(zips->names[zips->count++], name);
+}
+
+static int COM_CompareZipNames(const void *a, const void *b)
+{
+    return strcmp(a, b);
+}
+
 static void COM_AddGameDirectory(char *dir)
 {
     int32_t i;
     searchpath_t *search;
     pack_t *pak;
     char pakfile[MAX_OSPATH];
+    zipnames_t zips;
 
     strcpy(com_gamedir, dir);
 
@@ -1208,6 +2200,26 @@ static void COM_AddGameDirectory(char *dir)
         search->pack = pak;
         search->next = com_searchpaths;
         com_searchpaths = search;
+        COM_IndexPack(search);
+    }
+
+    //
+    // then the pk3 files, in name order so later ones override earlier ones
+    //
+    zips.count = 0;
+    Sys_FindFiles(dir, COM_ScanZipName, &zips);
+    qsort(zips.names, zips.count, sizeof(zips.names[0]), COM_CompareZipNames);
+    for (i = 0; i < zips.count; i++)
+    {
+        snprintf(pakfile, sizeof(pakfile), "%s/%s", dir, zips.names[i]);
+        pak = COM_LoadZipFile(pakfile);
+        if (!pak)
+            continue;
+        search = Hunk_Alloc(sizeof(searchpath_t));
+        search->pack = pak;
+        search->next = com_searchpaths;
+        com_searchpaths = search;
+        COM_IndexPack(search);
     }
 
     //
@@ -1224,6 +2236,7 @@ static void COM_InitFilesystem(void)
 {
     int32_t i, j;
     char basedir[MAX_OSPATH];
+    char *ext;
     searchpath_t *search;
 
     //
@@ -1284,7 +2297,7 @@ static void COM_InitFilesystem(void)
     }
 
     //
-    // -path <dir or packfile> [<dir or packfile>] ...
+    // -path <dir or pak or pk3> [<dir or pak or pk3>] ...
     // Fully specifies the exact serach path, overriding the generated one
     //
     i = COM_CheckParm("-path");
@@ -1292,15 +2305,21 @@ static void COM_InitFilesystem(void)
     {
         com_modified = true;
         com_searchpaths = NULL;
+        memset(com_fileindex, 0, sizeof(com_fileindex));
+        com_numindexed = 0;
         while (++i < com_argc)
         {
             if (!com_argv[i] || com_argv[i][0] == '+' || com_argv[i][0] == '-')
                 break;
 
             search = Hunk_Alloc(sizeof(searchpath_t));
-            if (!strcmp(COM_FileExtension(com_argv[i]), "pak"))
+            ext = COM_FileExtension(com_argv[i]);
+            if (!strcmp(ext, "pak") || !strcmp(ext, "pk3"))
             {
-                search->pack = COM_LoadPackFile(com_argv[i]);
+                if (!strcmp(ext, "pak"))
+                    search->pack = COM_LoadPackFile(com_argv[i]);
+                else
+                    search->pack = COM_LoadZipFile(com_argv[i]);
                 if (!search->pack)
                     Sys_Error("Couldn't load packfile: %s", com_argv[i]);
             }
@@ -1308,6 +2327,8 @@ static void COM_InitFilesystem(void)
                 strcpy(search->filename, com_argv[i]);
             search->next = com_searchpaths;
             com_searchpaths = search;
+            if (search->pack)
+                COM_IndexPack(search);
         }
     }
 
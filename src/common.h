@@ -93,6 +93,7 @@ int32_t COM_CheckParm(char *parm);
 void COM_Init(char *path);
 void COM_InitArgv(int32_t argc, char **argv);
 
+uint32_t COM_HashName(char *name);
 char *COM_SkipPath(char *pathname);
 void COM_StripExtension(char *in, char *out);
 void COM_FileBase(char *in, char *out);
@@ -112,12 +113,28 @@ void COM_WriteFile(char *filename, void *data, int32_t len);
 int32_t COM_OpenFile(char *filename, int32_t *hndl);
 int32_t COM_FOpenFile(char *filename, FILE **file);
 void COM_CloseFile(int32_t h);
+uint32_t COM_FileStamp(char *path);
+// changes when the file's contents do, without reading them
 
 uint8_t *COM_LoadStackFile(char *path, void *buffer, int32_t bufsize);
 uint8_t *COM_LoadTempFile(char *path);
 uint8_t *COM_LoadHunkFile(char *path);
 void COM_LoadCacheFile(char *path, struct cache_user_s *cu);
 
+extern bool com_fileview;
+uint8_t *COM_ViewFile(char *path);
+// read-only, a view straight into a mapped pak when com_fileview is set,
+// otherwise a copy on the temp hunk
+
+void COM_Prefetch(char *path);
+void COM_PrefetchWait(void);
+// reads a file's pages in, or inflates it, ahead of a load on the worker pool
+
+extern bool com_asyncpending;
+uint8_t *COM_AsyncLoad(char *path);
+// NULL until the file has been read without blocking, then the same as
+// COM_ViewFile.  com_asyncpending is set while the read is still going.
+
 extern struct cvar_s registered;
 
 extern bool standard_quake, rogue, hipnotic;
@@ -0,0 +1,193 @@
+// counter.c -- performance counter registry
+
+#include "quakedef.h"
+
+typedef struct
+{
+    char *name;
+    int32_t *value;
+    countertype_t type;
+    int32_t last; // CNT_TOTAL value at the previous sample
+} counter_t;
+
+static counter_t counters[MAX_COUNTERS];
+static int32_t numcounters;
+
+static int32_t counter_ring[COUNTER_FRAMES][MAX_COUNTERS];
+static float counter_ms[COUNTER_FRAMES];
+static int32_t counter_frame[COUNTER_FRAMES];
+static int32_t counter_numframes; // frames sampled since startup
+static double counter_lasttime;
+
+static cvar_t scr_counters = {"scr_counters", "0"};
+
+/*
+================
+Counter_Register
+================
+*/
+void Counter_Register(char *name, int32_t *value, countertype_t type)
+{
+    counter_t *c;
+
+    if (numcounters == MAX_COUNTERS)
+        Sys_Error("Counter_Register: too many counters");
+
+    c = &counters[numcounters++];
+    c->name = name;
+    c->value = value;
+    c->type = type;
+    c->last = *value;
+}
+
+/*
+================
+Counter_EndFrame
+================
+*/
+void Counter_EndFrame(void)
+{
+    int32_t i, slot, v;
+    counter_t *c;
+
+    slot = counter_numframes & (COUNTER_FRAMES - 1);
+
+    for (i = 0, c = counters; i < numcounters; i++, c++)
+    {
+        v = *c->value;
+        switch (c->type)
+        {
+        case CNT_COUNT:
+            *c->value = 0;
+            break;
+        case CNT_TOTAL:
+            v -= c->last;
+            c->last = *c->value;
+            break;
+        default:
+            break;
+        }
+        counter_ring[slot][i] = v;
+    }
+
+    counter_ms[slot] = (realtime - counter_lasttime) * 1000;
+    counter_frame[slot] = host_framecount;
+    counter_lasttime = realtime;
+    counter_numframes++;
+}
+
+/*
+================
+Counter_Dump_f
+
+counters_dump [frames] [file], a .json file name selects JSON, anything
+else is written as CSV
+================
+*/
+static void Counter_Dump_f(void)
+{
+    FILE *f;
+    int32_t i, j, n, slot, len;
+    bool json;
+    char *filename;
+    char name[MAX_OSPATH];
+
+    n = Cmd_Argc() > 1 ? (int32_t)strtol(Cmd_Argv(1), NULL, 0) : COUNTER_FRAMES;
+    if (n < 1 || n > COUNTER_FRAMES)
+        n = COUNTER_FRAMES;
+    if (n > counter_numframes)
+        n = counter_numframes;
+
+    filename = Cmd_Argc() > 2 ? Cmd_Argv(2) : "counters.csv";
+    len = strlen(filename);
+    json = len > 5 && !strcasecmp(filename + len - 5, ".json");
+
+    snprintf(name, sizeof(name), "%s/%s", com_gamedir, filename);
+    f = fopen(name, "w");
+    if (!f)
+    {
+        Con_Printf("Couldn't write %s\n", filename);
+        return;
+    }
+
+    if (json)
+    {
+        fprintf(f, "{\"counters\":[");
+        for (i = 0; i < numcounters; i++)
+            fprintf(f, "%s\"%s\"", i ? "," : "", counters[i].name);
+        fprintf(f, "],\n\"frames\":[\n");
+    }
+    else
+    {
+        fprintf(f, "frame,ms");
+        for (i = 0; i < numcounters; i++)
+            fprintf(f, ",%s", counters[i].name);
+        fprintf(f, "\n");
+    }
+
+    for (j = counter_numframes - n; j < counter_numframes; j++)
+    {
+        slot = j & (COUNTER_FRAMES - 1);
+        if (json)
+            fprintf(f, "{\"frame\":%d,\"ms\":%.3f,\"values\":[", counter_frame[slot], counter_ms[slot]);
+        else
+            fprintf(f, "%d,%.3f", counter_frame[slot], counter_ms[slot]);
+
+        for (i = 0; i < numcounters; i++)
+            fprintf(f, json && !i ? "%d" : ",%d", counter_ring[slot][i]);
+
+        if (json)
+            fprintf(f, "]}%s\n", j < counter_numframes - 1 ? "," : "");
+        else
+            fprintf(f, "\n");
+    }
+
+    if (json)
+        fprintf(f, "]}\n");
+    fclose(f);
+
+    Con_Printf("Wrote %d frames of %d counters to %s\n", n, numcounters, filename);
+}
+
+/*
+================
+Counter_Draw
+
+Lists the last frame's value of every counter with its average over the
+last second or so
+================
+*/
+void Counter_Draw(void)
+{
+    int32_t i, j, n, x, y, slot;
+    double sum;
+    char str[64];
+
+    if (!scr_counters.value || !counter_numframes)
+        return;
+
+    n = counter_numframes < 64 ? counter_numframes : 64;
+    slot = (counter_numframes - 1) & (COUNTER_FRAMES - 1);
+    x = vid.width - 31 * 8;
+    y = 0;
+
+    for (i = 0; i < numcounters; i++, y += 8)
+    {
+        for (j = 0, sum = 0; j < n; j++)
+            sum += counter_ring[(counter_numframes - 1 - j) & (COUNTER_FRAMES - 1)][i];
+
+        snprintf(str, sizeof(str), "%-16s %6d %6.0f", counters[i].name, counter_ring[slot][i], sum / n);
+        Draw_String(x, y, str);
+    }
+}
+
+/*
+================
+Counter_Init
+================
+*/
+void Counter_Init(void)
+{
+    Cvar_RegisterVariable(&scr_counters);
+    Cmd_AddCommand("counters_dump", Counter_Dump_f);
+}
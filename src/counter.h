@@ -0,0 +1,34 @@
+/*
+ counter.h -- performance counter registry
+
+Counter_??? Subsystems keep their statistics in plain int32_t variables and
+register a pointer to each one with a name, so updating a counter costs no
+more than the increment it always was.  At the end of every host frame the
+registry samples them all into a ring buffer of recent frames, which can be
+dumped to CSV or JSON with counters_dump or watched with scr_counters.
+
+A CNT_COUNT is zeroed after every sample, a CNT_GAUGE is sampled as is, and
+a CNT_TOTAL is a running total owned by its subsystem whose per-frame
+increase is what gets recorded.
+*/
+
+typedef enum
+{
+    CNT_COUNT,
+    CNT_GAUGE,
+    CNT_TOTAL
+} countertype_t;
+
+#define MAX_COUNTERS 48
+#define COUNTER_FRAMES 1024 // must be a power of two
+
+void Counter_Init(void);
+
+void Counter_Register(char *name, int32_t *value, countertype_t type);
+// name must be a string constant
+
+void Counter_EndFrame(void);
+// samples every counter into the ring buffer
+
+void Counter_Draw(void);
+// the scr_counters overlay
@@ -3,3 +3,6 @@
 void CRC_Init(uint16_t *crcvalue);
 void CRC_ProcessByte(uint16_t *crcvalue, uint8_t data);
 uint16_t CRC_Value(uint16_t crcvalue);
+
+uint32_t CRC32_Block(uint32_t crc, uint8_t *data, int32_t len);
+// pass 0 as the starting crc, or the result of the previous block to continue
@@ -152,6 +152,8 @@ void D_DrawSurfaces(void)
     vec3_t world_transformed_modelorg;
     vec3_t local_modelorg;
 
+    HWPERF_BEGIN(HWP_SURFACES);
+
     currententity = &cl_entities[0];
     TransformVector(modelorg, transformed_modelorg);
     VectorCopy(transformed_modelorg, world_transformed_modelorg);
@@ -294,4 +296,6 @@ void D_DrawSurfaces(void)
             }
         }
     }
+
+    HWPERF_END(HWP_SURFACES);
 }
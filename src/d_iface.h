@@ -100,6 +100,8 @@ typedef struct
 } zpointdesc_t;
 
 extern cvar_t r_drawflat;
+extern cvar_t d_simd;
+extern cvar_t d_parallel;
 extern int32_t d_spanpixcount;
 extern int32_t r_framecount;            // sequence # of current frame since Quake
                                         //  started
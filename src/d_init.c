@@ -6,6 +6,8 @@
 #define NUM_MIPS 4
 
 cvar_t d_subdiv16 = {"d_subdiv16", "1"};
+cvar_t d_simd = {"d_simd", "1"};         // use vector span loops when the cpu has them
+cvar_t d_parallel = {"d_parallel", "1"}; // spread the screen warp over the worker threads
 static cvar_t d_mipcap = {"d_mipcap", "0"};
 static cvar_t d_mipscale = {"d_mipscale", "1"};
 
@@ -16,9 +18,16 @@ float d_scalemip[NUM_MIPS - 1];
 
 static float basemip[NUM_MIPS - 1] = {1.0, 0.5 * 0.8, 0.25 * 0.8};
 
+static bool d_simdavailable;
+
 extern int32_t d_aflatcolor;
 
 void (*d_drawspans)(espan_t *pspan);
+void (*d_turbspan)(uint8_t *pdest, uint8_t *pbase, int32_t *turb, fixed16_t s, fixed16_t t, fixed16_t sstep,
+                   fixed16_t tstep, int32_t count);
+void (*d_skyspan)(uint8_t *pdest, uint8_t *psky, fixed16_t s, fixed16_t t, fixed16_t sstep, fixed16_t tstep,
+                  int32_t count);
+void (*d_warprow)(uint8_t *pdest, uint8_t *pbase, int32_t *rowofs, int32_t *col, int32_t *turb, int32_t count);
 
 /*
 ===============
@@ -33,6 +42,12 @@ void D_Init(void)
     Cvar_RegisterVariable(&d_subdiv16);
     Cvar_RegisterVariable(&d_mipcap);
     Cvar_RegisterVariable(&d_mipscale);
+    Cvar_RegisterVariable(&d_simd);
+    Cvar_RegisterVariable(&d_parallel);
+
+    d_simdavailable = D_SIMDAvailable();
+    if (d_simdavailable)
+        Con_Printf("AVX2 span drawing available\n");
 
     r_drawpolys = false;
     r_worldpolysbacktofront = false;
@@ -104,6 +119,19 @@ void D_SetupFrame(void)
 
     d_drawspans = D_DrawSpans8;
 
+    if (d_simd.value && d_simdavailable)
+    {
+        d_turbspan = D_TurbSpan8_AVX2;
+        d_skyspan = D_SkySpan8_AVX2;
+        d_warprow = D_WarpRow8_AVX2;
+    }
+    else
+    {
+        d_turbspan = D_TurbSpan8;
+        d_skyspan = D_SkySpan8;
+        d_warprow = D_WarpRow8;
+    }
+
     d_aflatcolor = 0;
 }
 
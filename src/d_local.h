@@ -59,6 +59,19 @@ void D_SpriteDrawSpans(sspan_t *pspan);
 void D_DrawSkyScans8(espan_t *pspan);
 void D_DrawSkyScans16(espan_t *pspan);
 
+// innermost span loops, the _AVX2 versions live in d_simd.c
+void D_TurbSpan8(uint8_t *pdest, uint8_t *pbase, int32_t *turb, fixed16_t s, fixed16_t t, fixed16_t sstep,
+                 fixed16_t tstep, int32_t count);
+void D_TurbSpan8_AVX2(uint8_t *pdest, uint8_t *pbase, int32_t *turb, fixed16_t s, fixed16_t t, fixed16_t sstep,
+                      fixed16_t tstep, int32_t count);
+void D_SkySpan8(uint8_t *pdest, uint8_t *psky, fixed16_t s, fixed16_t t, fixed16_t sstep, fixed16_t tstep,
+                int32_t count);
+void D_SkySpan8_AVX2(uint8_t *pdest, uint8_t *psky, fixed16_t s, fixed16_t t, fixed16_t sstep, fixed16_t tstep,
+                     int32_t count);
+void D_WarpRow8(uint8_t *pdest, uint8_t *pbase, int32_t *rowofs, int32_t *col, int32_t *turb, int32_t count);
+void D_WarpRow8_AVX2(uint8_t *pdest, uint8_t *pbase, int32_t *rowofs, int32_t *col, int32_t *turb, int32_t count);
+bool D_SIMDAvailable(void);
+
 void R_ShowSubDiv(void);
 void (*prealspandrawer)(void);
 surfcache_t *D_CacheSurface(msurface_t *surface, int32_t miplevel);
@@ -83,3 +96,8 @@ extern int32_t d_minmip;
 extern float d_scalemip[3];
 
 extern void (*d_drawspans)(espan_t *pspan);
+extern void (*d_turbspan)(uint8_t *pdest, uint8_t *pbase, int32_t *turb, fixed16_t s, fixed16_t t, fixed16_t sstep,
+                          fixed16_t tstep, int32_t count);
+extern void (*d_skyspan)(uint8_t *pdest, uint8_t *psky, fixed16_t s, fixed16_t t, fixed16_t sstep, fixed16_t tstep,
+                         int32_t count);
+extern void (*d_warprow)(uint8_t *pdest, uint8_t *pbase, int32_t *rowofs, int32_t *col, int32_t *turb, int32_t count);
@@ -6,16 +6,52 @@
 #include "r_local.h"
 #include "d_local.h"
 
-static unsigned char *r_turb_pbase;
-static unsigned char *r_turb_pdest;
-static fixed16_t r_turb_s;
-static fixed16_t r_turb_t;
-static fixed16_t r_turb_sstep;
-static fixed16_t r_turb_tstep;
-static int32_t *r_turb_turb;
-static int32_t r_turb_spancount;
+typedef struct
+{
+    uint8_t *pbase;
+    uint8_t *dest;
+    int32_t *rowofs;
+    int32_t *column;
+    int32_t *turb;
+    int32_t width;
+} warpjob_t;
 
-static void D_DrawTurbulent8Span(void);
+/*
+=============
+D_WarpRow8
+=============
+*/
+void D_WarpRow8(uint8_t *pdest, uint8_t *pbase, int32_t *rowofs, int32_t *col, int32_t *turb, int32_t count)
+{
+    int32_t u;
+
+    for (u = 0; u < count; u += 4)
+    {
+        pdest[u + 0] = pbase[rowofs[turb[u + 0]] + col[u + 0]];
+        pdest[u + 1] = pbase[rowofs[turb[u + 1]] + col[u + 1]];
+        pdest[u + 2] = pbase[rowofs[turb[u + 2]] + col[u + 2]];
+        pdest[u + 3] = pbase[rowofs[turb[u + 3]] + col[u + 3]];
+    }
+}
+
+/*
+=============
+D_WarpRows
+
+Warps output rows [start, end), may run on a worker thread
+=============
+*/
+static void D_WarpRows(int32_t start, int32_t end, void *data)
+{
+    warpjob_t *job = data;
+    uint8_t *dest;
+    int32_t v;
+
+    dest = job->dest + start * vid.rowbytes;
+
+    for (v = start; v < end; v++, dest += vid.rowbytes)
+        d_warprow(dest, job->pbase, &job->rowofs[v], &job->column[job->turb[v]], job->turb, job->width);
+}
 
 /*
 =============
@@ -29,13 +65,10 @@ void D_WarpScreen(void)
 {
     int32_t w, h;
     int32_t u, v;
-    uint8_t *dest;
-    int32_t *turb;
-    int32_t *col;
-    uint8_t **row;
-    uint8_t *rowptr[MAXHEIGHT + (AMP2 * 2)];
+    int32_t rowofs[MAXHEIGHT + (AMP2 * 2)];
     int32_t column[MAXWIDTH + (AMP2 * 2)];
     float wratio, hratio;
+    warpjob_t job;
 
     w = r_refdef.vrect.width;
     h = r_refdef.vrect.height;
@@ -45,8 +78,7 @@ void D_WarpScreen(void)
 
     for (v = 0; v < scr_vrect.height + AMP2 * 2; v++)
     {
-        rowptr[v] = d_viewbuffer + (r_refdef.vrect.y * screenwidth) +
-                    (screenwidth * (int32_t)((float)v * hratio * h / (h + AMP2 * 2)));
+        rowofs[v] = (r_refdef.vrect.y * screenwidth) + (screenwidth * (int32_t)((float)v * hratio * h / (h + AMP2 * 2)));
     }
 
     for (u = 0; u < scr_vrect.width + AMP2 * 2; u++)
@@ -54,41 +86,39 @@ void D_WarpScreen(void)
         column[u] = r_refdef.vrect.x + (int32_t)((float)u * wratio * w / (w + AMP2 * 2));
     }
 
-    turb = intsintable + ((int32_t)(cl.time * SPEED) & (CYCLE - 1));
-    dest = vid.buffer + scr_vrect.y * vid.rowbytes + scr_vrect.x;
-
-    for (v = 0; v < scr_vrect.height; v++, dest += vid.rowbytes)
-    {
-        col = &column[turb[v]];
-        row = &rowptr[v];
-
-        for (u = 0; u < scr_vrect.width; u += 4)
-        {
-            dest[u + 0] = row[turb[u + 0]][col[u + 0]];
-            dest[u + 1] = row[turb[u + 1]][col[u + 1]];
-            dest[u + 2] = row[turb[u + 2]][col[u + 2]];
-            dest[u + 3] = row[turb[u + 3]][col[u + 3]];
-        }
-    }
+    job.pbase = d_viewbuffer;
+    job.dest = vid.buffer + scr_vrect.y * vid.rowbytes + scr_vrect.x;
+    job.rowofs = rowofs;
+    job.column = column;
+    job.turb = intsintable + ((int32_t)(cl.time * SPEED) & (CYCLE - 1));
+    job.width = scr_vrect.width;
+
+    // rows only read the warp buffer and write their own scanline of the
+    // frame buffer, so bands of them can be warped concurrently
+    if (d_parallel.value)
+        Task_ParallelRange(scr_vrect.height, 32, D_WarpRows, &job);
+    else
+        D_WarpRows(0, scr_vrect.height, &job);
 }
 
 /*
 =============
-D_DrawTurbulent8Span
+D_TurbSpan8
 =============
 */
-static void D_DrawTurbulent8Span(void)
+void D_TurbSpan8(uint8_t *pdest, uint8_t *pbase, int32_t *turb, fixed16_t s, fixed16_t t, fixed16_t sstep,
+                 fixed16_t tstep, int32_t count)
 {
     int32_t sturb, tturb;
 
     do
     {
-        sturb = ((r_turb_s + r_turb_turb[(r_turb_t >> 16) & (CYCLE - 1)]) >> 16) & 63;
-        tturb = ((r_turb_t + r_turb_turb[(r_turb_s >> 16) & (CYCLE - 1)]) >> 16) & 63;
-        *r_turb_pdest++ = *(r_turb_pbase + (tturb << 6) + sturb);
-        r_turb_s += r_turb_sstep;
-        r_turb_t += r_turb_tstep;
-    } while (--r_turb_spancount > 0);
+        sturb = ((s + turb[(t >> 16) & (CYCLE - 1)]) >> 16) & 63;
+        tturb = ((t + turb[(s >> 16) & (CYCLE - 1)]) >> 16) & 63;
+        *pdest++ = *(pbase + (tturb << 6) + sturb);
+        s += sstep;
+        t += tstep;
+    } while (--count > 0);
 }
 
 /*
@@ -98,17 +128,19 @@ Turbulent8
 */
 void Turbulent8(espan_t *pspan)
 {
-    int32_t count;
-    fixed16_t snext, tnext;
+    int32_t count, spancount;
+    unsigned char *pbase, *pdest;
+    int32_t *turb;
+    fixed16_t s, t, snext, tnext, sstep, tstep;
     float sdivz, tdivz, zi, z, du, dv, spancountminus1;
     float sdivz16stepu, tdivz16stepu, zi16stepu;
 
-    r_turb_turb = sintable + ((int32_t)(cl.time * SPEED) & (CYCLE - 1));
+    turb = sintable + ((int32_t)(cl.time * SPEED) & (CYCLE - 1));
 
-    r_turb_sstep = 0; // keep compiler happy
-    r_turb_tstep = 0; // ditto
+    sstep = 0; // keep compiler happy
+    tstep = 0; // ditto
 
-    r_turb_pbase = (unsigned char *)cacheblock;
+    pbase = (unsigned char *)cacheblock;
 
     sdivz16stepu = d_sdivzstepu * 16;
     tdivz16stepu = d_tdivzstepu * 16;
@@ -116,7 +148,7 @@ void Turbulent8(espan_t *pspan)
 
     do
     {
-        r_turb_pdest = (unsigned char *)((uint8_t *)d_viewbuffer + (screenwidth * pspan->v) + pspan->u);
+        pdest = (unsigned char *)((uint8_t *)d_viewbuffer + (screenwidth * pspan->v) + pspan->u);
 
         count = pspan->count;
 
@@ -129,27 +161,27 @@ void Turbulent8(espan_t *pspan)
         zi = d_ziorigin + dv * d_zistepv + du * d_zistepu;
         z = (float)0x10000 / zi; // prescale to 16.16 fixed-point
 
-        r_turb_s = (int32_t)(sdivz * z) + sadjust;
-        if (r_turb_s > bbextents)
-            r_turb_s = bbextents;
-        else if (r_turb_s < 0)
-            r_turb_s = 0;
+        s = (int32_t)(sdivz * z) + sadjust;
+        if (s > bbextents)
+            s = bbextents;
+        else if (s < 0)
+            s = 0;
 
-        r_turb_t = (int32_t)(tdivz * z) + tadjust;
-        if (r_turb_t > bbextentt)
-            r_turb_t = bbextentt;
-        else if (r_turb_t < 0)
-            r_turb_t = 0;
+        t = (int32_t)(tdivz * z) + tadjust;
+        if (t > bbextentt)
+            t = bbextentt;
+        else if (t < 0)
+            t = 0;
 
         do
         {
             // calculate s and t at the far end of the span
             if (count >= 16)
-                r_turb_spancount = 16;
+                spancount = 16;
             else
-                r_turb_spancount = count;
+                spancount = count;
 
-            count -= r_turb_spancount;
+            count -= spancount;
 
             if (count)
             {
@@ -174,8 +206,8 @@ void Turbulent8(espan_t *pspan)
                 else if (tnext < 16)
                     tnext = 16; // guard against round-off error on <0 steps
 
-                r_turb_sstep = (snext - r_turb_s) >> 4;
-                r_turb_tstep = (tnext - r_turb_t) >> 4;
+                sstep = (snext - s) >> 4;
+                tstep = (tnext - t) >> 4;
             }
             else
             {
@@ -183,7 +215,7 @@ void Turbulent8(espan_t *pspan)
                 // can't step off polygon), clamp, calculate s and t steps across
                 // span by division, biasing steps low so we don't run off the
                 // texture
-                spancountminus1 = (float)(r_turb_spancount - 1);
+                spancountminus1 = (float)(spancount - 1);
                 sdivz += d_sdivzstepu * spancountminus1;
                 tdivz += d_tdivzstepu * spancountminus1;
                 zi += d_zistepu * spancountminus1;
@@ -202,20 +234,21 @@ void Turbulent8(espan_t *pspan)
                 else if (tnext < 16)
                     tnext = 16; // guard against round-off error on <0 steps
 
-                if (r_turb_spancount > 1)
+                if (spancount > 1)
                 {
-                    r_turb_sstep = (snext - r_turb_s) / (r_turb_spancount - 1);
-                    r_turb_tstep = (tnext - r_turb_t) / (r_turb_spancount - 1);
+                    sstep = (snext - s) / (spancount - 1);
+                    tstep = (tnext - t) / (spancount - 1);
                 }
             }
 
-            r_turb_s = r_turb_s & ((CYCLE << 16) - 1);
-            r_turb_t = r_turb_t & ((CYCLE << 16) - 1);
+            s = s & ((CYCLE << 16) - 1);
+            t = t & ((CYCLE << 16) - 1);
 
-            D_DrawTurbulent8Span();
+            d_turbspan(pdest, pbase, turb, s, t, sstep, tstep, spancount);
+            pdest += spancount;
 
-            r_turb_s = snext;
-            r_turb_t = tnext;
+            s = snext;
+            t = tnext;
 
         } while (count > 0);
 
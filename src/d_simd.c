@@ -0,0 +1,184 @@
+// d_simd.c: vector versions of the turbulent, sky and screen warp inner loops
+//
+// These are only built for x86 and are selected at runtime when the CPU
+// supports AVX2, so the rest of the engine stays at the baseline instruction
+// set.  Every routine has to produce exactly the same pixels as the portable
+// C version it replaces in d_scan.c / d_sky.c.
+
+#include "quakedef.h"
+#include "r_local.h"
+#include "d_local.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+
+#include <immintrin.h>
+
+#define D_AVX2 __attribute__((target("avx2")))
+
+static const int32_t d_lanes[8] = {0, 1, 2, 3, 4, 5, 6, 7};
+
+/*
+=============
+D_PackBytes
+
+Narrows the low byte of each of 8 dwords and stores them to pdest
+=============
+*/
+static inline D_AVX2 void D_PackBytes(uint8_t *pdest, __m256i v)
+{
+    __m128i lo, hi;
+
+    v = _mm256_and_si256(v, _mm256_set1_epi32(0xFF));
+    lo = _mm256_castsi256_si128(v);
+    hi = _mm256_extracti128_si256(v, 1);
+    lo = _mm_packus_epi32(lo, hi);
+    lo = _mm_packus_epi16(lo, lo);
+    _mm_storel_epi64((__m128i *)pdest, lo);
+}
+
+/*
+=============
+D_TurbSpan8_AVX2
+=============
+*/
+D_AVX2 void D_TurbSpan8_AVX2(uint8_t *pdest, uint8_t *pbase, int32_t *turb, fixed16_t s, fixed16_t t,
+                             fixed16_t sstep, fixed16_t tstep, int32_t count)
+{
+    __m256i vs, vt, vsstep8, vtstep8, lanes, cyclemask, texmask, st, tt, idx;
+    int32_t sturb, tturb;
+
+    lanes = _mm256_loadu_si256((const __m256i *)d_lanes);
+    vs = _mm256_add_epi32(_mm256_set1_epi32(s), _mm256_mullo_epi32(lanes, _mm256_set1_epi32(sstep)));
+    vt = _mm256_add_epi32(_mm256_set1_epi32(t), _mm256_mullo_epi32(lanes, _mm256_set1_epi32(tstep)));
+    vsstep8 = _mm256_set1_epi32(sstep * 8);
+    vtstep8 = _mm256_set1_epi32(tstep * 8);
+    cyclemask = _mm256_set1_epi32(CYCLE - 1);
+    texmask = _mm256_set1_epi32(63);
+
+    for (; count >= 8; count -= 8, pdest += 8)
+    {
+        st = _mm256_i32gather_epi32(turb, _mm256_and_si256(_mm256_srai_epi32(vt, 16), cyclemask), 4);
+        tt = _mm256_i32gather_epi32(turb, _mm256_and_si256(_mm256_srai_epi32(vs, 16), cyclemask), 4);
+        st = _mm256_and_si256(_mm256_srai_epi32(_mm256_add_epi32(vs, st), 16), texmask);
+        tt = _mm256_and_si256(_mm256_srai_epi32(_mm256_add_epi32(vt, tt), 16), texmask);
+        idx = _mm256_add_epi32(_mm256_slli_epi32(tt, 6), st);
+
+        // the 64x64 turbulent texture is followed by its smaller mips, so
+        // the three bytes read past the last texel are always mapped
+        D_PackBytes(pdest, _mm256_i32gather_epi32((const int *)pbase, idx, 1));
+
+        vs = _mm256_add_epi32(vs, vsstep8);
+        vt = _mm256_add_epi32(vt, vtstep8);
+    }
+
+    s = _mm256_extract_epi32(vs, 0);
+    t = _mm256_extract_epi32(vt, 0);
+
+    while (count-- > 0)
+    {
+        sturb = ((s + turb[(t >> 16) & (CYCLE - 1)]) >> 16) & 63;
+        tturb = ((t + turb[(s >> 16) & (CYCLE - 1)]) >> 16) & 63;
+        *pdest++ = *(pbase + (tturb << 6) + sturb);
+        s += sstep;
+        t += tstep;
+    }
+}
+
+/*
+=============
+D_SkySpan8_AVX2
+=============
+*/
+D_AVX2 void D_SkySpan8_AVX2(uint8_t *pdest, uint8_t *psky, fixed16_t s, fixed16_t t, fixed16_t sstep,
+                            fixed16_t tstep, int32_t count)
+{
+    __m256i vs, vt, vsstep8, vtstep8, lanes, smask, tmask, idx;
+
+    lanes = _mm256_loadu_si256((const __m256i *)d_lanes);
+    vs = _mm256_add_epi32(_mm256_set1_epi32(s), _mm256_mullo_epi32(lanes, _mm256_set1_epi32(sstep)));
+    vt = _mm256_add_epi32(_mm256_set1_epi32(t), _mm256_mullo_epi32(lanes, _mm256_set1_epi32(tstep)));
+    vsstep8 = _mm256_set1_epi32(sstep * 8);
+    vtstep8 = _mm256_set1_epi32(tstep * 8);
+    smask = _mm256_set1_epi32(R_SKY_SMASK);
+    tmask = _mm256_set1_epi32(R_SKY_TMASK);
+
+    for (; count >= 8; count -= 8, pdest += 8)
+    {
+        idx = _mm256_add_epi32(_mm256_srli_epi32(_mm256_and_si256(vt, tmask), 8),
+                               _mm256_srli_epi32(_mm256_and_si256(vs, smask), 16));
+        D_PackBytes(pdest, _mm256_i32gather_epi32((const int *)psky, idx, 1));
+
+        vs = _mm256_add_epi32(vs, vsstep8);
+        vt = _mm256_add_epi32(vt, vtstep8);
+    }
+
+    s = _mm256_extract_epi32(vs, 0);
+    t = _mm256_extract_epi32(vt, 0);
+
+    while (count-- > 0)
+    {
+        *pdest++ = psky[((t & R_SKY_TMASK) >> 8) + ((s & R_SKY_SMASK) >> 16)];
+        s += sstep;
+        t += tstep;
+    }
+}
+
+/*
+=============
+D_WarpRow8_AVX2
+=============
+*/
+D_AVX2 void D_WarpRow8_AVX2(uint8_t *pdest, uint8_t *pbase, int32_t *rowofs, int32_t *col, int32_t *turb,
+                            int32_t count)
+{
+    __m256i tu, ofs;
+    int32_t u;
+
+    for (u = 0; u + 8 <= count; u += 8)
+    {
+        tu = _mm256_loadu_si256((const __m256i *)(turb + u));
+        ofs = _mm256_i32gather_epi32(rowofs, tu, 4);
+        ofs = _mm256_add_epi32(ofs, _mm256_loadu_si256((const __m256i *)(col + u)));
+        D_PackBytes(pdest + u, _mm256_i32gather_epi32((const int *)pbase, ofs, 1));
+    }
+
+    for (; u < count; u++)
+        pdest[u] = pbase[rowofs[turb[u]] + col[u]];
+}
+
+/*
+=============
+D_SIMDAvailable
+=============
+*/
+bool D_SIMDAvailable(void)
+{
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+}
+
+#else
+
+bool D_SIMDAvailable(void)
+{
+    return false;
+}
+
+void D_TurbSpan8_AVX2(uint8_t *pdest, uint8_t *pbase, int32_t *turb, fixed16_t s, fixed16_t t, fixed16_t sstep,
+                      fixed16_t tstep, int32_t count)
+{
+    D_TurbSpan8(pdest, pbase, turb, s, t, sstep, tstep, count);
+}
+
+void D_SkySpan8_AVX2(uint8_t *pdest, uint8_t *psky, fixed16_t s, fixed16_t t, fixed16_t sstep, fixed16_t tstep,
+                     int32_t count)
+{
+    D_SkySpan8(pdest, psky, s, t, sstep, tstep, count);
+}
+
+void D_WarpRow8_AVX2(uint8_t *pdest, uint8_t *pbase, int32_t *rowofs, int32_t *col, int32_t *turb, int32_t count)
+{
+    D_WarpRow8(pdest, pbase, rowofs, col, turb, count);
+}
+
+#endif
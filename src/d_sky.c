@@ -36,6 +36,22 @@ static void D_Sky_uv_To_st(int32_t u, int32_t v, fixed16_t *s, fixed16_t *t)
     *t = (int32_t)((temp + 6 * (SKYSIZE / 2 - 1) * end[1]) * 0x10000);
 }
 
+/*
+=================
+D_SkySpan8
+=================
+*/
+void D_SkySpan8(uint8_t *pdest, uint8_t *psky, fixed16_t s, fixed16_t t, fixed16_t sstep, fixed16_t tstep,
+                int32_t count)
+{
+    do
+    {
+        *pdest++ = psky[((t & R_SKY_TMASK) >> 8) + ((s & R_SKY_SMASK) >> 16)];
+        s += sstep;
+        t += tstep;
+    } while (--count > 0);
+}
+
 /*
 =================
 D_DrawSkyScans8
@@ -98,12 +114,8 @@ void D_DrawSkyScans8(espan_t *pspan)
                 }
             }
 
-            do
-            {
-                *pdest++ = r_skysource[((t & R_SKY_TMASK) >> 8) + ((s & R_SKY_SMASK) >> 16)];
-                s += sstep;
-                t += tstep;
-            } while (--spancount > 0);
+            d_skyspan(pdest, r_skysource, s, t, sstep, tstep, spancount);
+            pdest += spancount;
 
             s = snext;
             t = tnext;
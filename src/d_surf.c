@@ -300,7 +300,9 @@ surfcache_t *D_CacheSurface(msurface_t *surface, int32_t miplevel)
     r_drawsurf.surf = surface;
 
     c_surf++;
+    PROF_BEGIN("D_CacheSurface");
     R_DrawSurface();
+    PROF_END();
 
     return surface->cachespots[miplevel];
 }
@@ -37,16 +37,17 @@ qpic_t *Draw_PicFromWad(char *name)
     return W_GetLumpName(name);
 }
 
+static qpic_t draw_nopic; // drawn as nothing while a pic is being read
+
 /*
 ================
-Draw_CachePic
+Draw_FindCachePic
 ================
 */
-qpic_t *Draw_CachePic(char *path)
+static cachepic_t *Draw_FindCachePic(char *path)
 {
     cachepic_t *pic;
     int32_t i;
-    qpic_t *dat;
 
     for (pic = menu_cachepics, i = 0; i < menu_numcachepics; pic++, i++)
         if (!strcmp(path, pic->name))
@@ -60,6 +61,65 @@ qpic_t *Draw_CachePic(char *path)
         strcpy(pic->name, path);
     }
 
+    return pic;
+}
+
+/*
+================
+Draw_CachePic
+
+A pic that has fallen out of the cache is read in the background, until
+it arrives an empty pic is returned so the frame carries on without it
+================
+*/
+qpic_t *Draw_CachePic(char *path)
+{
+    cachepic_t *pic;
+    qpic_t *dat;
+    uint8_t *data;
+    char base[32];
+
+    pic = Draw_FindCachePic(path);
+
+    dat = Cache_Check(&pic->cache);
+
+    if (dat)
+        return dat;
+
+    data = COM_AsyncLoad(path);
+    if (!data)
+    {
+        if (com_asyncpending)
+            return &draw_nopic;
+        Sys_Error("Draw_CachePic: failed to load %s", path);
+    }
+
+    COM_FileBase(path, base);
+    dat = Cache_Alloc(&pic->cache, com_filesize + 1, base, MEM_PICS);
+    if (!dat)
+        Sys_Error("Draw_CachePic: not enough space for %s", path);
+    memcpy(dat, data, com_filesize);
+    ((uint8_t *)dat)[com_filesize] = 0;
+
+    SwapPic(dat);
+
+    return dat;
+}
+
+/*
+================
+Draw_CachePicNow
+
+For the few pics that have to be drawn this frame
+================
+*/
+qpic_t *Draw_CachePicNow(char *path)
+{
+    cachepic_t *pic;
+    qpic_t *dat;
+
+    pic = Draw_FindCachePic(path);
+
     dat = Cache_Check(&pic->cache);
 
     if (dat)
@@ -504,7 +564,7 @@ void Draw_ConsoleBackground(int32_t lines)
     qpic_t *conback;
     char ver[100];
 
-    conback = Draw_CachePic("gfx/conback.lmp");
+    conback = Draw_CachePicNow("gfx/conback.lmp");
 
     dest = conback->data + 320 - 43 + 320 * 186;
     sprintf(ver, "%4.2f", VERSION);
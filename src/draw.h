@@ -19,3 +19,4 @@ void Draw_FadeScreen(void);
 void Draw_String(int32_t x, int32_t y, char *str);
 qpic_t *Draw_PicFromWad(char *name);
 qpic_t *Draw_CachePic(char *path);
+qpic_t *Draw_CachePicNow(char *path);
@@ -24,6 +24,10 @@ double realtime;    // without any filtering or bounding
 static double oldrealtime; // last frame run
 int32_t host_framecount;
 
+bool host_fixedtick;            // local server runs on its own clock
+static double host_tickaccum;   // simulation time not yet run by the server
+static double host_cmdaccum;    // time since the last move was sent
+
 static int32_t host_hunklevel;
 
 int32_t minimum_memory;
@@ -37,6 +41,8 @@ uint8_t *host_colormap;
 
 static cvar_t host_framerate = {"host_framerate", "0"}; // set for slow motion
 static cvar_t host_speeds = {"host_speeds", "0"};       // set for running times
+static cvar_t host_maxfps = {"host_maxfps", "72", true}; // 0 = uncapped
+static cvar_t host_tickrate = {"host_tickrate", "72"};   // server frames per second
 
 cvar_t sys_ticrate = {"sys_ticrate", "0.05"};
 static cvar_t serverprofile = {"serverprofile", "0"};
@@ -184,9 +190,12 @@ Host_InitLocal
 void Host_InitLocal(void)
 {
     Host_InitCommands();
+    Sys_InitCommands();
 
     Cvar_RegisterVariable(&host_framerate);
     Cvar_RegisterVariable(&host_speeds);
+    Cvar_RegisterVariable(&host_maxfps);
+    Cvar_RegisterVariable(&host_tickrate);
 
     Cvar_RegisterVariable(&sys_ticrate);
     Cvar_RegisterVariable(&serverprofile);
@@ -449,6 +458,7 @@ void Host_ClearMemory(void)
 {
     Con_DPrintf("Clearing memory\n");
     D_FlushCaches();
+    Hunk_AbortRetained(); // a Host_Error may have cut a model load short
     Mod_ClearAll();
     if (host_hunklevel)
         Hunk_FreeToLowMark(host_hunklevel);
@@ -464,32 +474,75 @@ void Host_ClearMemory(void)
 ===================
 Host_FilterTime
 
-Returns false if the time is too int16_t to run a frame
+Returns false if the time is too short to run a frame
+
+host_maxfps only limits how often the screen is drawn.  When it is above
+host_tickrate (or 0) a local server is stepped at exactly host_tickrate and
+the client interpolates between its updates, otherwise the server runs once
+per frame as it always has.
 ===================
 */
+static float Host_MaxFPS(void)
+{
+    float maxfps;
+
+    maxfps = host_maxfps.value;
+    if (cls.state == ca_dedicated && (maxfps <= 0 || maxfps > host_tickrate.value))
+        maxfps = host_tickrate.value; // nothing to draw, so don't spin
+
+    return maxfps;
+}
+
 bool Host_FilterTime(float time)
 {
+    float maxfps;
+
     realtime += time;
 
-    if (!cls.timedemo && realtime - oldrealtime < 1.0 / 72.0)
+    // the first frame runs straight away rather than a whole tick after startup
+    maxfps = Host_MaxFPS();
+    if (!cls.timedemo && maxfps > 0 && host_framecount && realtime - oldrealtime < 1.0 / maxfps)
         return false; // framerate is too high
 
     host_frametime = realtime - oldrealtime;
     oldrealtime = realtime;
 
+    host_fixedtick = host_tickrate.value > 0 && (maxfps <= 0 || maxfps > host_tickrate.value);
+
     if (host_framerate.value > 0)
         host_frametime = host_framerate.value;
     else
     { // don't allow really long or short frames
         if (host_frametime > 0.1)
             host_frametime = 0.1;
-        if (host_frametime < 0.001)
-            host_frametime = 0.001;
+        if (host_frametime < 0.0001)
+            host_frametime = 0.0001;
     }
 
     return true;
 }
 
+/*
+===================
+Host_FrameWait
+
+Returns how many seconds after the last Host_Frame call the next frame is
+due, or 0 if it should run as soon as possible
+===================
+*/
+double Host_FrameWait(void)
+{
+    float maxfps;
+    double wait;
+
+    maxfps = Host_MaxFPS();
+    if (cls.timedemo || maxfps <= 0 || !host_framecount)
+        return 0;
+
+    wait = oldrealtime + 1.0 / maxfps - realtime;
+    return wait > 0 ? wait : 0;
+}
+
 /*
 ===================
 Host_GetConsoleCommands
@@ -518,6 +571,9 @@ Host_ServerFrame
 */
 void Host_ServerFrame(void)
 {
+    PROF_BEGIN("Host_ServerFrame");
+    HWPERF_BEGIN(HWP_SERVER);
+
     // run the world state
     pr_global_struct->frametime = host_frametime;
 
@@ -537,6 +593,141 @@ void Host_ServerFrame(void)
 
     // send all messages to the clients
     SV_SendClientMessages();
+
+    HWPERF_END(HWP_SERVER);
+    PROF_END();
+}
+
+/*
+==================
+Host_RunServer
+
+Runs the local server for this frame, sending a move ahead of every server
+frame so the server always has fresh intentions to act on
+==================
+*/
+static void Host_RunServer(void)
+{
+    double frametime, tick;
+
+    if (!host_fixedtick)
+    {
+        host_tickaccum = 0;
+        CL_SendCmd();
+        Host_ServerFrame();
+        return;
+    }
+
+    frametime = host_frametime;
+    tick = 1.0 / host_tickrate.value;
+
+    host_tickaccum += frametime;
+    host_frametime = tick;
+    while (host_tickaccum >= tick && sv.active)
+    {
+        host_tickaccum -= tick;
+        CL_SendCmd();
+        Host_ServerFrame();
+    }
+    host_frametime = frametime;
+}
+
+/*
+==================
+Host_CmdDue
+
+Returns true when a client talking to a remote server should send a move
+==================
+*/
+static bool Host_CmdDue(void)
+{
+    double interval;
+
+    if (cl_cmdrate.value <= 0 || cls.state != ca_connected)
+        return true;
+
+    interval = 1.0 / cl_cmdrate.value;
+    host_cmdaccum += host_frametime;
+    if (host_cmdaccum < interval)
+        return false;
+
+    host_cmdaccum -= interval;
+    if (host_cmdaccum > interval)
+        host_cmdaccum = 0; // a long frame, don't try to catch up
+    return true;
+}
+
+/*
+===============================================================================
+
+STARTUP TRACE
+
+-startuptrace times each step of Host_Init and the first frame, and prints
+them once that frame is done.
+
+===============================================================================
+*/
+#define MAX_STARTUP_STEPS 48
+
+typedef struct
+{
+    char *name;
+    double time;
+} startupstep_t;
+
+static bool host_startuptrace;
+static startupstep_t host_startupsteps[MAX_STARTUP_STEPS];
+static int32_t host_numstartupsteps;
+static double host_startuptime, host_stepstart;
+
+/*
+================
+Host_StartupStep
+
+Ends the step named, the next one starts now
+================
+*/
+static void Host_StartupStep(char *name)
+{
+    double now;
+
+    if (!host_startuptrace)
+        return;
+
+    now = Sys_FloatTime();
+    if (host_numstartupsteps < MAX_STARTUP_STEPS)
+    {
+        host_startupsteps[host_numstartupsteps].name = name;
+        host_startupsteps[host_numstartupsteps].time = now - host_stepstart;
+        host_numstartupsteps++;
+    }
+    host_stepstart = now;
+}
+
+// runs an init call as a step of its own
+#define HOST_STEP(call)          \
+    do                           \
+    {                            \
+        call;                    \
+        Host_StartupStep(#call); \
+    } while (0)
+
+/*
+================
+Host_StartupReport
+================
+*/
+static void Host_StartupReport(void)
+{
+    int32_t i;
+
+    Host_StartupStep("first frame");
+    host_startuptrace = false;
+
+    Con_Printf("startup trace:\n");
+    for (i = 0; i < host_numstartupsteps; i++)
+        Con_Printf("%8.2f ms  %s\n", host_startupsteps[i].time * 1000, host_startupsteps[i].name);
+    Con_Printf("%8.2f ms  from Host_Init to the end of the first frame\n", (host_stepstart - host_startuptime) * 1000);
 }
 
 /*
@@ -563,6 +754,8 @@ void _Host_Frame(float time)
     if (!Host_FilterTime(time))
         return; // don't run too fast, or packets will flood out
 
+    Prof_BeginFrame();
+
     // get new key events
     Sys_SendKeyEvents();
 
@@ -574,9 +767,8 @@ void _Host_Frame(float time)
 
     NET_Poll();
 
-    // if running the server locally, make intentions now
-    if (sv.active)
-        CL_SendCmd();
+    // turn the view and gather movement every frame, however often it is sent
+    CL_AccumulateCmd();
 
     //-------------------
     //
@@ -587,8 +779,9 @@ void _Host_Frame(float time)
     // check for commands typed to the host
     Host_GetConsoleCommands();
 
+    // if running the server locally, make intentions before each server frame
     if (sv.active)
-        Host_ServerFrame();
+        Host_RunServer();
 
     //-------------------
     //
@@ -598,7 +791,7 @@ void _Host_Frame(float time)
 
     // if running the server remotely, send intentions now after
     // the incoming messages have been read
-    if (!sv.active)
+    if (!sv.active && Host_CmdDue())
         CL_SendCmd();
 
     host_time += host_frametime;
@@ -606,19 +799,26 @@ void _Host_Frame(float time)
     // fetch results from server
     if (cls.state == ca_connected)
     {
+        PROF_BEGIN("CL_ReadFromServer");
+        HWPERF_BEGIN(HWP_CLPARSE);
         CL_ReadFromServer();
+        HWPERF_END(HWP_CLPARSE);
+        PROF_END();
     }
 
     // update video
     if (host_speeds.value)
         time1 = Sys_FloatTime();
 
+    PROF_BEGIN("SCR_UpdateScreen");
     SCR_UpdateScreen();
+    PROF_END();
 
     if (host_speeds.value)
         time2 = Sys_FloatTime();
 
     // update audio
+    PROF_BEGIN("S_Update");
     if (cls.signon == SIGNONS)
     {
         S_Update(r_origin, vpn, vright, vup);
@@ -626,6 +826,7 @@ void _Host_Frame(float time)
     }
     else
         S_Update(vec3_origin, vec3_origin, vec3_origin, vec3_origin);
+    PROF_END();
 
     CDAudio_Update();
 
@@ -638,6 +839,13 @@ void _Host_Frame(float time)
         Con_Printf("%3i tot %3i server %3i gfx %3i snd\n", pass1 + pass2 + pass3, pass1, pass2, pass3);
     }
 
+    Prof_EndFrame();
+    Counter_EndFrame();
+    HWPerf_EndFrame();
+
+    if (host_startuptrace)
+        Host_StartupReport();
+
     host_framecount++;
 }
 
@@ -764,54 +972,72 @@ void Host_Init(quakeparms_t *parms)
     com_argc = parms->argc;
     com_argv = parms->argv;
 
-    Memory_Init(parms->membase, parms->memsize);
-    Cbuf_Init();
-    Cmd_Init();
-    V_Init();
-    Chase_Init();
-    Host_InitVCR(parms);
-    COM_Init(parms->basedir);
-    Host_InitLocal();
-    W_LoadWadFile("gfx.wad");
-    Key_Init();
-    Con_Init();
-    M_Init();
-    PR_Init();
-    Mod_Init();
-    NET_Init();
-    SV_Init();
+    host_startuptrace = COM_CheckParm("-startuptrace") != 0;
+    host_startuptime = host_stepstart = Sys_FloatTime();
+
+    HOST_STEP(Memory_Init(parms->membase, parms->memsize));
+    HOST_STEP(Cbuf_Init());
+    HOST_STEP(Cmd_Init());
+    HOST_STEP(V_Init());
+    HOST_STEP(Chase_Init());
+    HOST_STEP(Host_InitVCR(parms));
+    HOST_STEP(COM_Init(parms->basedir));
+    HOST_STEP(Tasks_Init());
+    HOST_STEP(Prof_Init());
+    HOST_STEP(Counter_Init());
+    HOST_STEP(HWPerf_Init());
+    HOST_STEP(Host_InitLocal());
+    HOST_STEP(Key_Init());
+    HOST_STEP(Con_Init());
+    HOST_STEP(M_Init());
+    HOST_STEP(PR_Init());
+    HOST_STEP(Mod_Init());
+    HOST_STEP(NET_Init());
+    HOST_STEP(SV_Init());
 
     Con_Printf("Exe: "__TIME__
                " "__DATE__
                "\n");
-    Con_Printf("%4.1f megabyte heap\n", parms->memsize / (1024 * 1024.0));
+    Con_Printf("%4.1f megabyte heap reserved\n", parms->memsize / (1024 * 1024.0));
 
-    R_InitTextures(); // needed even for dedicated servers
+    HOST_STEP(R_InitTextures()); // needed even for dedicated servers
 
     if (cls.state != ca_dedicated)
     {
+        // opening the audio device can take as long as opening the window,
+        // so it is started first and the two overlap
+        S_BeginInit();
+
+        // only the client draws anything from the wad
+        HOST_STEP(W_LoadWadFile("gfx.wad"));
+
         host_basepal = (uint8_t *)COM_LoadHunkFile("gfx/palette.lmp");
         if (!host_basepal)
             Sys_Error("Couldn't load gfx/palette.lmp");
         host_colormap = (uint8_t *)COM_LoadHunkFile("gfx/colormap.lmp");
         if (!host_colormap)
             Sys_Error("Couldn't load gfx/colormap.lmp");
-
-        IN_Init();
-        VID_Init(host_basepal);
-        Draw_Init();
-        SCR_Init();
-        R_Init();
-        S_Init();
-        CDAudio_Init();
-        Sbar_Init();
-        CL_Init();
+        Host_StartupStep("palette and colormap");
+
+        HOST_STEP(IN_Init());
+        Memory_SetCategory(MEM_RENDER);
+        HOST_STEP(VID_Init(host_basepal));
+        HOST_STEP(Draw_Init());
+        HOST_STEP(SCR_Init());
+        HOST_STEP(R_Init());
+        Memory_SetCategory(MEM_SOUNDS);
+        HOST_STEP(S_Init());
+        Memory_SetCategory(MEM_MISC);
+        HOST_STEP(CDAudio_Init());
+        HOST_STEP(Sbar_Init());
+        HOST_STEP(CL_Init());
     }
 
     Cbuf_InsertText("exec quake.rc\n");
 
     Hunk_AllocName(0, "-HOST_HUNKLEVEL-");
     host_hunklevel = Hunk_LowMark();
+    Host_StartupStep("the rest");
 
     host_initialized = true;
 
@@ -846,6 +1072,8 @@ void Host_Shutdown(void)
     NET_Shutdown();
     S_Shutdown();
     IN_Shutdown();
+    Image_Shutdown();
+    Tasks_Shutdown();
 
     if (cls.state != ca_dedicated)
     {
@@ -0,0 +1,285 @@
+// hwperf.c -- hardware performance counters per engine subsystem
+
+#include "quakedef.h"
+
+bool hwperf_active;
+
+static cvar_t hwperf_show = {"hwperf_show", "0"};
+
+#ifdef __linux__
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#define HWP_NUMEVENTS 4
+
+typedef struct
+{
+    uint64_t v[HWP_NUMEVENTS];
+} hwcounts_t;
+
+static char *hwp_scopenames[HWP_NUMSCOPES] = {"server", "clparse", "render", "surfaces", "mixer", "qc"};
+
+static struct
+{
+    char *name;
+    uint64_t config;
+} hwp_events[HWP_NUMEVENTS] = {
+    {"cycles", PERF_COUNT_HW_CPU_CYCLES},
+    {"instructions", PERF_COUNT_HW_INSTRUCTIONS},
+    {"llc misses", PERF_COUNT_HW_CACHE_MISSES},
+    {"branch misses", PERF_COUNT_HW_BRANCH_MISSES},
+};
+
+static int hwp_leader = -1;            // group leader, read returns every member
+static int32_t hwp_slot[HWP_NUMEVENTS]; // position in the group read, -1 if it couldn't be opened
+static int32_t hwp_numopen;
+
+static hwcounts_t hwp_start[HWP_NUMSCOPES];
+static int32_t hwp_depth[HWP_NUMSCOPES];
+static hwcounts_t hwp_frame[HWP_NUMSCOPES];
+static hwcounts_t hwp_total[HWP_NUMSCOPES];
+static int32_t hwp_totalframes;
+
+/*
+================
+HWPerf_Read
+================
+*/
+static void HWPerf_Read(hwcounts_t *c)
+{
+    uint64_t buf[1 + HWP_NUMEVENTS];
+    int32_t i;
+
+    if (read(hwp_leader, buf, sizeof(buf)) < (ssize_t)((1 + hwp_numopen) * sizeof(uint64_t)))
+    {
+        memset(c, 0, sizeof(*c));
+        return;
+    }
+
+    for (i = 0; i < HWP_NUMEVENTS; i++)
+        c->v[i] = hwp_slot[i] >= 0 ? buf[1 + hwp_slot[i]] : 0;
+}
+
+/*
+================
+HWPerf_Begin
+================
+*/
+void HWPerf_Begin(hwscope_t scope)
+{
+    if (hwp_depth[scope]++)
+        return;
+
+    HWPerf_Read(&hwp_start[scope]);
+}
+
+/*
+================
+HWPerf_End
+================
+*/
+void HWPerf_End(hwscope_t scope)
+{
+    hwcounts_t now;
+    int32_t i;
+
+    if (!hwp_depth[scope] || --hwp_depth[scope])
+        return;
+
+    HWPerf_Read(&now);
+    for (i = 0; i < HWP_NUMEVENTS; i++)
+        hwp_frame[scope].v[i] += now.v[i] - hwp_start[scope].v[i];
+}
+
+/*
+================
+HWPerf_EndFrame
+================
+*/
+void HWPerf_EndFrame(void)
+{
+    int32_t s, i;
+    hwcounts_t *c;
+    char line[256];
+    int32_t len;
+
+    if (!hwperf_active)
+        return;
+
+    len = 0;
+    for (s = 0; s < HWP_NUMSCOPES; s++)
+    {
+        c = &hwp_frame[s];
+        for (i = 0; i < HWP_NUMEVENTS; i++)
+            hwp_total[s].v[i] += c->v[i];
+
+        if (hwperf_show.value && c->v[0] && len < (int32_t)sizeof(line))
+            len += snprintf(line + len, sizeof(line) - len, "%s %.2fM %.2f ", hwp_scopenames[s], c->v[0] / 1e6,
+                            (double)c->v[1] / c->v[0]);
+
+        // a Host_Error longjmp can leave scopes open
+        hwp_depth[s] = 0;
+    }
+    hwp_totalframes++;
+
+    if (len)
+        Con_Printf("%s\n", line);
+
+    memset(hwp_frame, 0, sizeof(hwp_frame));
+}
+
+/*
+================
+HWPerf_PrintTotals
+================
+*/
+static void HWPerf_PrintTotals(void)
+{
+    int32_t s;
+    hwcounts_t *c;
+    double frames, kinst;
+
+    if (!hwp_totalframes)
+        return;
+
+    frames = hwp_totalframes;
+    Con_Printf("%i frames, per frame:\n", hwp_totalframes);
+    Con_Printf("scope     Mcycles    IPC  LLC MPKI  br MPKI\n");
+    for (s = 0; s < HWP_NUMSCOPES; s++)
+    {
+        c = &hwp_total[s];
+        kinst = c->v[1] / 1000.0;
+        if (!c->v[0] || !kinst)
+            continue;
+
+        Con_Printf("%-8s %8.2f %6.2f %9.2f %8.2f\n", hwp_scopenames[s], c->v[0] / 1e6 / frames,
+                   (double)c->v[1] / c->v[0], c->v[2] / kinst, c->v[3] / kinst);
+    }
+}
+
+/*
+================
+HWPerf_TimeDemoSummary
+================
+*/
+void HWPerf_TimeDemoSummary(void)
+{
+    if (!hwperf_active)
+        return;
+
+    HWPerf_PrintTotals();
+}
+
+/*
+================
+HWPerf_ResetTotals
+================
+*/
+void HWPerf_ResetTotals(void)
+{
+    memset(hwp_total, 0, sizeof(hwp_total));
+    hwp_totalframes = 0;
+}
+
+/*
+================
+HWPerf_f
+================
+*/
+static void HWPerf_f(void)
+{
+    if (!hwperf_active)
+    {
+        Con_Printf("hardware counters are not running, start with -hwperf\n");
+        return;
+    }
+
+    HWPerf_PrintTotals();
+    HWPerf_ResetTotals();
+}
+
+/*
+================
+HWPerf_Open
+================
+*/
+static int HWPerf_Open(uint64_t config, int group)
+{
+    struct perf_event_attr attr;
+
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = config;
+    attr.disabled = group == -1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_GROUP;
+
+    // this thread only, on whatever cpu it runs on
+    return (int)syscall(__NR_perf_event_open, &attr, 0, -1, group, 0);
+}
+
+/*
+================
+HWPerf_Init
+================
+*/
+void HWPerf_Init(void)
+{
+    int32_t i;
+    int fd;
+
+    Cvar_RegisterVariable(&hwperf_show);
+    Cmd_AddCommand("hwperf", HWPerf_f);
+
+    if (!COM_CheckParm("-hwperf"))
+        return;
+
+    for (i = 0; i < HWP_NUMEVENTS; i++)
+    {
+        hwp_slot[i] = -1;
+        fd = HWPerf_Open(hwp_events[i].config, hwp_leader);
+        if (fd == -1)
+        {
+            Con_Printf("hwperf: no %s counter\n", hwp_events[i].name);
+            continue;
+        }
+        if (hwp_leader == -1)
+            hwp_leader = fd;
+        hwp_slot[i] = hwp_numopen++;
+    }
+
+    if (hwp_leader == -1)
+    {
+        Con_Printf("hwperf: perf_event_open failed, check /proc/sys/kernel/perf_event_paranoid\n");
+        return;
+    }
+
+    ioctl(hwp_leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(hwp_leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+
+    hwperf_active = true;
+    Con_Printf("hwperf: %d hardware counters\n", hwp_numopen);
+}
+
+#else
+
+void HWPerf_Begin(hwscope_t scope) {}
+void HWPerf_End(hwscope_t scope) {}
+void HWPerf_EndFrame(void) {}
+void HWPerf_TimeDemoSummary(void) {}
+void HWPerf_ResetTotals(void) {}
+
+void HWPerf_Init(void)
+{
+    Cvar_RegisterVariable(&hwperf_show);
+
+    if (COM_CheckParm("-hwperf"))
+        Con_Printf("hwperf: hardware counters are only available on Linux\n");
+}
+
+#endif
@@ -0,0 +1,50 @@
+/*
+ hwperf.h -- hardware performance counters per engine subsystem
+
+HWPerf_??? With -hwperf on the command line, the CPU's cycle, instruction,
+last level cache miss and branch miss counters are opened through Linux
+perf_event_open for the main thread.  Each subsystem scope reads them on
+entry and exit, so the counts are inclusive of any scopes nested inside.
+A scope that is re-entered while already open (QuakeC calling back into
+QuakeC) is only counted at its outermost level.
+
+hwperf_show 1 prints a line per frame, the hwperf command prints the totals
+since the last time it was used, and a timedemo prints the totals for the
+demo when it finishes.  Everything compiles to nothing useful on other
+systems and HWPerf_Init says so.
+*/
+
+typedef enum
+{
+    HWP_SERVER,
+    HWP_CLPARSE,
+    HWP_RENDER,
+    HWP_SURFACES,
+    HWP_MIXER,
+    HWP_QC,
+    HWP_NUMSCOPES
+} hwscope_t;
+
+extern bool hwperf_active;
+
+void HWPerf_Init(void);
+void HWPerf_Begin(hwscope_t scope);
+void HWPerf_End(hwscope_t scope);
+
+void HWPerf_EndFrame(void);
+void HWPerf_TimeDemoSummary(void);
+void HWPerf_ResetTotals(void);
+
+#define HWPERF_BEGIN(scope)         \
+    do                              \
+    {                               \
+        if (hwperf_active)          \
+            HWPerf_Begin(scope);    \
+    } while (0)
+
+#define HWPERF_END(scope)           \
+    do                              \
+    {                               \
+        if (hwperf_active)          \
+            HWPerf_End(scope);      \
+    } while (0)
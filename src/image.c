@@ -0,0 +1,557 @@
+// image.c -- 8 bit image file encoding
+//
+// Screenshots are copied out of the frame buffer on the main thread and then
+// encoded and written by a dedicated thread, so taking one (or a burst of
+// them) never stalls a frame on compression or disk.
+
+#include <pthread.h>
+
+#include "quakedef.h"
+
+#define MAX_PENDING_IMAGES 32
+
+typedef struct imagejob_s
+{
+    struct imagejob_s *next;
+    char path[MAX_OSPATH];
+    char name[MAX_QPATH];
+    imageformat_t format;
+    int32_t width, height;
+    bool failed;
+    uint8_t palette[768];
+    uint8_t pixels[4]; // width*height, packed
+} imagejob_t;
+
+static pthread_t image_thread;
+static bool image_threadstarted;
+static bool image_shutdown;
+
+static pthread_mutex_t image_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t image_wake = PTHREAD_COND_INITIALIZER;  // a job was queued
+static pthread_cond_t image_space = PTHREAD_COND_INITIALIZER; // a job was finished
+
+static imagejob_t *image_queue, **image_queuetail = &image_queue;
+static imagejob_t *image_done;
+static int32_t image_pending;
+
+/*
+==============================================================================
+
+PCX
+
+==============================================================================
+*/
+
+typedef struct
+{
+    char manufacturer;
+    char version;
+    char encoding;
+    char bits_per_pixel;
+    uint16_t xmin, ymin, xmax, ymax;
+    uint16_t hres, vres;
+    unsigned char palette[48];
+    char reserved;
+    char color_planes;
+    uint16_t bytes_per_line;
+    uint16_t palette_type;
+    char filler[58];
+    unsigned char data; // unbounded
+} pcx_t;
+
+/*
+==============
+Image_EncodePCX
+==============
+*/
+uint8_t *Image_EncodePCX(uint8_t *pixels, int32_t width, int32_t height, int32_t rowbytes, uint8_t *palette,
+                         int32_t *length)
+{
+    int32_t i, j;
+    pcx_t *pcx;
+    uint8_t *pack;
+
+    pcx = malloc(width * height * 2 + 1000);
+    if (pcx == NULL)
+        return NULL;
+
+    memset(pcx, 0, sizeof(*pcx));
+    pcx->manufacturer = 0x0a; // PCX id
+    pcx->version = 5;         // 256 color
+    pcx->encoding = 1;        // uncompressed
+    pcx->bits_per_pixel = 8;  // 256 color
+    pcx->xmin = 0;
+    pcx->ymin = 0;
+    pcx->xmax = ((int16_t)(width - 1));
+    pcx->ymax = ((int16_t)(height - 1));
+    pcx->hres = ((int16_t)width);
+    pcx->vres = ((int16_t)height);
+    pcx->color_planes = 1; // chunky image
+    pcx->bytes_per_line = ((int16_t)width);
+    pcx->palette_type = (2); // not a grey scale
+
+    // pack the image
+    pack = &pcx->data;
+
+    for (i = 0; i < height; i++)
+    {
+        for (j = 0; j < width; j++)
+        {
+            if ((*pixels & 0xc0) != 0xc0)
+                *pack++ = *pixels++;
+            else
+            {
+                *pack++ = 0xc1;
+                *pack++ = *pixels++;
+            }
+        }
+
+        pixels += rowbytes - width;
+    }
+
+    // write the palette
+    *pack++ = 0x0c; // palette ID byte
+    for (i = 0; i < 768; i++)
+        *pack++ = *palette++;
+
+    *length = pack - (uint8_t *)pcx;
+    return (uint8_t *)pcx;
+}
+
+/*
+==============================================================================
+
+PNG
+
+The image data is compressed with a single fixed huffman deflate block and a
+one entry per hash LZ77 matcher.  That gets most of the way to zlib's default
+level on game screens at a fraction of the code.
+
+==============================================================================
+*/
+
+#define DEFLATE_WINDOW 32768
+#define DEFLATE_HASHBITS 14
+#define DEFLATE_MINMATCH 3
+#define DEFLATE_MAXMATCH 258
+
+typedef struct
+{
+    uint8_t *out;
+    int32_t outlen;
+    uint32_t bits;
+    int32_t numbits;
+} bitwriter_t;
+
+static const uint16_t len_base[29] = {3,  4,  5,  6,  7,  8,  9,  10, 11,  13,  15,  17,  19,  23, 27,
+                                      31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+static const uint8_t len_extra[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2,
+                                      2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+static const uint16_t dist_base[30] = {1,   2,   3,   4,   5,   7,    9,    13,   17,   25,   33,    49,    65,    97,    129,
+                                       193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+static const uint8_t dist_extra[30] = {0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6,
+                                       6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+
+static void Deflate_PutBits(bitwriter_t *bw, uint32_t value, int32_t count)
+{
+    bw->bits |= value << bw->numbits;
+    bw->numbits += count;
+    while (bw->numbits >= 8)
+    {
+        bw->out[bw->outlen++] = bw->bits & 0xff;
+        bw->bits >>= 8;
+        bw->numbits -= 8;
+    }
+}
+
+// huffman codes go out most significant bit first
+static void Deflate_PutCode(bitwriter_t *bw, uint32_t code, int32_t count)
+{
+    uint32_t rev;
+    int32_t i;
+
+    for (i = 0, rev = 0; i < count; i++)
+        rev |= ((code >> i) & 1) << (count - 1 - i);
+    Deflate_PutBits(bw, rev, count);
+}
+
+static void Deflate_PutSymbol(bitwriter_t *bw, int32_t sym)
+{
+    if (sym < 144)
+        Deflate_PutCode(bw, 0x30 + sym, 8);
+    else if (sym < 256)
+        Deflate_PutCode(bw, 0x190 + sym - 144, 9);
+    else if (sym < 280)
+        Deflate_PutCode(bw, sym - 256, 7);
+    else
+        Deflate_PutCode(bw, 0xc0 + sym - 280, 8);
+}
+
+static void Deflate_PutMatch(bitwriter_t *bw, int32_t length, int32_t dist)
+{
+    int32_t i;
+
+    for (i = 28; len_base[i] > length; i--)
+        ;
+    Deflate_PutSymbol(bw, 257 + i);
+    Deflate_PutBits(bw, length - len_base[i], len_extra[i]);
+
+    for (i = 29; dist_base[i] > dist; i--)
+        ;
+    Deflate_PutCode(bw, i, 5);
+    Deflate_PutBits(bw, dist - dist_base[i], dist_extra[i]);
+}
+
+/*
+==============
+Image_Deflate
+
+Writes a zlib stream for in into out, which must hold at least
+len + len / 8 + 64 bytes.  Returns the compressed length, or -1 if out
+of memory.
+==============
+*/
+static int32_t Image_Deflate(uint8_t *in, int32_t len, uint8_t *out)
+{
+    int32_t *head;
+    bitwriter_t bw;
+    uint32_t a, b, h;
+    int32_t i, j, cand, length, maxlen;
+
+    head = malloc(sizeof(*head) << DEFLATE_HASHBITS);
+    if (!head)
+        return -1;
+
+    bw.out = out;
+    bw.outlen = 0;
+    bw.bits = 0;
+    bw.numbits = 0;
+
+    Deflate_PutBits(&bw, 0x78, 8); // 32k window, deflate
+    Deflate_PutBits(&bw, 0x01, 8); // no dictionary, fastest
+    Deflate_PutBits(&bw, 1, 1);    // final block
+    Deflate_PutBits(&bw, 1, 2);    // fixed huffman codes
+
+    for (i = 0; i < (1 << DEFLATE_HASHBITS); i++)
+        head[i] = -DEFLATE_WINDOW - 1;
+
+    i = 0;
+    while (i < len)
+    {
+        length = 0;
+        if (i + DEFLATE_MINMATCH <= len)
+        {
+            h = ((in[i] << 16) | (in[i + 1] << 8) | in[i + 2]) * 2654435761u >> (32 - DEFLATE_HASHBITS);
+            cand = head[h];
+            head[h] = i;
+
+            if (i - cand <= DEFLATE_WINDOW - 1 && cand >= 0)
+            {
+                maxlen = len - i;
+                if (maxlen > DEFLATE_MAXMATCH)
+                    maxlen = DEFLATE_MAXMATCH;
+                while (length < maxlen && in[cand + length] == in[i + length])
+                    length++;
+            }
+        }
+
+        if (length >= DEFLATE_MINMATCH)
+        {
+            Deflate_PutMatch(&bw, length, i - cand);
+
+            // keep the hash chain fed through the match
+            for (j = i + 1; j < i + length && j + DEFLATE_MINMATCH <= len; j++)
+            {
+                h = ((in[j] << 16) | (in[j + 1] << 8) | in[j + 2]) * 2654435761u >> (32 - DEFLATE_HASHBITS);
+                head[h] = j;
+            }
+            i += length;
+        }
+        else
+        {
+            Deflate_PutSymbol(&bw, in[i]);
+            i++;
+        }
+    }
+
+    free(head);
+
+    Deflate_PutSymbol(&bw, 256); // end of block
+    if (bw.numbits)
+        Deflate_PutBits(&bw, 0, 8 - bw.numbits);
+
+    // adler32 of the uncompressed data
+    a = 1;
+    b = 0;
+    for (i = 0; i < len; i++)
+    {
+        a = (a + in[i]) % 65521;
+        b = (b + a) % 65521;
+    }
+    out[bw.outlen++] = b >> 8;
+    out[bw.outlen++] = b;
+    out[bw.outlen++] = a >> 8;
+    out[bw.outlen++] = a;
+
+    return bw.outlen;
+}
+
+static uint8_t *PNG_PutLong(uint8_t *p, uint32_t l)
+{
+    p[0] = l >> 24;
+    p[1] = l >> 16;
+    p[2] = l >> 8;
+    p[3] = l;
+    return p + 4;
+}
+
+static uint8_t *PNG_PutChunk(uint8_t *p, char *type, uint8_t *data, int32_t len)
+{
+    uint32_t crc;
+
+    p = PNG_PutLong(p, len);
+    memcpy(p, type, 4);
+    if (len && data != p + 4)
+        memmove(p + 4, data, len);
+    crc = CRC32_Block(0, p, len + 4);
+    return PNG_PutLong(p + 4 + len, crc);
+}
+
+/*
+==============
+Image_EncodePNG
+==============
+*/
+uint8_t *Image_EncodePNG(uint8_t *pixels, int32_t width, int32_t height, int32_t rowbytes, uint8_t *palette,
+                         int32_t *length)
+{
+    static const uint8_t signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+    uint8_t ihdr[13];
+    uint8_t *raw, *png, *p;
+    int32_t i, rawlen, zlen;
+
+    // every scanline starts with a filter type byte, always 0 (none) here
+    rawlen = (width + 1) * height;
+    raw = malloc(rawlen);
+    png = malloc(rawlen + rawlen / 8 + 1024);
+    if (!raw || !png)
+    {
+        free(raw);
+        free(png);
+        return NULL;
+    }
+
+    for (i = 0; i < height; i++)
+    {
+        raw[i * (width + 1)] = 0;
+        memcpy(raw + i * (width + 1) + 1, pixels + i * rowbytes, width);
+    }
+
+    p = png;
+    memcpy(p, signature, 8);
+    p += 8;
+
+    PNG_PutLong(ihdr, width);
+    PNG_PutLong(ihdr + 4, height);
+    ihdr[8] = 8;  // bit depth
+    ihdr[9] = 3;  // palette color
+    ihdr[10] = 0; // deflate
+    ihdr[11] = 0; // adaptive filtering
+    ihdr[12] = 0; // not interlaced
+    p = PNG_PutChunk(p, "IHDR", ihdr, sizeof(ihdr));
+    p = PNG_PutChunk(p, "PLTE", palette, 768);
+
+    // compress straight into place after the chunk header
+    zlen = Image_Deflate(raw, rawlen, p + 8);
+    if (zlen < 0)
+    {
+        free(raw);
+        free(png);
+        return NULL;
+    }
+    p = PNG_PutChunk(p, "IDAT", p + 8, zlen);
+    p = PNG_PutChunk(p, "IEND", NULL, 0);
+
+    free(raw);
+
+    *length = p - png;
+    return png;
+}
+
+/*
+==============================================================================
+
+ENCODER THREAD
+
+==============================================================================
+*/
+
+/*
+==============
+Image_WriteJob
+==============
+*/
+static void Image_WriteJob(imagejob_t *job)
+{
+    uint8_t *data;
+    int32_t length;
+    FILE *f;
+
+    if (job->format == IMG_PNG)
+        data = Image_EncodePNG(job->pixels, job->width, job->height, job->width, job->palette, &length);
+    else
+        data = Image_EncodePCX(job->pixels, job->width, job->height, job->width, job->palette, &length);
+
+    job->failed = true;
+    if (!data)
+        return;
+
+    f = fopen(job->path, "wb");
+    if (f)
+    {
+        job->failed = fwrite(data, 1, length, f) != (size_t)length;
+        fclose(f);
+    }
+    free(data);
+}
+
+/*
+==============
+Image_Thread
+==============
+*/
+static void *Image_Thread(void *unused)
+{
+    imagejob_t *job;
+
+    pthread_mutex_lock(&image_lock);
+    while (1)
+    {
+        while (!image_queue && !image_shutdown)
+            pthread_cond_wait(&image_wake, &image_lock);
+
+        job = image_queue;
+        if (!job)
+            break;
+        image_queue = job->next;
+        if (!image_queue)
+            image_queuetail = &image_queue;
+
+        pthread_mutex_unlock(&image_lock);
+        Image_WriteJob(job);
+        pthread_mutex_lock(&image_lock);
+
+        // hand it back so the main thread can report it
+        job->next = image_done;
+        image_done = job;
+        image_pending--;
+        pthread_cond_broadcast(&image_space);
+    }
+    pthread_mutex_unlock(&image_lock);
+
+    return NULL;
+}
+
+/*
+==============
+Image_Poll
+
+Reports finished images, main thread only
+==============
+*/
+void Image_Poll(void)
+{
+    imagejob_t *job, *next;
+
+    if (!image_threadstarted)
+        return;
+
+    pthread_mutex_lock(&image_lock);
+    job = image_done;
+    image_done = NULL;
+    pthread_mutex_unlock(&image_lock);
+
+    for (; job; job = next)
+    {
+        next = job->next;
+        if (job->failed)
+            Con_Printf("Couldn't write %s\n", job->name);
+        else
+            Con_Printf("Wrote %s\n", job->name);
+        free(job);
+    }
+}
+
+/*
+==============
+Image_WriteAsync
+==============
+*/
+void Image_WriteAsync(char *filename, imageformat_t format, uint8_t *pixels, int32_t width, int32_t height,
+                      int32_t rowbytes, uint8_t *palette)
+{
+    imagejob_t *job;
+    int32_t i;
+
+    Image_Poll();
+
+    if (!image_threadstarted)
+    {
+        if (pthread_create(&image_thread, NULL, Image_Thread, NULL))
+        {
+            Con_Printf("Image_WriteAsync: couldn't start the encoder thread\n");
+            return;
+        }
+        image_threadstarted = true;
+    }
+
+    job = malloc(sizeof(*job) + width * height);
+    if (!job)
+    {
+        Con_Printf("Image_WriteAsync: not enough memory\n");
+        return;
+    }
+
+    job->next = NULL;
+    snprintf(job->path, sizeof(job->path), "%s/%s", com_gamedir, filename);
+    snprintf(job->name, sizeof(job->name), "%s", filename);
+    job->format = format;
+    job->width = width;
+    job->height = height;
+    job->failed = false;
+    memcpy(job->palette, palette, 768);
+    for (i = 0; i < height; i++)
+        memcpy(job->pixels + i * width, pixels + i * rowbytes, width);
+
+    pthread_mutex_lock(&image_lock);
+    // a long burst can outrun the encoder, so hold the main thread back
+    // rather than letting the copies pile up without bound
+    while (image_pending >= MAX_PENDING_IMAGES)
+        pthread_cond_wait(&image_space, &image_lock);
+    *image_queuetail = job;
+    image_queuetail = &job->next;
+    image_pending++;
+    pthread_cond_signal(&image_wake);
+    pthread_mutex_unlock(&image_lock);
+}
+
+/*
+==============
+Image_Shutdown
+==============
+*/
+void Image_Shutdown(void)
+{
+    if (!image_threadstarted)
+        return;
+
+    pthread_mutex_lock(&image_lock);
+    image_shutdown = true;
+    pthread_cond_signal(&image_wake);
+    pthread_mutex_unlock(&image_lock);
+
+    // the thread drains the queue before it exits
+    pthread_join(image_thread, NULL);
+    Image_Poll();
+    image_threadstarted = false;
+}
@@ -0,0 +1,25 @@
+// image.h -- 8 bit image file encoding
+
+typedef enum
+{
+    IMG_PCX,
+    IMG_PNG
+} imageformat_t;
+
+uint8_t *Image_EncodePCX(uint8_t *pixels, int32_t width, int32_t height, int32_t rowbytes, uint8_t *palette,
+                         int32_t *length);
+uint8_t *Image_EncodePNG(uint8_t *pixels, int32_t width, int32_t height, int32_t rowbytes, uint8_t *palette,
+                         int32_t *length);
+// both return a malloced file image that the caller frees, and are safe to
+// call from any thread
+
+void Image_WriteAsync(char *filename, imageformat_t format, uint8_t *pixels, int32_t width, int32_t height,
+                      int32_t rowbytes, uint8_t *palette);
+// copies the pixels and palette and queues them for the encoder thread, the
+// file is written relative to com_gamedir
+
+void Image_Poll(void);
+// prints a line for each image written since the last call, once a frame
+
+void Image_Shutdown(void);
+// waits for every queued image to be written
@@ -0,0 +1,389 @@
+// inflate.c -- deflate decoder for compressed pk3 entries
+//
+// Decodes a raw deflate stream (RFC 1951) into a buffer of known size.  It
+// only touches the buffers it is handed, so it is safe to run on a worker.
+
+#include "quakedef.h"
+
+#define INFLATE_MAXBITS 15
+#define INFLATE_FASTBITS 9 // codes this short or shorter decode with one lookup
+#define INFLATE_MAXLITS 288
+#define INFLATE_MAXDISTS 30
+
+typedef struct
+{
+    uint16_t fast[1 << INFLATE_FASTBITS]; // length << 9 | symbol, 0 for a longer code
+    uint16_t count[INFLATE_MAXBITS + 1];  // codes of each length
+    uint16_t symbol[INFLATE_MAXLITS];     // in canonical order
+} huffman_t;
+
+typedef struct
+{
+    uint8_t *in, *inend;
+    uint8_t *out, *outstart, *outend;
+    uint64_t bits;
+    int32_t numbits;
+    bool overrun; // ran out of input
+} inflatestate_t;
+
+static const uint16_t inflate_lengthbase[29] = {3,  4,  5,  6,  7,  8,  9,  10, 11,  13,  15,  17,  19,  23, 27,
+                                                31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+static const uint8_t inflate_lengthextra[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2,
+                                                2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+static const uint16_t inflate_distbase[30] = {1,   2,   3,   4,   5,   7,    9,    13,   17,   25,
+                                              33,  49,  65,  97,  129, 193,  257,  385,  513,  769,
+                                              1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+static const uint8_t inflate_distextra[30] = {0, 0, 0, 0, 1, 1, 2, 2,  3,  3,  4,  4,  5,  5,  6,
+                                              6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+static const uint8_t inflate_lengthorder[19] = {16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15};
+
+/*
+================
+Inflate_Refill
+================
+*/
+static void Inflate_Refill(inflatestate_t *s)
+{
+    while (s->numbits <= 56 && s->in < s->inend)
+    {
+        s->bits |= (uint64_t)*s->in++ << s->numbits;
+        s->numbits += 8;
+    }
+}
+
+/*
+================
+Inflate_Bits
+================
+*/
+static int32_t Inflate_Bits(inflatestate_t *s, int32_t count)
+{
+    int32_t v;
+
+    if (s->numbits < count)
+    {
+        Inflate_Refill(s);
+        if (s->numbits < count)
+        {
+            s->overrun = true;
+            return 0;
+        }
+    }
+
+    v = (int32_t)(s->bits & ((1u << count) - 1));
+    s->bits >>= count;
+    s->numbits -= count;
+    return v;
+}
+
+/*
+================
+Inflate_Build
+
+Sets up the canonical code for lengths[0..num), false if the lengths
+describe more codes than there is room for
+================
+*/
+static bool Inflate_Build(huffman_t *h, uint8_t *lengths, int32_t num)
+{
+    int32_t i, len, left, code, rev, step;
+    uint16_t offs[INFLATE_MAXBITS + 1];
+    uint16_t next[INFLATE_MAXBITS + 1];
+
+    memset(h->count, 0, sizeof(h->count));
+    memset(h->fast, 0, sizeof(h->fast));
+    for (i = 0; i < num; i++)
+        h->count[lengths[i]]++;
+    h->count[0] = 0;
+
+    left = 1;
+    for (len = 1; len <= INFLATE_MAXBITS; len++)
+    {
+        left <<= 1;
+        left -= h->count[len];
+        if (left < 0)
+            return false; // an incomplete code is fine, it just can't be fully used
+    }
+
+    offs[1] = 0;
+    for (len = 1; len < INFLATE_MAXBITS; len++)
+        offs[len + 1] = offs[len] + h->count[len];
+    for (i = 0; i < num; i++)
+        if (lengths[i])
+            h->symbol[offs[lengths[i]]++] = i;
+
+    // the stream holds codes first bit first, so the table is indexed by
+    // each short code reversed
+    code = 0;
+    for (len = 1; len <= INFLATE_MAXBITS; len++)
+    {
+        code = (code + h->count[len - 1]) << 1;
+        next[len] = code;
+    }
+    for (i = 0; i < num; i++)
+    {
+        len = lengths[i];
+        if (!len || len > INFLATE_FASTBITS)
+            continue;
+
+        code = next[len]++;
+        for (rev = 0, step = 0; step < len; step++)
+            rev |= ((code >> step) & 1) << (len - 1 - step);
+        for (; rev < (1 << INFLATE_FASTBITS); rev += 1 << len)
+            h->fast[rev] = (len << 9) | i;
+    }
+
+    return true;
+}
+
+/*
+================
+Inflate_Decode
+
+Returns the next symbol, -1 for a code that isn't in the table
+================
+*/
+static int32_t Inflate_Decode(inflatestate_t *s, huffman_t *h)
+{
+    int32_t code, first, index, count, len, e;
+
+    if (s->numbits < INFLATE_FASTBITS)
+        Inflate_Refill(s);
+    if (s->numbits >= INFLATE_FASTBITS)
+    {
+        e = h->fast[s->bits & ((1 << INFLATE_FASTBITS) - 1)];
+        if (e)
+        {
+            s->bits >>= e >> 9;
+            s->numbits -= e >> 9;
+            return e & 511;
+        }
+    }
+
+    // one bit at a time, as the code is long or the input nearly over
+    code = first = index = 0;
+    for (len = 1; len <= INFLATE_MAXBITS; len++)
+    {
+        code |= Inflate_Bits(s, 1);
+        if (s->overrun)
+            return -1;
+        count = h->count[len];
+        if (code - count < first)
+            return h->symbol[index + (code - first)];
+        index += count;
+        first += count;
+        first <<= 1;
+        code <<= 1;
+    }
+
+    return -1;
+}
+
+/*
+================
+Inflate_Stored
+================
+*/
+static bool Inflate_Stored(inflatestate_t *s)
+{
+    int32_t len, nlen;
+
+    // give back the whole bytes still in the bit buffer
+    s->bits >>= s->numbits & 7;
+    s->numbits &= ~7;
+    s->in -= s->numbits >> 3;
+    s->bits = 0;
+    s->numbits = 0;
+
+    if (s->inend - s->in < 4)
+        return false;
+    len = s->in[0] | (s->in[1] << 8);
+    nlen = s->in[2] | (s->in[3] << 8);
+    s->in += 4;
+    if (len != (~nlen & 0xffff) || s->inend - s->in < len || s->outend - s->out < len)
+        return false;
+
+    memcpy(s->out, s->in, len);
+    s->in += len;
+    s->out += len;
+    return true;
+}
+
+/*
+================
+Inflate_Codes
+================
+*/
+static bool Inflate_Codes(inflatestate_t *s, huffman_t *lit, huffman_t *dist)
+{
+    int32_t sym, len, d;
+    uint8_t *from;
+
+    for (;;)
+    {
+        sym = Inflate_Decode(s, lit);
+        if (sym < 0)
+            return false;
+
+        if (sym < 256)
+        {
+            if (s->out == s->outend)
+                return false;
+            *s->out++ = sym;
+            continue;
+        }
+        if (sym == 256)
+            return true;
+
+        sym -= 257;
+        if (sym >= 29)
+            return false;
+        len = inflate_lengthbase[sym] + Inflate_Bits(s, inflate_lengthextra[sym]);
+
+        sym = Inflate_Decode(s, dist);
+        if (sym < 0 || sym >= 30)
+            return false;
+        d = inflate_distbase[sym] + Inflate_Bits(s, inflate_distextra[sym]);
+
+        if (s->overrun || d > s->out - s->outstart || len > s->outend - s->out)
+            return false;
+
+        // the source may overlap what is being written, so bytewise
+        from = s->out - d;
+        while (len--)
+            *s->out++ = *from++;
+    }
+}
+
+/*
+================
+Inflate_Fixed
+================
+*/
+static bool Inflate_Fixed(inflatestate_t *s)
+{
+    huffman_t lit, dist;
+    uint8_t lengths[INFLATE_MAXLITS];
+    int32_t i;
+
+    for (i = 0; i < 144; i++)
+        lengths[i] = 8;
+    for (; i < 256; i++)
+        lengths[i] = 9;
+    for (; i < 280; i++)
+        lengths[i] = 7;
+    for (; i < INFLATE_MAXLITS; i++)
+        lengths[i] = 8;
+    Inflate_Build(&lit, lengths, INFLATE_MAXLITS);
+
+    for (i = 0; i < INFLATE_MAXDISTS; i++)
+        lengths[i] = 5;
+    Inflate_Build(&dist, lengths, INFLATE_MAXDISTS);
+
+    return Inflate_Codes(s, &lit, &dist);
+}
+
+/*
+================
+Inflate_Dynamic
+================
+*/
+static bool Inflate_Dynamic(inflatestate_t *s)
+{
+    huffman_t lit, dist, lencode;
+    uint8_t lengths[INFLATE_MAXLITS + INFLATE_MAXDISTS];
+    int32_t nlen, ndist, ncode, i, sym, len, repeat;
+
+    nlen = Inflate_Bits(s, 5) + 257;
+    ndist = Inflate_Bits(s, 5) + 1;
+    ncode = Inflate_Bits(s, 4) + 4;
+    if (nlen > INFLATE_MAXLITS || ndist > INFLATE_MAXDISTS)
+        return false;
+
+    memset(lengths, 0, 19);
+    for (i = 0; i < ncode; i++)
+        lengths[inflate_lengthorder[i]] = Inflate_Bits(s, 3);
+    if (s->overrun || !Inflate_Build(&lencode, lengths, 19))
+        return false;
+
+    for (i = 0; i < nlen + ndist;)
+    {
+        sym = Inflate_Decode(s, &lencode);
+        if (sym < 0)
+            return false;
+        if (sym < 16)
+        {
+            lengths[i++] = sym;
+            continue;
+        }
+
+        len = 0;
+        if (sym == 16)
+        {
+            if (!i)
+                return false; // nothing to repeat
+            len = lengths[i - 1];
+            repeat = 3 + Inflate_Bits(s, 2);
+        }
+        else if (sym == 17)
+            repeat = 3 + Inflate_Bits(s, 3);
+        else
+            repeat = 11 + Inflate_Bits(s, 7);
+
+        if (s->overrun || i + repeat > nlen + ndist)
+            return false;
+        while (repeat--)
+            lengths[i++] = len;
+    }
+
+    if (!lengths[256])
+        return false; // no end of block code
+
+    if (!Inflate_Build(&lit, lengths, nlen) || !Inflate_Build(&dist, lengths + nlen, ndist))
+        return false;
+
+    return Inflate_Codes(s, &lit, &dist);
+}
+
+/*
+================
+Inflate
+
+Decodes inlen bytes of raw deflate data into out, the number of bytes
+written or -1 if the stream is damaged or doesn't fit in outlen
+================
+*/
+int32_t Inflate(uint8_t *in, int32_t inlen, uint8_t *out, int32_t outlen)
+{
+    inflatestate_t s;
+    int32_t last, type;
+    bool ok;
+
+    memset(&s, 0, sizeof(s));
+    s.in = in;
+    s.inend = in + inlen;
+    s.out = s.outstart = out;
+    s.outend = out + outlen;
+
+    do
+    {
+        last = Inflate_Bits(&s, 1);
+        type = Inflate_Bits(&s, 2);
+        if (s.overrun)
+            return -1;
+
+        if (type == 0)
+            ok = Inflate_Stored(&s);
+        else if (type == 1)
+            ok = Inflate_Fixed(&s);
+        else if (type == 2)
+            ok = Inflate_Dynamic(&s);
+        else
+            ok = false;
+
+        if (!ok || s.overrun)
+            return -1;
+    } while (!last);
+
+    return s.out - s.outstart;
+}
@@ -0,0 +1,5 @@
+// inflate.h -- deflate decoder
+
+int32_t Inflate(uint8_t *in, int32_t inlen, uint8_t *out, int32_t outlen);
+// decodes a raw deflate stream, returns the bytes written or -1 if it is
+// damaged or doesn't fit in outlen.  Safe to call from any thread.
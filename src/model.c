@@ -3,6 +3,7 @@
 // models are the only shared resource between a client and server running
 // on the same machine.
 
+#include <unistd.h>
 #include "quakedef.h"
 #include "r_local.h"
 
@@ -13,6 +14,7 @@ void Mod_LoadSpriteModel(model_t *mod, void *buffer);
 void Mod_LoadBrushModel(model_t *mod, void *buffer);
 void Mod_LoadAliasModel(model_t *mod, void *buffer);
 model_t *Mod_LoadModel(model_t *mod, bool crash);
+static void Mod_Benchmark_f(void);
 
 static uint8_t mod_novis[MAX_MAP_LEAFS / 8];
 
@@ -24,6 +26,21 @@ static int32_t mod_numknown;
 #define NL_PRESENT 0
 #define NL_NEEDS_LOADED 1
 #define NL_UNREFERENCED 2
+#define NL_RETAINED 4 // kept from an earlier map, check the file before use
+
+// sprites and item brush models are loaded by nearly every map, so they are
+// kept in the retained tier instead of being loaded again after each change
+static cvar_t mod_retain = {"mod_retain", "1"};
+static bool mod_retainstale; // a retained model's file changed
+static bool mod_view;        // the file being loaded is in a mapped pak and will stay put
+static bool mod_bsp2;        // the brush model being loaded is BSP2, with 32 bit indices
+
+// processed brush models are kept on disk under bake/ and loaded straight
+// back while the .bsp they came from is unchanged
+static cvar_t mod_bake = {"mod_bake", "1"};
+static bool mod_baking;        // the brush model being loaded may be read from or written to a bake
+static uint32_t mod_bakecrc;   // of the .bsp being loaded
+static int32_t mod_bakefilesize;
 
 /*
 ===============
@@ -32,6 +49,10 @@ Mod_Init
 */
 void Mod_Init(void)
 {
+    Cvar_RegisterVariable(&mod_retain);
+    Cvar_RegisterVariable(&mod_bake);
+    Cmd_AddCommand("bsp_benchmark", Mod_Benchmark_f);
+
     memset(mod_novis, 0xff, sizeof(mod_novis));
 }
 
@@ -146,16 +167,35 @@ Mod_ClearAll
 */
 void Mod_ClearAll(void)
 {
-    int32_t i;
+    int32_t i, retained;
     model_t *mod;
+    bool flush;
 
-    for (i = 0, mod = mod_known; i < mod_numknown; i++, mod++)
+    // start the retained tier over if it is being turned off, or holds
+    // models that have been loaded again since
+    flush = (!mod_retain.value || mod_retainstale) && Hunk_RetainedSize();
+    if (flush)
+        Hunk_FlushRetained();
+    mod_retainstale = false;
+
+    for (i = 0, retained = 0, mod = mod_known; i < mod_numknown; i++, mod++)
     {
+        if (mod->retained && !flush)
+        {
+            mod->needload = NL_RETAINED;
+            retained++;
+            continue;
+        }
+
+        mod->retained = false;
         mod->needload = NL_UNREFERENCED;
         // FIX FOR CACHE_ALLOC ERRORS:
         if (mod->type == mod_sprite)
             mod->cache.data = NULL;
     }
+
+    if (retained)
+        Con_DPrintf("%i models retained in %i KB\n", retained, Hunk_RetainedSize() / 1024);
 }
 
 /*
@@ -237,7 +277,9 @@ Loads a model into the cache
 model_t *Mod_LoadModel(model_t *mod, bool crash)
 {
     uint32_t *buf;
-    uint8_t stackbuf[1024]; // avoid dirtying the cache heap
+    memcat_t oldcategory;
+    uint32_t crc;
+    bool retain;
 
     if (mod->type == mod_alias)
     {
@@ -260,7 +302,7 @@ model_t *Mod_LoadModel(model_t *mod, bool crash)
     //
     // load the file
     //
-    buf = (uint32_t *)COM_LoadStackFile(mod->name, stackbuf, sizeof(stackbuf));
+    buf = (uint32_t *)COM_ViewFile(mod->name);
     if (!buf)
     {
         if (crash)
@@ -268,12 +310,37 @@ model_t *Mod_LoadModel(model_t *mod, bool crash)
         return NULL;
     }
 
+    // alias models live in the cache, which lasts across maps anyway, and
+    // world maps are only loaded once.  The items are maps/b_*.bsp.
+    retain = mod_retain.value && *buf != IDPOLYHEADER &&
+             (strncmp(mod->name, "maps/", 5) || !strncmp(mod->name, "maps/b_", 7));
+
+    // only world models are baked, and they are never retained
+    mod_baking = mod_bake.value && !retain && *buf != IDPOLYHEADER && *buf != IDSPRITEHEADER;
+
+    crc = retain || mod_baking || mod->needload == NL_RETAINED ? CRC32_Block(0, (uint8_t *)buf, com_filesize) : 0;
+    mod_bakecrc = crc;
+    mod_bakefilesize = com_filesize;
+    if (mod->needload == NL_RETAINED)
+    {
+        if (mod->filesize == com_filesize && mod->crc == crc)
+        {
+            mod->needload = NL_PRESENT;
+            return mod;
+        }
+
+        // the file has changed, the old copy goes at the next map change
+        mod->retained = false;
+        mod_retainstale = true;
+    }
+
     //
     // allocate a new model
     //
     COM_FileBase(mod->name, loadname);
 
     loadmodel = mod;
+    mod_view = com_fileview;
 
     //
     // fill it in
@@ -282,6 +349,11 @@ model_t *Mod_LoadModel(model_t *mod, bool crash)
     // call the apropriate loader
     mod->needload = NL_PRESENT;
 
+    oldcategory = Memory_SetCategory(MEM_MODELS);
+
+    if (retain)
+        Hunk_BeginRetained();
+
     switch ((*(uint32_t *)buf))
     {
     case IDPOLYHEADER:
@@ -297,6 +369,14 @@ model_t *Mod_LoadModel(model_t *mod, bool crash)
         break;
     }
 
+    if (retain)
+        Hunk_EndRetained();
+    mod->retained = retain;
+    mod->filesize = com_filesize;
+    mod->crc = crc;
+
+    Memory_SetCategory(oldcategory);
+
     return mod;
 }
 
@@ -326,6 +406,37 @@ model_t *Mod_ForName(char *name, bool crash)
 
 static uint8_t *mod_base;
 
+/*
+=================
+Mod_LumpCount
+
+The number of size byte records in the lump
+=================
+*/
+static int32_t Mod_LumpCount(lump_t *l, int32_t size)
+{
+    if (l->filelen % size)
+        Sys_Error("MOD_LoadBmodel: funny lump size in %s", loadmodel->name);
+    return l->filelen / size;
+}
+
+/*
+=================
+Mod_ClampBound
+
+BSP2 bounds are floats, but the culling boxes stay 16 bit like the
+coordinates the protocol can send
+=================
+*/
+static int16_t Mod_ClampBound(float v)
+{
+    if (v < -32768)
+        return -32768;
+    if (v > 32767)
+        return 32767;
+    return (int16_t)v;
+}
+
 /*
 =================
 Mod_LoadTextures
@@ -347,22 +458,14 @@ void Mod_LoadTextures(lump_t *l)
     }
     m = (dmiptexlump_t *)(mod_base + l->fileofs);
 
-    m->nummiptex =  (m->nummiptex);
-
     loadmodel->numtextures = m->nummiptex;
     loadmodel->textures = Hunk_AllocName(m->nummiptex * sizeof(*loadmodel->textures), loadname);
 
     for (i = 0; i < m->nummiptex; i++)
     {
-        m->dataofs[i] =  (m->dataofs[i]);
         if (m->dataofs[i] == -1)
             continue;
         mt = (miptex_t *)((uint8_t *)m + m->dataofs[i]);
-        mt->width =  (mt->width);
-        mt->height =  (mt->height);
-        for (j = 0; j < MIPLEVELS; j++)
-            mt->offsets[j] =  (mt->offsets[j]);
-
         if ((mt->width & 15) || (mt->height & 15))
             Sys_Error("Texture %s is not 16 aligned", mt->name);
         pixels = mt->width * mt->height / 64 * 85;
@@ -487,6 +590,11 @@ void Mod_LoadLighting(lump_t *l)
         loadmodel->lightdata = NULL;
         return;
     }
+    if (mod_view)
+    {
+        loadmodel->lightdata = mod_base + l->fileofs;
+        return;
+    }
     loadmodel->lightdata = Hunk_AllocName(l->filelen, loadname);
     memcpy(loadmodel->lightdata, mod_base + l->fileofs, l->filelen);
 }
@@ -503,6 +611,11 @@ void Mod_LoadVisibility(lump_t *l)
         loadmodel->visdata = NULL;
         return;
     }
+    if (mod_view)
+    {
+        loadmodel->visdata = mod_base + l->fileofs;
+        return;
+    }
     loadmodel->visdata = Hunk_AllocName(l->filelen, loadname);
     memcpy(loadmodel->visdata, mod_base + l->fileofs, l->filelen);
 }
@@ -519,7 +632,13 @@ void Mod_LoadEntities(lump_t *l)
         loadmodel->entities = NULL;
         return;
     }
-    loadmodel->entities = Hunk_AllocName(l->filelen, loadname);
+    // the text is parsed up to a 0, which the mapping only has if the lump does
+    if (mod_view && !mod_base[l->fileofs + l->filelen - 1])
+    {
+        loadmodel->entities = (char *)mod_base + l->fileofs;
+        return;
+    }
+    loadmodel->entities = Hunk_AllocName(l->filelen + 1, loadname);
     memcpy(loadmodel->entities, mod_base + l->fileofs, l->filelen);
 }
 
@@ -595,22 +714,32 @@ Mod_LoadEdges
 void Mod_LoadEdges(lump_t *l)
 {
     dedge_t *in;
+    dledge_t *lin;
     medge_t *out;
     int32_t i, count;
 
     in = (void *)(mod_base + l->fileofs);
-    if (l->filelen % sizeof(*in))
-        Sys_Error("MOD_LoadBmodel: funny lump size in %s", loadmodel->name);
-    count = l->filelen / sizeof(*in);
+    lin = (void *)(mod_base + l->fileofs);
+    count = Mod_LumpCount(l, mod_bsp2 ? sizeof(*lin) : sizeof(*in));
     out = Hunk_AllocName((count + 1) * sizeof(*out), loadname);
 
     loadmodel->edges = out;
     loadmodel->numedges = count;
 
-    for (i = 0; i < count; i++, in++, out++)
+    for (i = 0; i < count; i++, out++)
     {
-        out->v[0] = (uint16_t)(in->v[0]);
-        out->v[1] = (uint16_t)(in->v[1]);
+        if (mod_bsp2)
+        {
+            out->v[0] = lin[i].v[0];
+            out->v[1] = lin[i].v[1];
+        }
+        else
+        {
+            out->v[0] = in[i].v[0];
+            out->v[1] = in[i].v[1];
+        }
+        if (out->v[0] >= (uint32_t)loadmodel->numvertexes || out->v[1] >= (uint32_t)loadmodel->numvertexes)
+            Sys_Error("Mod_LoadEdges: bad vertex number in %s", loadmodel->name);
     }
 }
 
@@ -739,45 +868,60 @@ Mod_LoadFaces
 void Mod_LoadFaces(lump_t *l)
 {
     dface_t *in;
+    dlface_t *lin;
     msurface_t *out;
     int32_t i, count, surfnum;
-    int32_t planenum, side;
+    int32_t planenum, side, texinfo, lightofs;
+    uint8_t *styles;
 
     in = (void *)(mod_base + l->fileofs);
-    if (l->filelen % sizeof(*in))
-        Sys_Error("MOD_LoadBmodel: funny lump size in %s", loadmodel->name);
-    count = l->filelen / sizeof(*in);
+    lin = (void *)(mod_base + l->fileofs);
+    count = Mod_LumpCount(l, mod_bsp2 ? sizeof(*lin) : sizeof(*in));
     out = Hunk_AllocName(count * sizeof(*out), loadname);
 
     loadmodel->surfaces = out;
     loadmodel->numsurfaces = count;
 
-    for (surfnum = 0; surfnum < count; surfnum++, in++, out++)
+    for (surfnum = 0; surfnum < count; surfnum++, out++)
     {
-        out->firstedge =  (in->firstedge);
-        out->numedges = (in->numedges);
+        if (mod_bsp2)
+        {
+            out->firstedge = lin[surfnum].firstedge;
+            out->numedges = lin[surfnum].numedges;
+            planenum = lin[surfnum].planenum;
+            side = lin[surfnum].side;
+            texinfo = lin[surfnum].texinfo;
+            styles = lin[surfnum].styles;
+            lightofs = lin[surfnum].lightofs;
+        }
+        else
+        {
+            out->firstedge = in[surfnum].firstedge;
+            out->numedges = in[surfnum].numedges;
+            planenum = in[surfnum].planenum;
+            side = in[surfnum].side;
+            texinfo = in[surfnum].texinfo;
+            styles = in[surfnum].styles;
+            lightofs = in[surfnum].lightofs;
+        }
         out->flags = 0;
 
-        planenum = (in->planenum);
-        side = (in->side);
         if (side)
             out->flags |= SURF_PLANEBACK;
 
         out->plane = loadmodel->planes + planenum;
 
-        out->texinfo = loadmodel->texinfo + (in->texinfo);
+        out->texinfo = loadmodel->texinfo + texinfo;
 
         CalcSurfaceExtents(out);
 
         // lighting info
 
-        for (i = 0; i < MAXLIGHTMAPS; i++)
-            out->styles[i] = in->styles[i];
-        i =  (in->lightofs);
-        if (i == -1)
+        memcpy(out->styles, styles, MAXLIGHTMAPS);
+        if (lightofs == -1)
             out->samples = NULL;
         else
-            out->samples = loadmodel->lightdata + i;
+            out->samples = loadmodel->lightdata + lightofs;
 
         // set the drawing flags flag
 
@@ -823,34 +967,54 @@ void Mod_LoadNodes(lump_t *l)
 {
     int32_t i, j, count, p;
     dnode_t *in;
+    dl2node_t *lin;
     mnode_t *out;
+    int32_t children[2];
 
     in = (void *)(mod_base + l->fileofs);
-    if (l->filelen % sizeof(*in))
-        Sys_Error("MOD_LoadBmodel: funny lump size in %s", loadmodel->name);
-    count = l->filelen / sizeof(*in);
+    lin = (void *)(mod_base + l->fileofs);
+    count = Mod_LumpCount(l, mod_bsp2 ? sizeof(*lin) : sizeof(*in));
     out = Hunk_AllocName(count * sizeof(*out), loadname);
 
     loadmodel->nodes = out;
     loadmodel->numnodes = count;
 
-    for (i = 0; i < count; i++, in++, out++)
+    for (i = 0; i < count; i++, out++)
     {
-        for (j = 0; j < 3; j++)
+        if (mod_bsp2)
+        {
+            for (j = 0; j < 3; j++)
+            {
+                out->minmaxs[j] = Mod_ClampBound(floor(lin[i].mins[j]));
+                out->minmaxs[3 + j] = Mod_ClampBound(ceil(lin[i].maxs[j]));
+            }
+            p = lin[i].planenum;
+            out->firstsurface = lin[i].firstface;
+            out->numsurfaces = lin[i].numfaces;
+            children[0] = lin[i].children[0];
+            children[1] = lin[i].children[1];
+        }
+        else
         {
-            out->minmaxs[j] = (in->mins[j]);
-            out->minmaxs[3 + j] = (in->maxs[j]);
+            for (j = 0; j < 3; j++)
+            {
+                out->minmaxs[j] = in[i].mins[j];
+                out->minmaxs[3 + j] = in[i].maxs[j];
+            }
+            p = in[i].planenum;
+            out->firstsurface = in[i].firstface;
+            out->numsurfaces = in[i].numfaces;
+            children[0] = in[i].children[0];
+            children[1] = in[i].children[1];
         }
 
-        p =  (in->planenum);
         out->plane = loadmodel->planes + p;
 
-        out->firstsurface = (in->firstface);
-        out->numsurfaces = (in->numfaces);
-
         for (j = 0; j < 2; j++)
         {
-            p = (in->children[j]);
+            p = children[j];
+            if (p >= count || -1 - p >= loadmodel->numleafs)
+                Sys_Error("Mod_LoadNodes: bad child in %s", loadmodel->name);
             if (p >= 0)
                 out->children[j] = loadmodel->nodes + p;
             else
@@ -869,33 +1033,57 @@ Mod_LoadLeafs
 void Mod_LoadLeafs(lump_t *l)
 {
     dleaf_t *in;
+    dl2leaf_t *lin;
     mleaf_t *out;
     int32_t i, j, count, p;
+    uint32_t firstmark, nummarks;
+    uint8_t *ambient;
 
     in = (void *)(mod_base + l->fileofs);
-    if (l->filelen % sizeof(*in))
-        Sys_Error("MOD_LoadBmodel: funny lump size in %s", loadmodel->name);
-    count = l->filelen / sizeof(*in);
+    lin = (void *)(mod_base + l->fileofs);
+    count = Mod_LumpCount(l, mod_bsp2 ? sizeof(*lin) : sizeof(*in));
+    if (count > MAX_MAP_LEAFS)
+        Sys_Error("Mod_LoadLeafs: %s has %i leafs, the limit is %i", loadmodel->name, count, MAX_MAP_LEAFS);
     out = Hunk_AllocName(count * sizeof(*out), loadname);
 
     loadmodel->leafs = out;
     loadmodel->numleafs = count;
 
-    for (i = 0; i < count; i++, in++, out++)
+    for (i = 0; i < count; i++, out++)
     {
-        for (j = 0; j < 3; j++)
+        if (mod_bsp2)
         {
-            out->minmaxs[j] = (in->mins[j]);
-            out->minmaxs[3 + j] = (in->maxs[j]);
+            for (j = 0; j < 3; j++)
+            {
+                out->minmaxs[j] = Mod_ClampBound(floor(lin[i].mins[j]));
+                out->minmaxs[3 + j] = Mod_ClampBound(ceil(lin[i].maxs[j]));
+            }
+            out->contents = lin[i].contents;
+            firstmark = lin[i].firstmarksurface;
+            nummarks = lin[i].nummarksurfaces;
+            p = lin[i].visofs;
+            ambient = lin[i].ambient_level;
+        }
+        else
+        {
+            for (j = 0; j < 3; j++)
+            {
+                out->minmaxs[j] = in[i].mins[j];
+                out->minmaxs[3 + j] = in[i].maxs[j];
+            }
+            out->contents = in[i].contents;
+            firstmark = in[i].firstmarksurface;
+            nummarks = in[i].nummarksurfaces;
+            p = in[i].visofs;
+            ambient = in[i].ambient_level;
         }
 
-        p =  (in->contents);
-        out->contents = p;
-
-        out->firstmarksurface = loadmodel->marksurfaces + (in->firstmarksurface);
-        out->nummarksurfaces = (in->nummarksurfaces);
+        if (firstmark > (uint32_t)loadmodel->nummarksurfaces ||
+            nummarks > (uint32_t)loadmodel->nummarksurfaces - firstmark)
+            Sys_Error("Mod_LoadLeafs: bad marksurfaces in %s", loadmodel->name);
+        out->firstmarksurface = loadmodel->marksurfaces + firstmark;
+        out->nummarksurfaces = nummarks;
 
-        p =  (in->visofs);
         if (p == -1)
             out->compressed_vis = NULL;
         else
@@ -903,7 +1091,7 @@ void Mod_LoadLeafs(lump_t *l)
         out->efrags = NULL;
 
         for (j = 0; j < 4; j++)
-            out->ambient_sound_level[j] = in->ambient_level[j];
+            out->ambient_sound_level[j] = ambient[j];
     }
 }
 
@@ -914,14 +1102,15 @@ Mod_LoadClipnodes
 */
 void Mod_LoadClipnodes(lump_t *l)
 {
-    dclipnode_t *in, *out;
+    dclipnode_t *in;
+    dlclipnode_t *lin;
+    mclipnode_t *out;
     int32_t i, count;
     hull_t *hull;
 
     in = (void *)(mod_base + l->fileofs);
-    if (l->filelen % sizeof(*in))
-        Sys_Error("MOD_LoadBmodel: funny lump size in %s", loadmodel->name);
-    count = l->filelen / sizeof(*in);
+    lin = (void *)(mod_base + l->fileofs);
+    count = Mod_LumpCount(l, mod_bsp2 ? sizeof(*lin) : sizeof(*in));
     out = Hunk_AllocName(count * sizeof(*out), loadname);
 
     loadmodel->clipnodes = out;
@@ -951,11 +1140,20 @@ void Mod_LoadClipnodes(lump_t *l)
     hull->clip_maxs[1] = 32;
     hull->clip_maxs[2] = 64;
 
-    for (i = 0; i < count; i++, out++, in++)
+    for (i = 0; i < count; i++, out++)
     {
-        out->planenum =  (in->planenum);
-        out->children[0] = (in->children[0]);
-        out->children[1] = (in->children[1]);
+        if (mod_bsp2)
+        {
+            out->planenum = lin[i].planenum;
+            out->children[0] = lin[i].children[0];
+            out->children[1] = lin[i].children[1];
+        }
+        else
+        {
+            out->planenum = in[i].planenum;
+            out->children[0] = in[i].children[0];
+            out->children[1] = in[i].children[1];
+        }
     }
 }
 
@@ -969,7 +1167,7 @@ Deplicate the drawing hull structure as a clipping hull
 void Mod_MakeHull0(void)
 {
     mnode_t *in, *child;
-    dclipnode_t *out;
+    mclipnode_t *out;
     int32_t i, j, count;
     hull_t *hull;
 
@@ -1005,14 +1203,15 @@ Mod_LoadMarksurfaces
 */
 void Mod_LoadMarksurfaces(lump_t *l)
 {
-    int32_t i, j, count;
-    int16_t *in;
+    int32_t i, count;
+    uint32_t j;
+    uint16_t *in;
+    uint32_t *lin;
     msurface_t **out;
 
     in = (void *)(mod_base + l->fileofs);
-    if (l->filelen % sizeof(*in))
-        Sys_Error("MOD_LoadBmodel: funny lump size in %s", loadmodel->name);
-    count = l->filelen / sizeof(*in);
+    lin = (void *)(mod_base + l->fileofs);
+    count = Mod_LumpCount(l, mod_bsp2 ? sizeof(*lin) : sizeof(*in));
     out = Hunk_AllocName(count * sizeof(*out), loadname);
 
     loadmodel->marksurfaces = out;
@@ -1020,8 +1219,8 @@ void Mod_LoadMarksurfaces(lump_t *l)
 
     for (i = 0; i < count; i++)
     {
-        j = (in[i]);
-        if (j >= loadmodel->numsurfaces)
+        j = mod_bsp2 ? lin[i] : in[i];
+        if (j >= (uint32_t)loadmodel->numsurfaces)
             Sys_Error("Mod_ParseMarksurfaces: bad surface number");
         out[i] = loadmodel->surfaces + j;
     }
@@ -1106,6 +1305,393 @@ float RadiusFromBounds(vec3_t mins, vec3_t maxs)
     return Length(corner);
 }
 
+/*
+==============================================================================
+
+BAKED BRUSH MODELS
+
+A bake is the hunk range a brush model was loaded into, copied out whole,
+after a header holding the model_t.  Every pointer in it is stored as an
+offset from the start of the range, so loading it again is one read into a
+single hunk block and a pass that turns the offsets back into pointers.
+
+==============================================================================
+*/
+
+#define BAKE_VERSION 2
+#define BAKE_NOTEXTURE ((void *)1) // stands for r_notexture_mip, which lives outside the range
+
+typedef struct
+{
+    char id[4];       // "QBMB"
+    int32_t version;  // BAKE_VERSION
+    uint32_t layout;  // crc of the structure sizes, a different build may not match
+    uint32_t crc;     // of the .bsp
+    int32_t filesize; // of the .bsp
+    int32_t datasize;
+    model_t model; // pointers are offsets into the data that follows
+} bakeheader_t;
+
+static uintptr_t reloc_from, reloc_to;
+static uint32_t reloc_size;
+static uint8_t *reloc_work; // where the range being fixed up actually is
+static bool reloc_ok;
+
+/*
+=================
+Mod_BakeLayout
+=================
+*/
+static uint32_t Mod_BakeLayout(void)
+{
+    int32_t sizes[] = {sizeof(void *),     sizeof(model_t),    sizeof(msurface_t), sizeof(mnode_t),
+                       sizeof(mleaf_t),    sizeof(mtexinfo_t), sizeof(texture_t),  sizeof(mplane_t),
+                       sizeof(mclipnode_t), sizeof(medge_t),   sizeof(dmodel_t)};
+
+    return CRC32_Block(0, (uint8_t *)sizes, sizeof(sizes));
+}
+
+/*
+=================
+Mod_Reloc
+
+Moves one pointer from the reloc_from range to the reloc_to range
+=================
+*/
+static void Mod_Reloc(void *pointer)
+{
+    void **p;
+    uintptr_t v;
+
+    p = pointer;
+    if (!*p)
+        return;
+
+    if (*p == r_notexture_mip)
+    {
+        *p = BAKE_NOTEXTURE;
+        return;
+    }
+    if (*p == BAKE_NOTEXTURE)
+    {
+        *p = r_notexture_mip;
+        return;
+    }
+
+    v = (uintptr_t)*p - reloc_from;
+    if (v >= reloc_size)
+    {
+        reloc_ok = false;
+        *p = NULL;
+        return;
+    }
+
+    *p = (void *)(reloc_to + v);
+}
+
+/*
+=================
+Mod_RelocArray
+
+Where an array the model points at can be walked, NULL if it isn't all
+inside the range
+=================
+*/
+static void *Mod_RelocArray(void *p, int32_t count, int32_t size)
+{
+    uintptr_t v;
+
+    if (!p || count <= 0)
+        return NULL;
+
+    v = (uintptr_t)p - reloc_from;
+    if (v >= reloc_size || (uint64_t)count * size > reloc_size - v)
+    {
+        reloc_ok = false;
+        return NULL;
+    }
+
+    return reloc_work + v;
+}
+
+/*
+=================
+Mod_Relocate
+
+Fixes up every pointer of a brush model that has not yet had its
+submodels set up.  m still points at the old range, the arrays are walked
+where they are now.
+=================
+*/
+static bool Mod_Relocate(model_t *m)
+{
+    int32_t i, j;
+    msurface_t *surf;
+    mnode_t *node;
+    mleaf_t *leaf;
+    msurface_t **mark;
+    mtexinfo_t *tex;
+    texture_t **textures, *tx;
+
+    reloc_ok = true;
+
+    surf = Mod_RelocArray(m->surfaces, m->numsurfaces, sizeof(*surf));
+    for (i = 0; surf && i < m->numsurfaces; i++, surf++)
+    {
+        Mod_Reloc(&surf->plane);
+        Mod_Reloc(&surf->texinfo);
+        Mod_Reloc(&surf->samples);
+        memset(surf->cachespots, 0, sizeof(surf->cachespots));
+    }
+
+    node = Mod_RelocArray(m->nodes, m->numnodes, sizeof(*node));
+    for (i = 0; node && i < m->numnodes; i++, node++)
+    {
+        Mod_Reloc(&node->parent);
+        Mod_Reloc(&node->plane);
+        Mod_Reloc(&node->children[0]);
+        Mod_Reloc(&node->children[1]);
+    }
+
+    leaf = Mod_RelocArray(m->leafs, m->numleafs, sizeof(*leaf));
+    for (i = 0; leaf && i < m->numleafs; i++, leaf++)
+    {
+        Mod_Reloc(&leaf->parent);
+        Mod_Reloc(&leaf->compressed_vis);
+        Mod_Reloc(&leaf->firstmarksurface);
+        leaf->efrags = NULL;
+        leaf->efragents = NULL;
+        leaf->numefragents = 0;
+    }
+
+    mark = Mod_RelocArray(m->marksurfaces, m->nummarksurfaces, sizeof(*mark));
+    for (i = 0; mark && i < m->nummarksurfaces; i++)
+        Mod_Reloc(&mark[i]);
+
+    tex = Mod_RelocArray(m->texinfo, m->numtexinfo, sizeof(*tex));
+    for (i = 0; tex && i < m->numtexinfo; i++, tex++)
+        Mod_Reloc(&tex->texture);
+
+    textures = Mod_RelocArray(m->textures, m->numtextures, sizeof(*textures));
+    for (i = 0; textures && i < m->numtextures; i++)
+    {
+        tx = Mod_RelocArray(textures[i], 1, sizeof(*tx));
+        if (tx)
+        {
+            Mod_Reloc(&tx->anim_next);
+            Mod_Reloc(&tx->alternate_anims);
+        }
+        Mod_Reloc(&textures[i]);
+    }
+
+    Mod_Reloc(&m->submodels);
+    Mod_Reloc(&m->planes);
+    Mod_Reloc(&m->leafs);
+    Mod_Reloc(&m->vertexes);
+    Mod_Reloc(&m->edges);
+    Mod_Reloc(&m->nodes);
+    Mod_Reloc(&m->texinfo);
+    Mod_Reloc(&m->surfaces);
+    Mod_Reloc(&m->surfedges);
+    Mod_Reloc(&m->clipnodes);
+    Mod_Reloc(&m->marksurfaces);
+    Mod_Reloc(&m->textures);
+    Mod_Reloc(&m->visdata);
+    Mod_Reloc(&m->lightdata);
+    Mod_Reloc(&m->entities);
+
+    // only the first three hulls are ever built
+    for (j = 0; j < MAX_MAP_HULLS; j++)
+    {
+        if (j < 3)
+        {
+            Mod_Reloc(&m->hulls[j].clipnodes);
+            Mod_Reloc(&m->hulls[j].planes);
+        }
+        else
+        {
+            m->hulls[j].clipnodes = NULL;
+            m->hulls[j].planes = NULL;
+        }
+    }
+
+    m->cache.data = NULL;
+
+    return reloc_ok;
+}
+
+/*
+=================
+Mod_WriteBake
+
+Saves the hunk range [start, start + size) the model was just loaded into
+=================
+*/
+static void Mod_WriteBake(model_t *mod, uint8_t *start, int32_t size)
+{
+    FILE *f;
+    bakeheader_t header;
+    uint8_t *data;
+    bool ok;
+    char name[MAX_OSPATH], tempname[MAX_OSPATH];
+
+    data = malloc(size);
+    if (!data)
+        return;
+    memcpy(data, start, size);
+
+    memset(&header, 0, sizeof(header));
+    memcpy(header.id, "QBMB", 4);
+    header.version = BAKE_VERSION;
+    header.layout = Mod_BakeLayout();
+    header.crc = mod_bakecrc;
+    header.filesize = mod_bakefilesize;
+    header.datasize = size;
+    header.model = *mod;
+
+    reloc_from = (uintptr_t)start;
+    reloc_to = 0;
+    reloc_size = size;
+    reloc_work = data;
+    ok = Mod_Relocate(&header.model);
+
+    if (ok)
+    {
+        // written under another name first, so another process never reads half a bake
+        snprintf(name, sizeof(name), "%s/bake", com_gamedir);
+        Sys_mkdir(name);
+        snprintf(name, sizeof(name), "%s/bake/%s.bmb", com_gamedir, loadname);
+        snprintf(tempname, sizeof(tempname), "%s.%d", name, (int32_t)getpid());
+
+        f = fopen(tempname, "wb");
+        if (f)
+        {
+            ok = fwrite(&header, sizeof(header), 1, f) == 1 && fwrite(data, size, 1, f) == 1;
+            ok = !fclose(f) && ok;
+            if (!ok || rename(tempname, name))
+                remove(tempname);
+        }
+    }
+    else
+        Con_DPrintf("Mod_WriteBake: %s points outside its hunk range\n", mod->name);
+
+    free(data);
+}
+
+/*
+=================
+Mod_LoadBake
+
+Loads the model from its bake if there is one for this exact .bsp
+=================
+*/
+static bool Mod_LoadBake(model_t *mod)
+{
+    bakeheader_t header;
+    uint8_t *base, *data;
+    int32_t h, len, mark, i;
+    char name[MAX_OSPATH];
+
+    snprintf(name, sizeof(name), "%s/bake/%s.bmb", com_gamedir, loadname);
+    len = Sys_FileOpenRead(name, &h);
+    if (h == -1)
+        return false;
+    base = Sys_FileMap(h, len);
+    Sys_FileClose(h);
+    if (!base)
+        return false;
+
+    // a damaged size must not get as far as the hunk, which can't fail softly
+    if (len < (int32_t)sizeof(header))
+    {
+        Sys_FileUnmap(base, len);
+        return false;
+    }
+    memcpy(&header, base, sizeof(header));
+    if (memcmp(header.id, "QBMB", 4) || header.version != BAKE_VERSION || header.layout != Mod_BakeLayout() ||
+        header.crc != mod_bakecrc || header.filesize != mod_bakefilesize || header.datasize <= 0 ||
+        header.datasize > len - (int32_t)sizeof(header))
+    {
+        Sys_FileUnmap(base, len);
+        return false;
+    }
+
+    // the pointers are relocated in place, so the data can't stay in the
+    // read-only mapping
+    mark = Hunk_LowMark();
+    data = Hunk_AllocName(header.datasize, loadname);
+    memcpy(data, base + sizeof(header), header.datasize);
+    Sys_FileUnmap(base, len);
+
+    reloc_from = 0;
+    reloc_to = (uintptr_t)data;
+    reloc_size = header.datasize;
+    reloc_work = data;
+    if (!Mod_Relocate(&header.model))
+    {
+        Con_Printf("%s is damaged, loading %s\n", name, mod->name);
+        Hunk_FreeToLowMark(mark);
+        return false;
+    }
+
+    memcpy(header.model.name, mod->name, sizeof(mod->name));
+    header.model.needload = mod->needload;
+    *mod = header.model;
+
+    // the renderer keeps its own copy of the sky
+    for (i = 0; i < mod->numtextures; i++)
+        if (mod->textures[i] && !strncmp(mod->textures[i]->name, "sky", 3))
+            R_InitSky(mod->textures[i]);
+
+    return true;
+}
+
+/*
+=================
+Mod_SetupSubmodels
+=================
+*/
+static void Mod_SetupSubmodels(model_t *mod)
+{
+    int32_t i, j;
+    dmodel_t *bm;
+
+    //
+    // set up the submodels (FIXME: this is confusing)
+    //
+    for (i = 0; i < mod->numsubmodels; i++)
+    {
+        bm = &mod->submodels[i];
+
+        mod->hulls[0].firstclipnode = bm->headnode[0];
+        for (j = 1; j < MAX_MAP_HULLS; j++)
+        {
+            mod->hulls[j].firstclipnode = bm->headnode[j];
+            mod->hulls[j].lastclipnode = mod->numclipnodes - 1;
+        }
+
+        mod->firstmodelsurface = bm->firstface;
+        mod->nummodelsurfaces = bm->numfaces;
+
+        VectorCopy(bm->maxs, mod->maxs);
+        VectorCopy(bm->mins, mod->mins);
+        mod->radius = RadiusFromBounds(mod->mins, mod->maxs);
+
+        mod->numleafs = bm->visleafs;
+
+        if (i < mod->numsubmodels - 1)
+        { // duplicate the basic information
+            char name[10];
+
+            sprintf(name, "*%i", i + 1);
+            loadmodel = Mod_FindName(name);
+            *loadmodel = *mod;
+            strcpy(loadmodel->name, name);
+            mod = loadmodel;
+        }
+    }
+}
+
 /*
 =================
 Mod_LoadBrushModel
@@ -1113,31 +1699,47 @@ Mod_LoadBrushModel
 */
 void Mod_LoadBrushModel(model_t *mod, void *buffer)
 {
-    int32_t i, j;
+    int32_t i;
     dheader_t *header;
-    dmodel_t *bm;
+    int32_t mark;
 
     loadmodel->type = mod_brush;
 
     header = (dheader_t *)buffer;
 
     i =  (header->version);
-    if (i != BSPVERSION)
+    if (i != BSPVERSION && i != BSP2VERSION)
         Sys_Error("Mod_LoadBrushModel: %s has wrong version number (%i should be %i)", mod->name, i, BSPVERSION);
+    mod_bsp2 = i == BSP2VERSION;
 
-    // swap all the lumps
-    mod_base = (uint8_t *)header;
+    if (mod_baking)
+    {
+        Memory_SetCategory(MEM_WORLD);
+        if (Mod_LoadBake(mod))
+        {
+            Mod_SetupSubmodels(mod);
+            return;
+        }
+
+        // everything has to land in the hunk range that gets written out
+        mod_view = false;
+    }
+    mark = Hunk_LowMark();
 
-    for (i = 0; i < sizeof(dheader_t) / 4; i++)
-        ((int32_t *)header)[i] =  (((int32_t *)header)[i]);
+    // the file may be a read-only view, nothing is swapped in place
+    mod_base = (uint8_t *)header;
 
     // load into heap
 
+    Memory_SetCategory(MEM_WORLD);
     Mod_LoadVertexes(&header->lumps[LUMP_VERTEXES]);
     Mod_LoadEdges(&header->lumps[LUMP_EDGES]);
     Mod_LoadSurfedges(&header->lumps[LUMP_SURFEDGES]);
+    Memory_SetCategory(MEM_TEXTURES);
     Mod_LoadTextures(&header->lumps[LUMP_TEXTURES]);
+    Memory_SetCategory(MEM_LIGHTING);
     Mod_LoadLighting(&header->lumps[LUMP_LIGHTING]);
+    Memory_SetCategory(MEM_WORLD);
     Mod_LoadPlanes(&header->lumps[LUMP_PLANES]);
     Mod_LoadTexinfo(&header->lumps[LUMP_TEXINFO]);
     Mod_LoadFaces(&header->lumps[LUMP_FACES]);
@@ -1154,40 +1756,367 @@ void Mod_LoadBrushModel(model_t *mod, void *buffer)
     mod->numframes = 2; // regular and alternate animation
     mod->flags = 0;
 
-    //
-    // set up the submodels (FIXME: this is confusing)
-    //
-    for (i = 0; i < mod->numsubmodels; i++)
+    if (mod_baking)
+        Mod_WriteBake(mod, Hunk_MarkPointer(mark), Hunk_LowMark() - mark);
+
+    Mod_SetupSubmodels(mod);
+}
+
+/*
+==============================================================================
+
+GENERATED MAP BENCHMARK
+
+bsp_benchmark builds a map in memory and times loading it and tracing
+through it.  The map is a balanced tree that halves a box along x, y and z
+in turn down to 2^depth leafs, so the default is well past what version 29
+indices can hold.  A map small enough for version 29 is also built in that
+format from the same seed, to compare the two.
+
+==============================================================================
+*/
+
+#define BENCH_EXTENT 4096 // the box reaches this far each way from the origin
+#define BENCH_MAXDEPTH 17 // 2^17 leafs and the solid leaf fit under MAX_MAP_LEAFS
+#define BENCH_V29DEPTH 14 // deepest tree whose indices fit in 16 bits
+#define BENCH_TRACELEN 256
+#define BENCH_LOADS 4
+
+typedef struct
+{
+    bool bsp2;
+    int32_t depth;
+    int32_t numnodes;
+    int32_t numleafs; // including the solid leaf 0
+    dplane_t *planes;
+    uint8_t *nodes, *clipnodes, *leafs;
+} benchmap_t;
+
+static uint32_t bench_seed;
+static model_t bench_model;
+
+/*
+=================
+Mod_BenchRandom
+
+Repeatable, so both formats get the same map and the same traces
+=================
+*/
+static float Mod_BenchRandom(float lo, float hi)
+{
+    bench_seed = bench_seed * 1664525 + 1013904223;
+    return lo + (hi - lo) * ((bench_seed >> 8) / (float)(1 << 24));
+}
+
+/*
+=================
+Mod_BenchWriteNode
+=================
+*/
+static void Mod_BenchWriteNode(benchmap_t *map, int32_t num, int32_t *children, int32_t *clipchildren, vec3_t mins,
+                               vec3_t maxs)
+{
+    dl2node_t *lnode;
+    dlclipnode_t *lclip;
+    dnode_t *node;
+    dclipnode_t *clip;
+    int32_t i;
+
+    if (map->bsp2)
     {
-        bm = &mod->submodels[i];
+        lnode = (dl2node_t *)map->nodes + num;
+        lclip = (dlclipnode_t *)map->clipnodes + num;
+        lnode->planenum = lclip->planenum = num;
+        for (i = 0; i < 3; i++)
+        {
+            lnode->mins[i] = mins[i];
+            lnode->maxs[i] = maxs[i];
+        }
+        for (i = 0; i < 2; i++)
+        {
+            lnode->children[i] = children[i];
+            lclip->children[i] = clipchildren[i];
+        }
+        return;
+    }
 
-        mod->hulls[0].firstclipnode = bm->headnode[0];
-        for (j = 1; j < MAX_MAP_HULLS; j++)
+    node = (dnode_t *)map->nodes + num;
+    clip = (dclipnode_t *)map->clipnodes + num;
+    node->planenum = clip->planenum = num;
+    for (i = 0; i < 3; i++)
+    {
+        node->mins[i] = mins[i];
+        node->maxs[i] = maxs[i];
+    }
+    for (i = 0; i < 2; i++)
+    {
+        node->children[i] = children[i];
+        clip->children[i] = clipchildren[i];
+    }
+}
+
+/*
+=================
+Mod_BenchWriteLeaf
+=================
+*/
+static void Mod_BenchWriteLeaf(benchmap_t *map, int32_t num, int32_t contents, vec3_t mins, vec3_t maxs)
+{
+    dl2leaf_t *lleaf;
+    dleaf_t *leaf;
+    int32_t i;
+
+    if (map->bsp2)
+    {
+        lleaf = (dl2leaf_t *)map->leafs + num;
+        lleaf->contents = contents;
+        lleaf->visofs = -1;
+        for (i = 0; i < 3; i++)
         {
-            mod->hulls[j].firstclipnode = bm->headnode[j];
-            mod->hulls[j].lastclipnode = mod->numclipnodes - 1;
+            lleaf->mins[i] = mins[i];
+            lleaf->maxs[i] = maxs[i];
         }
+        return;
+    }
 
-        mod->firstmodelsurface = bm->firstface;
-        mod->nummodelsurfaces = bm->numfaces;
+    leaf = (dleaf_t *)map->leafs + num;
+    leaf->contents = contents;
+    leaf->visofs = -1;
+    for (i = 0; i < 3; i++)
+    {
+        leaf->mins[i] = mins[i];
+        leaf->maxs[i] = maxs[i];
+    }
+}
 
-        VectorCopy(bm->maxs, mod->maxs);
-        VectorCopy(bm->mins, mod->mins);
-        mod->radius = RadiusFromBounds(mod->mins, mod->maxs);
+/*
+=================
+Mod_BenchBuild
 
-        mod->numleafs = bm->visleafs;
+Returns the child number of the tree for the box, and the contents a
+clipnode should use in its place if that is a leaf
+=================
+*/
+static int32_t Mod_BenchBuild(benchmap_t *map, int32_t level, vec3_t mins, vec3_t maxs, int32_t *contents)
+{
+    int32_t num, axis, side;
+    int32_t children[2], clipchildren[2];
+    vec3_t cmins, cmaxs;
+    dplane_t *plane;
 
-        if (i < mod->numsubmodels - 1)
-        { // duplicate the basic information
-            char name[10];
+    if (level == map->depth)
+    {
+        num = map->numleafs++;
+        *contents = Mod_BenchRandom(0, 1) < 0.125f ? CONTENTS_SOLID : CONTENTS_EMPTY;
+        Mod_BenchWriteLeaf(map, num, *contents, mins, maxs);
+        return -1 - num;
+    }
 
-            sprintf(name, "*%i", i + 1);
-            loadmodel = Mod_FindName(name);
-            *loadmodel = *mod;
-            strcpy(loadmodel->name, name);
-            mod = loadmodel;
+    // numbered before the children, so the head node is 0
+    num = map->numnodes++;
+    axis = level % 3;
+    plane = &map->planes[num];
+    plane->normal[axis] = 1;
+    plane->dist = (mins[axis] + maxs[axis]) / 2;
+    plane->type = PLANE_X + axis;
+
+    for (side = 0; side < 2; side++)
+    {
+        VectorCopy(mins, cmins);
+        VectorCopy(maxs, cmaxs);
+        if (side)
+            cmaxs[axis] = plane->dist;
+        else
+            cmins[axis] = plane->dist;
+        children[side] = Mod_BenchBuild(map, level + 1, cmins, cmaxs, &clipchildren[side]);
+        if (children[side] >= 0)
+            clipchildren[side] = children[side];
+    }
+
+    Mod_BenchWriteNode(map, num, children, clipchildren, mins, maxs);
+    return num;
+}
+
+/*
+=================
+Mod_BenchLump
+=================
+*/
+static void *Mod_BenchLump(dheader_t *header, int32_t lump, int32_t *ofs, int32_t len)
+{
+    header->lumps[lump].fileofs = *ofs;
+    header->lumps[lump].filelen = len;
+    *ofs += (len + 3) & ~3;
+    return (uint8_t *)header + header->lumps[lump].fileofs;
+}
+
+/*
+=================
+Mod_BenchMakeMap
+
+A .bsp image in the format asked for, NULL if there isn't the memory
+=================
+*/
+static dheader_t *Mod_BenchMakeMap(bool bsp2, int32_t depth)
+{
+    static char entities[] = "{\n\"classname\" \"worldspawn\"\n}\n";
+    benchmap_t map;
+    dheader_t *header;
+    dmodel_t *model;
+    int32_t i, ofs, numnodes, numleafs, nodesize, clipsize, leafsize, contents;
+    vec3_t mins, maxs;
+
+    numnodes = (1 << depth) - 1;
+    numleafs = (1 << depth) + 1;
+    nodesize = bsp2 ? sizeof(dl2node_t) : sizeof(dnode_t);
+    clipsize = bsp2 ? sizeof(dlclipnode_t) : sizeof(dclipnode_t);
+    leafsize = bsp2 ? sizeof(dl2leaf_t) : sizeof(dleaf_t);
+
+    header = calloc(1, sizeof(*header) + numnodes * (sizeof(dplane_t) + nodesize + clipsize) + numleafs * leafsize +
+                           sizeof(dmodel_t) + sizeof(entities) + 16);
+    if (!header)
+        return NULL;
+    header->version = bsp2 ? BSP2VERSION : BSPVERSION;
+
+    memset(&map, 0, sizeof(map));
+    map.bsp2 = bsp2;
+    map.depth = depth;
+    ofs = sizeof(*header);
+    map.planes = Mod_BenchLump(header, LUMP_PLANES, &ofs, numnodes * sizeof(dplane_t));
+    map.nodes = Mod_BenchLump(header, LUMP_NODES, &ofs, numnodes * nodesize);
+    map.clipnodes = Mod_BenchLump(header, LUMP_CLIPNODES, &ofs, numnodes * clipsize);
+    map.leafs = Mod_BenchLump(header, LUMP_LEAFS, &ofs, numleafs * leafsize);
+    model = Mod_BenchLump(header, LUMP_MODELS, &ofs, sizeof(dmodel_t));
+    memcpy(Mod_BenchLump(header, LUMP_ENTITIES, &ofs, sizeof(entities)), entities, sizeof(entities));
+    for (i = 0; i < HEADER_LUMPS; i++)
+        if (!header->lumps[i].filelen)
+            header->lumps[i].fileofs = sizeof(*header);
+
+    for (i = 0; i < 3; i++)
+    {
+        mins[i] = -BENCH_EXTENT;
+        maxs[i] = BENCH_EXTENT;
+    }
+    Mod_BenchWriteLeaf(&map, 0, CONTENTS_SOLID, vec3_origin, vec3_origin);
+    map.numleafs = 1;
+    Mod_BenchBuild(&map, 0, mins, maxs, &contents);
+
+    VectorCopy(mins, model->mins);
+    VectorCopy(maxs, model->maxs);
+    model->visleafs = numleafs - 1;
+
+    return header;
+}
+
+/*
+=================
+Mod_BenchRun
+=================
+*/
+static void Mod_BenchRun(bool bsp2, int32_t depth, int32_t traces)
+{
+    dheader_t *header;
+    int32_t i, j, load, mark, hull, solid, hits;
+    bool baking;
+    float *points, *end;
+    double start, loadtime, pointtime, tracetime[2];
+    trace_t trace;
+
+    bench_seed = 1;
+    header = Mod_BenchMakeMap(bsp2, depth);
+    points = malloc(traces * 6 * sizeof(*points));
+    if (!header || !points)
+    {
+        Con_Printf("Not enough memory for a depth %i map\n", depth);
+        free(header);
+        free(points);
+        return;
+    }
+
+    for (i = 0; i < traces; i++)
+        for (j = 0; j < 3; j++)
+        {
+            points[i * 6 + j] = Mod_BenchRandom(-BENCH_EXTENT, BENCH_EXTENT);
+            points[i * 6 + 3 + j] = points[i * 6 + j] + Mod_BenchRandom(-BENCH_TRACELEN, BENCH_TRACELEN);
         }
+
+    // loaded the way a map read out of a file is, never baked
+    baking = mod_baking;
+    mod_baking = false;
+    mod_view = false;
+    mark = Hunk_LowMark();
+    start = Sys_FloatTime();
+    for (load = 0; load < BENCH_LOADS; load++)
+    {
+        Hunk_FreeToLowMark(mark);
+        memset(&bench_model, 0, sizeof(bench_model));
+        strcpy(bench_model.name, "bsp_benchmark");
+        strcpy(loadname, "bench");
+        loadmodel = &bench_model;
+        Mod_LoadBrushModel(&bench_model, header);
     }
+    loadtime = (Sys_FloatTime() - start) / BENCH_LOADS;
+    mod_baking = baking;
+    free(header);
+
+    start = Sys_FloatTime();
+    for (i = solid = 0; i < traces; i++)
+        if (Mod_PointInLeaf(points + i * 6, &bench_model)->contents == CONTENTS_SOLID)
+            solid++;
+    pointtime = Sys_FloatTime() - start;
+
+    for (hull = hits = 0; hull < 2; hull++)
+    {
+        start = Sys_FloatTime();
+        for (i = 0; i < traces; i++)
+        {
+            memset(&trace, 0, sizeof(trace));
+            trace.fraction = 1;
+            trace.allsolid = true;
+            end = points + i * 6 + 3;
+            VectorCopy(end, trace.endpos);
+            SV_RecursiveHullCheck(&bench_model.hulls[hull], bench_model.hulls[hull].firstclipnode, 0, 1,
+                                  points + i * 6, end, &trace);
+            if (trace.fraction < 1)
+                hits++;
+        }
+        tracetime[hull] = Sys_FloatTime() - start;
+    }
+
+    Con_Printf("%s: %i nodes, %i leafs\n", bsp2 ? "BSP2" : "version 29", bench_model.numnodes,
+               bench_model.numleafs);
+    Con_Printf("%i points solid, %i traces hit\n", solid, hits);
+    Con_Printf("load   %10.2f ms\n", loadtime * 1000);
+    Con_Printf("point  %10.0f lookups/sec\n", traces / (pointtime > 0 ? pointtime : 1e-9));
+    Con_Printf("hull 0 %10.0f traces/sec\n", traces / (tracetime[0] > 0 ? tracetime[0] : 1e-9));
+    Con_Printf("hull 1 %10.0f traces/sec\n", traces / (tracetime[1] > 0 ? tracetime[1] : 1e-9));
+
+    Hunk_FreeToLowMark(mark);
+    memset(&bench_model, 0, sizeof(bench_model));
+    free(points);
+}
+
+/*
+=================
+Mod_Benchmark_f
+
+bsp_benchmark [depth] [traces].  The loads go in the hunk, flushing what
+the cache holds in the way.
+=================
+*/
+static void Mod_Benchmark_f(void)
+{
+    int32_t depth, traces;
+
+    depth = Cmd_Argc() > 1 ? (int32_t)strtol(Cmd_Argv(1), NULL, 0) : BENCH_MAXDEPTH;
+    depth = depth < 1 ? 1 : depth > BENCH_MAXDEPTH ? BENCH_MAXDEPTH : depth;
+    traces = Cmd_Argc() > 2 ? (int32_t)strtol(Cmd_Argv(2), NULL, 0) : 100000;
+    if (traces < 1)
+        traces = 1;
+
+    Mod_BenchRun(true, depth, traces);
+    if (depth <= BENCH_V29DEPTH)
+        Mod_BenchRun(false, depth, traces);
 }
 
 /*
@@ -1586,7 +2515,7 @@ void Mod_LoadAliasModel(model_t *mod, void *buffer)
     end = Hunk_LowMark();
     total = end - start;
 
-    Cache_Alloc(&mod->cache, total, loadname);
+    Cache_Alloc(&mod->cache, total, loadname, MEM_MODELS);
     if (!mod->cache.data)
         return;
     memcpy(mod->cache.data, pheader, total);
@@ -1794,6 +2723,8 @@ void Mod_Print(void)
             Con_Printf(" (!R)");
         if (mod->needload & NL_NEEDS_LOADED)
             Con_Printf(" (!P)");
+        if (mod->retained)
+            Con_Printf(" (retained)");
         Con_Printf("\n");
     }
 }
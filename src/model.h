@@ -65,7 +65,7 @@ typedef struct texture_s
 // !!! if this is changed, it must be changed in asm_draw.h too !!!
 typedef struct
 {
-    uint16_t v[2];
+    uint32_t v[2];
     uint32_t cachededgeoffset;
 } medge_t;
 
@@ -117,8 +117,8 @@ typedef struct mnode_s
     mplane_t *plane;
     struct mnode_s *children[2];
 
-    uint16_t firstsurface;
-    uint16_t numsurfaces;
+    uint32_t firstsurface;
+    uint32_t numsurfaces;
 } mnode_t;
 
 typedef struct mleaf_s
@@ -134,6 +134,8 @@ typedef struct mleaf_s
     // leaf specific
     uint8_t *compressed_vis;
     efrag_t *efrags;
+    struct entity_s **efragents; // flattened efrags, valid while the leaf is visible
+    int32_t numefragents;
 
     msurface_t **firstmarksurface;
     int32_t nummarksurfaces;
@@ -141,10 +143,17 @@ typedef struct mleaf_s
     uint8_t ambient_sound_level[NUM_AMBIENTS];
 } mleaf_t;
 
+// the clipnodes of either file version, as the hulls walk them
+typedef struct
+{
+    int32_t planenum;
+    int32_t children[2]; // negative numbers are contents
+} mclipnode_t;
+
 // !!! if this is changed, it must be changed in asm_i386.h too !!!
 typedef struct
 {
-    dclipnode_t *clipnodes;
+    mclipnode_t *clipnodes;
     mplane_t *planes;
     int32_t firstclipnode;
     int32_t lastclipnode;
@@ -281,7 +290,11 @@ typedef enum
 typedef struct model_s
 {
     char name[MAX_QPATH];
-    bool needload; // bmodels and sprites don't cache normally
+    int32_t needload; // bmodels and sprites don't cache normally
+
+    bool retained;    // in the retained tier, kept across map changes
+    int32_t filesize; // of the file it was loaded from, with its crc,
+    uint32_t crc;     // to make sure a retained model is still current
 
     modtype_t type;
     int32_t numframes;
@@ -328,7 +341,7 @@ typedef struct model_s
     int32_t *surfedges;
 
     int32_t numclipnodes;
-    dclipnode_t *clipnodes;
+    mclipnode_t *clipnodes;
 
     int32_t nummarksurfaces;
     msurface_t **marksurfaces;
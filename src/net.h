@@ -195,6 +195,8 @@ extern int32_t messagesSent;
 extern int32_t messagesReceived;
 extern int32_t unreliableMessagesSent;
 extern int32_t unreliableMessagesReceived;
+extern int32_t net_bytesSent;
+extern int32_t net_bytesReceived;
 
 qsocket_t *NET_NewQSocket(void);
 void NET_FreeQSocket(qsocket_t *);
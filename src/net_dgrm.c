@@ -613,6 +613,8 @@ int32_t Datagram_Init(void)
 
     myDriverLevel = net_driverlevel;
     Cmd_AddCommand("net_stats", NET_Stats_f);
+    Counter_Register("net_packetsout", &packetsSent, CNT_TOTAL);
+    Counter_Register("net_packetsin", &packetsReceived, CNT_TOTAL);
 
     if (COM_CheckParm("-nolan"))
         return -1;
@@ -42,6 +42,8 @@ int32_t messagesSent = 0;
 int32_t messagesReceived = 0;
 int32_t unreliableMessagesSent = 0;
 int32_t unreliableMessagesReceived = 0;
+int32_t net_bytesSent = 0;
+int32_t net_bytesReceived = 0;
 
 static cvar_t net_messagetimeout = {"net_messagetimeout", "300"};
 cvar_t hostname = {"hostname", "UNNAMED"};
@@ -528,6 +530,7 @@ int32_t NET_GetMessage(qsocket_t *sock)
 
     if (ret > 0)
     {
+        net_bytesReceived += net_message.cursize;
         if (sock->driver)
         {
             sock->lastMessageTime = net_time;
@@ -597,6 +600,8 @@ int32_t NET_SendMessage(qsocket_t *sock, sizebuf_t *data)
 
     SetNetTime();
     r = sfunc.QSendMessage(sock, data);
+    if (r == 1)
+        net_bytesSent += data->cursize;
     if (r == 1 && sock->driver)
         messagesSent++;
 
@@ -627,6 +632,8 @@ int32_t NET_SendUnreliableMessage(qsocket_t *sock, sizebuf_t *data)
 
     SetNetTime();
     r = sfunc.SendUnreliableMessage(sock, data);
+    if (r == 1)
+        net_bytesSent += data->cursize;
     if (r == 1 && sock->driver)
         unreliableMessagesSent++;
 
@@ -822,6 +829,11 @@ void NET_Init(void)
     Cmd_AddCommand("maxplayers", MaxPlayers_f);
     Cmd_AddCommand("port", NET_Port_f);
 
+    Counter_Register("net_msgsout", &messagesSent, CNT_TOTAL);
+    Counter_Register("net_msgsin", &messagesReceived, CNT_TOTAL);
+    Counter_Register("net_bytesout", &net_bytesSent, CNT_TOTAL);
+    Counter_Register("net_bytesin", &net_bytesReceived, CNT_TOTAL);
+
     // initialize all the drivers
     for (net_driverlevel = 0; net_driverlevel < net_numdrivers; net_driverlevel++)
     {
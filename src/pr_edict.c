@@ -667,9 +667,12 @@ char *ED_NewString(char *string)
 {
     char *new, *new_p;
     int32_t i, l;
+    memcat_t oldcategory;
 
     l = strlen(string) + 1;
+    oldcategory = Memory_SetCategory(MEM_EDICTS);
     new = Hunk_Alloc(l);
+    Memory_SetCategory(oldcategory);
     new_p = new;
 
     for (i = 0; i < l; i++)
@@ -955,6 +958,7 @@ PR_LoadProgs
 void PR_LoadProgs(void)
 {
     int32_t i;
+    memcat_t oldcategory;
 
     // flush the non-C variable lookup cache
     for (i = 0; i < GEFV_CACHESIZE; i++)
@@ -962,7 +966,9 @@ void PR_LoadProgs(void)
 
     CRC_Init(&pr_crc);
 
+    oldcategory = Memory_SetCategory(MEM_PROGS);
     progs = (dprograms_t *)COM_LoadHunkFile("progs.dat");
+    Memory_SetCategory(oldcategory);
     if (!progs)
         Sys_Error("PR_LoadProgs: couldn't load progs.dat");
     Con_DPrintf("Programs occupy %iK.\n", com_filesize / 1024);
@@ -1040,6 +1046,7 @@ void PR_Init(void)
     Cmd_AddCommand("edicts", ED_PrintEdicts);
     Cmd_AddCommand("edictcount", ED_Count);
     Cmd_AddCommand("profile", PR_Profile_f);
+    Counter_Register("pr_statements", &pr_statementcount, CNT_COUNT);
     Cvar_RegisterVariable(&nomonsters);
     Cvar_RegisterVariable(&gamecfg);
     Cvar_RegisterVariable(&scratch1);
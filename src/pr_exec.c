@@ -22,6 +22,7 @@ static int32_t localstack_used;
 bool pr_trace;
 dfunction_t *pr_xfunction;
 int32_t pr_xstatement;
+int32_t pr_statementcount;
 
 int32_t pr_argc;
 
@@ -308,6 +309,9 @@ void PR_ExecuteProgram(func_t fnum)
     runaway = 100000;
     pr_trace = false;
 
+    PROF_BEGIN("PR_ExecuteProgram");
+    HWPERF_BEGIN(HWP_QC);
+
     // make a stack frame
     exitdepth = pr_depth;
 
@@ -554,7 +558,12 @@ void PR_ExecuteProgram(func_t fnum)
 
             s = PR_LeaveFunction();
             if (pr_depth == exitdepth)
+            {
+                pr_statementcount += 100000 - runaway;
+                HWPERF_END(HWP_QC);
+                PROF_END();
                 return; // all done
+            }
             break;
 
         case OP_STATE:
@@ -0,0 +1,388 @@
+// prof.c -- scoped zone profiler
+
+#include "quakedef.h"
+
+#define MAX_PROF_DEPTH 32
+#define MAX_PROF_EVENTS 262144
+#define PROF_RING_EVENTS 524288 // must be a power of two
+#define PROF_RING_MARKS 1024    // must be a power of two
+#define MAX_MARK_TEXT 80
+
+typedef struct
+{
+    char *name;
+    double start, end;
+} profevent_t;
+
+typedef struct
+{
+    char *name;
+    double start;
+} profzone_t;
+
+typedef struct
+{
+    char *category;
+    double time;
+    char text[MAX_MARK_TEXT];
+} profmark_t;
+
+bool prof_active;
+
+static cvar_t hitch_threshold = {"hitch_threshold", "0"}; // milliseconds, 0 disables the detector
+static cvar_t hitch_window = {"hitch_window", "3"};       // seconds written before each hitch
+
+static profzone_t prof_stack[MAX_PROF_DEPTH];
+static int32_t prof_depth;
+static int32_t prof_overflow; // enters dropped past MAX_PROF_DEPTH, their leaves are ignored
+
+// tracedump capture
+static profevent_t *prof_events;
+static int32_t prof_numevents;
+static int32_t prof_dropped;
+
+static int32_t prof_wantframes; // frames still to capture
+static int32_t prof_frames;     // frames captured so far
+static bool prof_capturing;
+static bool prof_pending;       // capture begins with the next frame
+static double prof_basetime;
+static char prof_filename[MAX_OSPATH];
+
+// hitch detector history, oldest entries are overwritten
+static profevent_t *prof_ring;
+static uint32_t prof_ringhead;
+static profmark_t *prof_marks;
+static uint32_t prof_markhead;
+static int32_t prof_hitches;
+
+/*
+================
+Prof_Enter
+================
+*/
+void Prof_Enter(char *name)
+{
+    if (prof_depth == MAX_PROF_DEPTH)
+    {
+        prof_overflow++;
+        prof_dropped++;
+        return;
+    }
+
+    prof_stack[prof_depth].name = name;
+    prof_stack[prof_depth].start = Sys_FloatTime();
+    prof_depth++;
+}
+
+/*
+================
+Prof_Leave
+================
+*/
+void Prof_Leave(void)
+{
+    profevent_t *ev;
+    double end;
+
+    if (prof_overflow)
+    {
+        prof_overflow--;
+        return;
+    }
+    if (!prof_depth)
+        return; // began before the capture did
+
+    prof_depth--;
+    end = Sys_FloatTime();
+
+    if (prof_ring)
+    {
+        ev = &prof_ring[prof_ringhead++ & (PROF_RING_EVENTS - 1)];
+        ev->name = prof_stack[prof_depth].name;
+        ev->start = prof_stack[prof_depth].start;
+        ev->end = end;
+    }
+
+    if (!prof_capturing)
+        return;
+
+    if (prof_numevents == MAX_PROF_EVENTS)
+    {
+        prof_dropped++;
+        return;
+    }
+
+    ev = &prof_events[prof_numevents++];
+    ev->name = prof_stack[prof_depth].name;
+    ev->start = prof_stack[prof_depth].start;
+    ev->end = end;
+}
+
+/*
+================
+Prof_Mark
+
+Notes something that happened at this moment, such as a file being loaded,
+for the hitch detector.  category must be a string constant.
+================
+*/
+void Prof_Mark(char *category, char *fmt, ...)
+{
+    va_list argptr;
+    profmark_t *mark;
+
+    if (!prof_marks)
+        return;
+
+    mark = &prof_marks[prof_markhead++ & (PROF_RING_MARKS - 1)];
+    mark->category = category;
+    mark->time = Sys_FloatTime();
+
+    va_start(argptr, fmt);
+    vsnprintf(mark->text, sizeof(mark->text), fmt, argptr);
+    va_end(argptr);
+}
+
+/*
+================
+Prof_WriteEvent
+================
+*/
+static void Prof_WriteEvent(FILE *f, profevent_t *ev, double basetime, bool first)
+{
+    fprintf(f, "%s{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":%.3f,\"dur\":%.3f}", first ? "" : ",\n",
+            ev->name, (ev->start - basetime) * 1e6, (ev->end - ev->start) * 1e6);
+}
+
+/*
+================
+Prof_WriteTrace
+================
+*/
+static void Prof_WriteTrace(void)
+{
+    FILE *f;
+    int32_t i;
+    char name[MAX_OSPATH];
+
+    snprintf(name, sizeof(name), "%s/%s", com_gamedir, prof_filename);
+    f = fopen(name, "w");
+    if (!f)
+    {
+        Con_Printf("Couldn't write %s\n", prof_filename);
+        return;
+    }
+
+    fprintf(f, "{\"traceEvents\":[\n");
+    for (i = 0; i < prof_numevents; i++)
+        Prof_WriteEvent(f, &prof_events[i], prof_basetime, !i);
+    fprintf(f, "\n],\"displayTimeUnit\":\"ms\"}\n");
+    fclose(f);
+
+    Con_Printf("Wrote %d frames, %d zones to %s\n", prof_frames, prof_numevents, prof_filename);
+    if (prof_dropped)
+        Con_Printf("%d zones did not fit\n", prof_dropped);
+}
+
+/*
+================
+Prof_WriteHitch
+
+Writes the last hitch_window seconds of zones, and every load or allocation
+noted in that time, as a trace named hitchNNNN.json
+================
+*/
+static void Prof_WriteHitch(double frametime)
+{
+    FILE *f;
+    uint32_t i, count;
+    double from, basetime;
+    profmark_t *mark;
+    bool first;
+    char *c, filename[32], name[MAX_OSPATH];
+
+    snprintf(filename, sizeof(filename), "hitch%04d.json", prof_hitches++);
+    snprintf(name, sizeof(name), "%s/%s", com_gamedir, filename);
+    f = fopen(name, "w");
+    if (!f)
+    {
+        Con_Printf("Couldn't write %s\n", filename);
+        return;
+    }
+
+    from = Sys_FloatTime() - hitch_window.value;
+
+    // find the oldest zone still inside the window
+    count = prof_ringhead < PROF_RING_EVENTS ? prof_ringhead : PROF_RING_EVENTS;
+    for (i = prof_ringhead - count; i != prof_ringhead; i++)
+        if (prof_ring[i & (PROF_RING_EVENTS - 1)].start >= from)
+            break;
+
+    basetime = i != prof_ringhead ? prof_ring[i & (PROF_RING_EVENTS - 1)].start : from;
+    first = true;
+
+    fprintf(f, "{\"traceEvents\":[\n");
+    for (; i != prof_ringhead; i++, first = false)
+        Prof_WriteEvent(f, &prof_ring[i & (PROF_RING_EVENTS - 1)], basetime, first);
+
+    count = prof_markhead < PROF_RING_MARKS ? prof_markhead : PROF_RING_MARKS;
+    for (i = prof_markhead - count; i != prof_markhead; i++)
+    {
+        mark = &prof_marks[i & (PROF_RING_MARKS - 1)];
+        if (mark->time < basetime)
+            continue;
+
+        // file names are all the text can hold that needs escaping
+        for (c = mark->text; *c; c++)
+            if (*c == '"' || *c == '\\')
+                *c = '/';
+
+        fprintf(f, "%s{\"name\":\"%s\",\"ph\":\"i\",\"s\":\"g\",\"pid\":1,\"tid\":1,\"ts\":%.3f,"
+                   "\"args\":{\"what\":\"%s\"}}",
+                first ? "" : ",\n", mark->category, (mark->time - basetime) * 1e6, mark->text);
+        first = false;
+    }
+    fprintf(f, "\n],\"displayTimeUnit\":\"ms\"}\n");
+    fclose(f);
+
+    Con_Printf("%.1f ms frame, wrote %s\n", frametime * 1000, filename);
+}
+
+/*
+================
+Prof_CheckHitchDetector
+
+Allocates or frees the history as hitch_threshold is turned on and off
+================
+*/
+static void Prof_CheckHitchDetector(void)
+{
+    if (hitch_threshold.value > 0 && !prof_ring)
+    {
+        prof_ring = malloc(PROF_RING_EVENTS * sizeof(*prof_ring));
+        prof_marks = calloc(PROF_RING_MARKS, sizeof(*prof_marks));
+        if (!prof_ring || !prof_marks)
+        {
+            free(prof_ring);
+            free(prof_marks);
+            prof_ring = NULL;
+            prof_marks = NULL;
+            Con_Printf("Not enough memory for the hitch detector\n");
+            Cvar_Set("hitch_threshold", "0");
+            return;
+        }
+        prof_ringhead = prof_markhead = 0;
+    }
+    else if (hitch_threshold.value <= 0 && prof_ring)
+    {
+        free(prof_ring);
+        free(prof_marks);
+        prof_ring = NULL;
+        prof_marks = NULL;
+    }
+}
+
+/*
+================
+Prof_BeginFrame
+================
+*/
+void Prof_BeginFrame(void)
+{
+    prof_depth = 0;
+    prof_overflow = 0;
+
+    Prof_CheckHitchDetector();
+
+    if (prof_pending)
+    {
+        prof_pending = false;
+        prof_capturing = true;
+        prof_numevents = 0;
+        prof_dropped = 0;
+        prof_frames = 0;
+        prof_basetime = Sys_FloatTime();
+    }
+
+    prof_active = prof_capturing || prof_ring;
+
+    PROF_BEGIN("frame");
+}
+
+/*
+================
+Prof_EndFrame
+================
+*/
+void Prof_EndFrame(void)
+{
+    profevent_t *frame;
+
+    if (!prof_active)
+        return;
+
+    prof_overflow = 0;
+    while (prof_depth)
+        Prof_Leave();
+
+    if (prof_ring && prof_ringhead)
+    {
+        // the frame zone is always the last one to close
+        frame = &prof_ring[(prof_ringhead - 1) & (PROF_RING_EVENTS - 1)];
+        if ((frame->end - frame->start) * 1000 > hitch_threshold.value)
+            Prof_WriteHitch(frame->end - frame->start);
+    }
+
+    if (!prof_capturing || ++prof_frames < prof_wantframes)
+        return;
+
+    prof_capturing = false;
+    prof_active = prof_ring != NULL;
+    Prof_WriteTrace();
+    free(prof_events);
+    prof_events = NULL;
+}
+
+/*
+================
+Prof_TraceDump_f
+
+tracedump [frames] [filename]
+================
+*/
+static void Prof_TraceDump_f(void)
+{
+    if (prof_capturing || prof_pending)
+    {
+        Con_Printf("A trace is already being captured\n");
+        return;
+    }
+
+    prof_wantframes = Cmd_Argc() > 1 ? (int32_t)strtol(Cmd_Argv(1), NULL, 0) : 60;
+    if (prof_wantframes < 1)
+        prof_wantframes = 1;
+
+    snprintf(prof_filename, sizeof(prof_filename), "%s", Cmd_Argc() > 2 ? Cmd_Argv(2) : "trace.json");
+
+    prof_events = malloc(MAX_PROF_EVENTS * sizeof(*prof_events));
+    if (!prof_events)
+    {
+        Con_Printf("Not enough memory for a trace\n");
+        return;
+    }
+
+    prof_pending = true;
+    Con_Printf("Capturing %d frames\n", prof_wantframes);
+}
+
+/*
+================
+Prof_Init
+================
+*/
+void Prof_Init(void)
+{
+    Cvar_RegisterVariable(&hitch_threshold);
+    Cvar_RegisterVariable(&hitch_window);
+    Cmd_AddCommand("tracedump", Prof_TraceDump_f);
+}
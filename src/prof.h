@@ -0,0 +1,50 @@
+/*
+ prof.h -- scoped zone profiler
+
+Prof_??? Interesting stretches of a frame are bracketed with PROF_BEGIN and
+PROF_END.  Zones nest, so a zone begun inside another shows up as its child.
+Zone names must be string constants, they are kept by pointer.
+
+Nothing is recorded until a capture is started with the tracedump command,
+so an idle zone costs a single test of prof_active.  Captured frames are
+written as Chrome trace event JSON, which chrome://tracing and Perfetto
+both load.
+
+Setting hitch_threshold to a number of milliseconds keeps the last few
+seconds of zones in memory instead.  Any frame that takes longer than the
+threshold writes the hitch_window seconds leading up to it as hitchNNNN.json,
+together with the Prof_Mark notes (file loads, hunk and cache allocations,
+cache evictions) made in that time.
+
+Zones may only be used on the main thread.
+*/
+
+extern bool prof_active;
+
+void Prof_Init(void);
+
+void Prof_BeginFrame(void);
+void Prof_EndFrame(void);
+// bracket a whole host frame, zones left open by a Host_Error longjmp are
+// discarded unrecorded when the next frame begins
+
+void Prof_Enter(char *name);
+void Prof_Leave(void);
+
+void Prof_Mark(char *category, char *fmt, ...);
+// notes a load or allocation for the hitch detector, does nothing unless it
+// is running
+
+#define PROF_BEGIN(name)       \
+    do                         \
+    {                          \
+        if (prof_active)       \
+            Prof_Enter(name);  \
+    } while (0)
+
+#define PROF_END()             \
+    do                         \
+    {                          \
+        if (prof_active)       \
+            Prof_Leave();      \
+    } while (0)
@@ -18,7 +18,7 @@ typedef struct edict_s
     link_t area; // linked to a division node or leaf
 
     int32_t num_leafs;
-    int16_t leafnums[MAX_ENT_LEAFS];
+    int32_t leafnums[MAX_ENT_LEAFS];
 
     entity_state_t baseline;
 
@@ -102,6 +102,7 @@ extern int32_t pr_argc;
 extern bool pr_trace;
 extern dfunction_t *pr_xfunction;
 extern int32_t pr_xstatement;
+extern int32_t pr_statementcount; // statements run, for the counter registry
 
 extern uint16_t pr_crc;
 
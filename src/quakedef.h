@@ -204,6 +204,12 @@ typedef struct
 #include "menu.h"
 #include "crc.h"
 #include "cdaudio.h"
+#include "tasks.h"
+#include "image.h"
+#include "inflate.h"
+#include "prof.h"
+#include "counter.h"
+#include "hwperf.h"
 
 //=============================================================================
 
@@ -236,6 +242,7 @@ extern cvar_t developer;
 
 extern bool host_initialized; // true if into command execution
 extern double host_frametime;
+extern bool host_fixedtick; // local server is stepped at host_tickrate
 extern uint8_t *host_basepal;
 extern uint8_t *host_colormap;
 extern int32_t host_framecount; // incremented every frame, never reset
@@ -250,6 +257,7 @@ void Host_Shutdown(void);
 void Host_Error(char *error, ...);
 void Host_EndGame(char *message, ...);
 void Host_Frame(float time);
+double Host_FrameWait(void);
 void Host_Quit_f(void);
 void Host_ClientCommands(char *fmt, ...);
 void Host_ShutdownServer(bool crash);
@@ -32,6 +32,7 @@ static vec3_t alias_forward, alias_right, alias_up;
 static maliasskindesc_t *pskindesc;
 
 int32_t r_amodels_drawn;
+int32_t r_aliaspolys;
 int32_t a_skinwidth;
 static int32_t r_anumverts;
 
@@ -649,6 +650,7 @@ void R_AliasDrawModel(alight_t *plighting)
 
     paliashdr = (aliashdr_t *)Mod_Extradata(currententity->model);
     pmdl = (mdl_t *)((uint8_t *)paliashdr + paliashdr->model);
+    r_aliaspolys += pmdl->numtris;
 
     R_AliasSetupSkin();
     R_AliasSetUpTransform(currententity->trivial_accept);
@@ -489,7 +489,7 @@ void R_RecursiveWorldNode(mnode_t *node, int32_t clipflags)
         // deal with model fragments in this leaf
         if (pleaf->efrags)
         {
-            R_StoreEfrags(&pleaf->efrags);
+            R_StoreEfrags(pleaf);
         }
 
         pleaf->key = r_currentkey;
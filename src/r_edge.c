@@ -31,6 +31,8 @@ static espan_t *span_p, *max_span_p;
 
 int32_t r_currentkey;
 
+int32_t r_spancount; // spans emitted this frame
+
 extern int32_t screenwidth;
 
 static int32_t current_iv;
@@ -676,6 +678,8 @@ void R_ScanEdges(void)
             S_ExtraUpdate(); // don't let sound get messed up if going slow
             VID_LockBuffer();
 
+            r_spancount += span_p - basespan_p;
+
             if (r_drawculledpolys)
             {
                 R_DrawCulledPolys();
@@ -713,6 +717,8 @@ void R_ScanEdges(void)
     (*pdrawfunc)();
 
     // draw whatever's left in the span list
+    r_spancount += span_p - basespan_p;
+
     if (r_drawculledpolys)
         R_DrawCulledPolys();
     else
@@ -21,6 +21,64 @@ vec3_t r_emins, r_emaxs;
 
 static entity_t *r_addent;
 
+#define EFRAG_BLOCK 256 // efrags added to the pool each time it runs dry
+
+static cvar_t r_efragcache = {"r_efragcache", "1"};
+
+static bool r_efragsdirty = true; // efrags were linked or unlinked since the last cache build
+static int32_t r_efragcacheframe = -1;  // r_visframecount the cache was built for
+static entity_t **r_efragents;          // backing store for every leaf's efragents
+static int32_t r_maxefragents;
+
+/*
+================
+R_InitEfrags
+================
+*/
+void R_InitEfrags(void)
+{
+    Cvar_RegisterVariable(&r_efragcache);
+}
+
+/*
+================
+R_EfragsChanged
+
+Forces the per leaf entity lists to be rebuilt on the next frame
+================
+*/
+void R_EfragsChanged(void)
+{
+    r_efragsdirty = true;
+}
+
+/*
+================
+R_NewEfrag
+
+The pool starts as cl_efrags and grows in hunk blocks, which go away with
+the rest of the level when the hunk is freed to the host low mark
+================
+*/
+static efrag_t *R_NewEfrag(void)
+{
+    efrag_t *ef;
+    int32_t i;
+
+    if (!cl.free_efrags)
+    {
+        ef = Hunk_AllocName(EFRAG_BLOCK * sizeof(efrag_t), "efrags");
+        for (i = 0; i < EFRAG_BLOCK - 1; i++)
+            ef[i].entnext = &ef[i + 1];
+        ef[i].entnext = NULL;
+        cl.free_efrags = ef;
+    }
+
+    ef = cl.free_efrags;
+    cl.free_efrags = ef->entnext;
+    return ef;
+}
+
 /*
 ================
 R_RemoveEfrags
@@ -60,6 +118,7 @@ void R_RemoveEfrags(entity_t *ent)
     }
 
     ent->efrag = NULL;
+    r_efragsdirty = true;
 }
 
 /*
@@ -88,15 +147,7 @@ static void R_SplitEntityOnNode(mnode_t *node)
 
         leaf = (mleaf_t *)node;
 
-        // grab an efrag off the free list
-        ef = cl.free_efrags;
-        if (!ef)
-        {
-            Con_Printf("Too many efrags!\n");
-            return; // no free fragments...
-        }
-        cl.free_efrags = cl.free_efrags->entnext;
-
+        ef = R_NewEfrag();
         ef->entity = r_addent;
 
         // add the entity link
@@ -203,6 +254,69 @@ void R_AddEfrags(entity_t *ent)
     R_SplitEntityOnNode(cl.worldmodel->nodes);
 
     ent->topnode = r_pefragtopnode;
+    r_efragsdirty = true;
+}
+
+/*
+================
+R_BuildEfragCache
+
+Flattens the efrag lists of every leaf in the current PVS into arrays of
+entity pointers.  Static entities only move at signon, so this only has to
+run when the visible leaf set or the efrags themselves change, instead of
+chasing every list in every drawn leaf each frame.
+================
+*/
+void R_BuildEfragCache(void)
+{
+    mleaf_t *leaf;
+    efrag_t *ef;
+    model_t *clmodel;
+    int32_t i, count, needed;
+
+    if (!r_efragsdirty && r_efragcacheframe == r_visframecount)
+        return;
+
+    r_efragsdirty = false;
+    r_efragcacheframe = r_visframecount;
+
+    // count first so the backing store is only grown once
+    needed = 0;
+    for (i = 0, leaf = cl.worldmodel->leafs + 1; i < cl.worldmodel->numleafs; i++, leaf++)
+    {
+        if (leaf->visframe != r_visframecount)
+            continue;
+        for (ef = leaf->efrags; ef; ef = ef->leafnext)
+            needed++;
+    }
+
+    if (needed > r_maxefragents)
+    {
+        r_maxefragents = needed + EFRAG_BLOCK;
+        r_efragents = realloc(r_efragents, r_maxefragents * sizeof(*r_efragents));
+        if (!r_efragents)
+            Sys_Error("R_BuildEfragCache: couldn't allocate %d entries", r_maxefragents);
+    }
+
+    count = 0;
+    for (i = 0, leaf = cl.worldmodel->leafs + 1; i < cl.worldmodel->numleafs; i++, leaf++)
+    {
+        leaf->efragents = r_efragents + count;
+        leaf->numefragents = 0;
+
+        if (leaf->visframe != r_visframecount)
+            continue;
+
+        for (ef = leaf->efrags; ef; ef = ef->leafnext)
+        {
+            clmodel = ef->entity->model;
+            if (clmodel->type != mod_alias && clmodel->type != mod_brush && clmodel->type != mod_sprite)
+                Sys_Error("R_BuildEfragCache: Bad entity type %d\n", clmodel->type);
+
+            r_efragents[count++] = ef->entity;
+            leaf->numefragents++;
+        }
+    }
 }
 
 /*
@@ -212,13 +326,31 @@ R_StoreEfrags
 // FIXME: a lot of this goes away with edge-based
 ================
 */
-void R_StoreEfrags(efrag_t **ppefrag)
+void R_StoreEfrags(mleaf_t *pleaf)
 {
     entity_t *pent;
     model_t *clmodel;
     efrag_t *pefrag;
+    int32_t i;
+
+    if (r_efragcache.value)
+    {
+        for (i = 0; i < pleaf->numefragents; i++)
+        {
+            pent = pleaf->efragents[i];
+
+            if ((pent->visframe != r_framecount) && (cl_numvisedicts < MAX_VISEDICTS))
+            {
+                cl_visedicts[cl_numvisedicts++] = pent;
+
+                // mark that we've recorded this entity for this frame
+                pent->visframe = r_framecount;
+            }
+        }
+        return;
+    }
 
-    while ((pefrag = *ppefrag) != NULL)
+    for (pefrag = pleaf->efrags; pefrag; pefrag = pefrag->leafnext)
     {
         pent = pefrag->entity;
         clmodel = pent->model;
@@ -228,8 +360,6 @@ void R_StoreEfrags(efrag_t **ppefrag)
         case mod_alias:
         case mod_brush:
         case mod_sprite:
-            pent = pefrag->entity;
-
             if ((pent->visframe != r_framecount) && (cl_numvisedicts < MAX_VISEDICTS))
             {
                 cl_visedicts[cl_numvisedicts++] = pent;
@@ -237,8 +367,6 @@ void R_StoreEfrags(efrag_t **ppefrag)
                 // mark that we've recorded this entity for this frame
                 pent->visframe = r_framecount;
             }
-
-            ppefrag = &pefrag->leafnext;
             break;
 
         default:
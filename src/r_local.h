@@ -228,6 +228,9 @@ void R_ReadPointFile_f(void);
 void R_SurfacePatch(void);
 
 extern int32_t r_amodels_drawn;
+extern int32_t r_aliaspolys;
+extern int32_t r_spancount;
+extern int32_t r_edgecount;
 extern edge_t *auxedges;
 extern int32_t r_numallocatededges;
 extern edge_t *r_edges, *edge_p, *edge_max;
@@ -272,8 +275,12 @@ extern int32_t r_clipflags;
 extern int32_t r_dlightframecount;
 extern bool r_fov_greater_than_90;
 
-void R_StoreEfrags(efrag_t **ppefrag);
+void R_StoreEfrags(mleaf_t *pleaf);
+void R_InitEfrags(void);
+void R_BuildEfragCache(void);
+void R_EfragsChanged(void);
 void R_TimeRefresh_f(void);
+void R_TimeWarp_f(void);
 void R_TimeGraph(void);
 void R_PrintAliasStats(void);
 void R_PrintTimes(void);
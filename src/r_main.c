@@ -6,6 +6,7 @@ static vec3_t viewlightvec;
 static alight_t r_viewlighting = {128, 192, viewlightvec};
 float r_time1;
 int32_t r_numallocatededges;
+int32_t r_edgecount; // edges used by the last frame
 bool r_drawpolys;
 bool r_drawculledpolys;
 bool r_worldpolysbacktofront;
@@ -163,8 +164,17 @@ void R_Init(void)
     R_InitTurb();
 
     Cmd_AddCommand("timerefresh", R_TimeRefresh_f);
+    Cmd_AddCommand("timewarp", R_TimeWarp_f);
     Cmd_AddCommand("pointfile", R_ReadPointFile_f);
 
+    Counter_Register("r_surfaces", &r_drawnpolycount, CNT_COUNT);
+    Counter_Register("r_polys", &r_polycount, CNT_COUNT);
+    Counter_Register("r_edges", &r_edgecount, CNT_COUNT);
+    Counter_Register("r_spans", &r_spancount, CNT_COUNT);
+    Counter_Register("r_aliasmodels", &r_amodels_drawn, CNT_COUNT);
+    Counter_Register("r_aliaspolys", &r_aliaspolys, CNT_COUNT);
+    Counter_Register("r_surfcachemiss", &c_surf, CNT_COUNT);
+
     Cvar_RegisterVariable(&r_draworder);
     Cvar_RegisterVariable(&r_speeds);
     Cvar_RegisterVariable(&r_timegraph);
@@ -199,6 +209,7 @@ void R_Init(void)
     r_refdef.yOrigin = YCENTERING;
 
     R_InitParticles();
+    R_InitEfrags();
 
     D_Init();
 }
@@ -211,15 +222,22 @@ R_NewMap
 void R_NewMap(void)
 {
     int32_t i;
+    memcat_t oldcategory;
 
     // clear out efrags in case the level hasn't been reloaded
     // FIXME: is this one short?
     for (i = 0; i < cl.worldmodel->numleafs; i++)
+    {
         cl.worldmodel->leafs[i].efrags = NULL;
+        cl.worldmodel->leafs[i].numefragents = 0;
+    }
+    R_EfragsChanged();
 
     r_viewleaf = NULL;
     R_ClearParticles();
 
+    oldcategory = Memory_SetCategory(MEM_RENDER);
+
     r_cnumsurfs = r_maxsurfs.value;
 
     if (r_cnumsurfs <= MINSURFACES)
@@ -258,6 +276,8 @@ void R_NewMap(void)
         auxedges = Hunk_AllocName(r_numallocatededges * sizeof(edge_t), "edges");
     }
 
+    Memory_SetCategory(oldcategory);
+
     r_dowarpold = false;
     r_viewchanged = false;
 }
@@ -428,7 +448,10 @@ void R_MarkLeaves(void)
     int32_t i;
 
     if (r_oldviewleaf == r_viewleaf)
+    {
+        R_BuildEfragCache(); // static entities may have been linked since
         return;
+    }
 
     r_visframecount++;
     r_oldviewleaf = r_viewleaf;
@@ -449,6 +472,8 @@ void R_MarkLeaves(void)
             } while (node);
         }
     }
+
+    R_BuildEfragCache();
 }
 
 /*
@@ -822,7 +847,9 @@ void R_EdgeDrawing(void)
         rw_time1 = Sys_FloatTime();
     }
 
+    PROF_BEGIN("R_RenderWorld");
     R_RenderWorld();
+    PROF_END();
 
     if (r_drawculledpolys)
         R_ScanEdges();
@@ -853,7 +880,13 @@ void R_EdgeDrawing(void)
     }
 
     if (!(r_drawpolys | r_drawculledpolys))
+    {
+        PROF_BEGIN("R_ScanEdges");
         R_ScanEdges();
+        PROF_END();
+    }
+
+    r_edgecount = edge_p - r_edges;
 }
 
 /*
@@ -865,16 +898,21 @@ r_refdef must be set before the first call
 */
 void R_RenderView_(void)
 {
-    uint8_t warpbuffer[WARP_WIDTH * WARP_HEIGHT];
+    // static so timewarp can warp the last scene again after the view returns
+    static uint8_t warpbuffer[WARP_WIDTH * WARP_HEIGHT + 4]; // vector warp gathers read 4 bytes at a time
 
     r_warpbuffer = warpbuffer;
 
     if (r_timegraph.value || r_speeds.value || r_dspeeds.value)
         r_time1 = Sys_FloatTime();
 
+    PROF_BEGIN("R_SetupFrame");
     R_SetupFrame();
+    PROF_END();
 
+    PROF_BEGIN("R_MarkLeaves");
     R_MarkLeaves(); // done here so we know if we're in water
+    PROF_END();
 
     // make FDIV fast. This reduces timing precision after we've been running for
     // a while, so we don't do it globally.  This also sets chop mode, and we do
@@ -892,7 +930,9 @@ void R_RenderView_(void)
         VID_LockBuffer();
     }
 
+    PROF_BEGIN("R_EdgeDrawing");
     R_EdgeDrawing();
+    PROF_END();
 
     if (!r_dspeeds.value)
     {
@@ -907,7 +947,9 @@ void R_RenderView_(void)
         de_time1 = se_time2;
     }
 
+    PROF_BEGIN("R_DrawEntitiesOnList");
     R_DrawEntitiesOnList();
+    PROF_END();
 
     if (r_dspeeds.value)
     {
@@ -915,7 +957,9 @@ void R_RenderView_(void)
         dv_time1 = de_time2;
     }
 
+    PROF_BEGIN("R_DrawViewModel");
     R_DrawViewModel();
+    PROF_END();
 
     if (r_dspeeds.value)
     {
@@ -923,13 +967,19 @@ void R_RenderView_(void)
         dp_time1 = Sys_FloatTime();
     }
 
+    PROF_BEGIN("R_DrawParticles");
     R_DrawParticles();
+    PROF_END();
 
     if (r_dspeeds.value)
         dp_time2 = Sys_FloatTime();
 
     if (r_dowarp)
+    {
+        PROF_BEGIN("D_WarpScreen");
         D_WarpScreen();
+        PROF_END();
+    }
 
     V_SetContentsColor(r_viewleaf->contents);
 
@@ -972,7 +1022,11 @@ void R_RenderView(void)
     if (((uintptr_t)&r_warpbuffer) & 3u)
         Sys_Error("Globals are misaligned");
 
+    PROF_BEGIN("R_RenderView");
+    HWPERF_BEGIN(HWP_RENDER);
     R_RenderView_();
+    HWPERF_END(HWP_RENDER);
+    PROF_END();
 }
 
 /*
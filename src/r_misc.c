@@ -78,6 +78,70 @@ void R_TimeRefresh_f(void)
     r_refdef.viewangles[1] = startangle;
 }
 
+/*
+====================
+R_TimeWarpPass
+====================
+*/
+static double R_TimeWarpPass(int32_t simd, int32_t parallel)
+{
+    int32_t i;
+    double start;
+
+    Cvar_SetValue("d_simd", simd);
+    Cvar_SetValue("d_parallel", parallel);
+    D_SetupFrame();
+
+    start = Sys_FloatTime();
+    for (i = 0; i < 128; i++)
+        D_WarpScreen();
+
+    return (Sys_FloatTime() - start) * 1000.0 / 128;
+}
+
+/*
+====================
+R_TimeWarp_f
+
+Times the underwater screen warp over a full screen view with each
+combination of the vector and threaded paths
+====================
+*/
+void R_TimeWarp_f(void)
+{
+    float oldsimd, oldparallel, oldwarp, oldsize;
+
+    if (cls.state != ca_connected || !cl.worldmodel)
+    {
+        Con_Printf("timewarp: not connected to a map\n");
+        return;
+    }
+
+    oldsimd = d_simd.value;
+    oldparallel = d_parallel.value;
+    oldwarp = r_waterwarp.value;
+    oldsize = scr_viewsize.value;
+
+    // force the warp on and the view to full screen, then draw one frame
+    // so the warp buffer holds a real scene
+    Cvar_SetValue("r_waterwarp", 2);
+    Cvar_SetValue("viewsize", 120);
+    SCR_UpdateScreen();
+
+    VID_LockBuffer();
+    Con_Printf("%dx%d warp, %d worker threads\n", scr_vrect.width, scr_vrect.height, Tasks_NumWorkers());
+    Con_Printf("scalar          %6.3f ms\n", R_TimeWarpPass(0, 0));
+    Con_Printf("simd            %6.3f ms\n", R_TimeWarpPass(1, 0));
+    Con_Printf("scalar parallel %6.3f ms\n", R_TimeWarpPass(0, 1));
+    Con_Printf("simd parallel   %6.3f ms\n", R_TimeWarpPass(1, 1));
+    VID_UnlockBuffer();
+
+    Cvar_SetValue("d_simd", oldsimd);
+    Cvar_SetValue("d_parallel", oldparallel);
+    Cvar_SetValue("r_waterwarp", oldwarp);
+    Cvar_SetValue("viewsize", oldsize);
+}
+
 /*
 ================
 R_LineGraph
@@ -176,7 +240,6 @@ void R_PrintTimes(void)
     ms = 1000 * (r_time2 - r_time1);
 
     Con_Printf("%5.1f ms %3i/%3i/%3i poly %3i surf\n", ms, c_faceclip, r_polycount, r_drawnpolycount, c_surf);
-    c_surf = 0;
 }
 
 /*
@@ -395,7 +458,7 @@ r_refdef.viewangles[2]=    0;
     r_viewleaf = Mod_PointInLeaf(r_origin, cl.worldmodel);
 
     r_dowarpold = r_dowarp;
-    r_dowarp = r_waterwarp.value && (r_viewleaf->contents <= CONTENTS_WATER);
+    r_dowarp = r_waterwarp.value && (r_viewleaf->contents <= CONTENTS_WATER || r_waterwarp.value >= 2);
 
     if ((r_dowarp != r_dowarpold) || r_viewchanged || lcd_x.value)
     {
@@ -471,6 +534,9 @@ r_refdef.viewangles[2]=    0;
     r_drawnpolycount = 0;
     r_wholepolycount = 0;
     r_amodels_drawn = 0;
+    r_aliaspolys = 0;
+    r_spancount = 0;
+    c_surf = 0;
     r_outofsurfaces = 0;
     r_outofedges = 0;
 
@@ -19,6 +19,7 @@ static cvar_t scr_showram = {"showram", "1"};
 static cvar_t scr_showturtle = {"showturtle", "0"};
 static cvar_t scr_showpause = {"showpause", "1"};
 static cvar_t scr_printspeed = {"scr_printspeed", "8"};
+static cvar_t scr_shotformat = {"scr_shotformat", "pcx", true}; // pcx or png
 
 static bool scr_initialized; // ready to draw
 
@@ -44,6 +45,7 @@ bool scr_skipupdate;
 bool block_drawing;
 
 void SCR_ScreenShot_f(void);
+void SCR_ScreenShotBurst_f(void);
 
 /*
 ===============================================================================
@@ -300,11 +302,13 @@ void SCR_Init(void)
     Cvar_RegisterVariable(&scr_showpause);
     Cvar_RegisterVariable(&scr_centertime);
     Cvar_RegisterVariable(&scr_printspeed);
+    Cvar_RegisterVariable(&scr_shotformat);
 
     //
     // register our commands
     //
     Cmd_AddCommand("screenshot", SCR_ScreenShot_f);
+    Cmd_AddCommand("screenshot_burst", SCR_ScreenShotBurst_f);
     Cmd_AddCommand("sizeup", SCR_SizeUp_f);
     Cmd_AddCommand("sizedown", SCR_SizeDown_f);
 
@@ -402,7 +406,7 @@ void SCR_DrawLoading(void)
     if (!scr_drawloading)
         return;
 
-    pic = Draw_CachePic("gfx/loading.lmp");
+    pic = Draw_CachePicNow("gfx/loading.lmp");
     Draw_Pic((vid.width - pic->width) / 2, (vid.height - 48 - pic->height) / 2, pic);
 }
 
@@ -489,128 +493,112 @@ void SCR_DrawConsole(void)
 ==============================================================================
 */
 
-typedef struct
-{
-    char manufacturer;
-    char version;
-    char encoding;
-    char bits_per_pixel;
-    uint16_t xmin, ymin, xmax, ymax;
-    uint16_t hres, vres;
-    unsigned char palette[48];
-    char reserved;
-    char color_planes;
-    uint16_t bytes_per_line;
-    uint16_t palette_type;
-    char filler[58];
-    unsigned char data; // unbounded
-} pcx_t;
+static int32_t scr_shotnumber = -1; // next free quakeNNNN number, -1 until scanned
+static int32_t scr_burstframes;      // frames left to capture for screenshot_burst
+static imageformat_t scr_burstformat;
 
 /*
-==============
-WritePCXfile
-==============
+==================
+SCR_ScanShotName
+
+Sys_FindFiles callback that keeps the highest quakeNN number in use
+==================
 */
-void WritePCXfile(char *filename, uint8_t *data, int32_t width, int32_t height, int32_t rowbytes, uint8_t *palette)
+static void SCR_ScanShotName(char *name, void *data)
 {
-    int32_t i, j, length;
-    pcx_t *pcx;
-    uint8_t *pack;
+    int32_t *highest = data;
+    char *end;
+    int32_t n;
 
-    pcx = Hunk_TempAlloc(width * height * 2 + 1000);
-    if (pcx == NULL)
-    {
-        Con_Printf("SCR_ScreenShot_f: not enough memory\n");
+    if (strncmp(name, "quake", 5) || name[5] < '0' || name[5] > '9')
         return;
-    }
 
-    pcx->manufacturer = 0x0a; // PCX id
-    pcx->version = 5;         // 256 color
-    pcx->encoding = 1;        // uncompressed
-    pcx->bits_per_pixel = 8;  // 256 color
-    pcx->xmin = 0;
-    pcx->ymin = 0;
-    pcx->xmax = ((int16_t)(width - 1));
-    pcx->ymax = ((int16_t)(height - 1));
-    pcx->hres = ((int16_t)width);
-    pcx->vres = ((int16_t)height);
-    memset(pcx->palette, 0, sizeof(pcx->palette));
-    pcx->color_planes = 1; // chunky image
-    pcx->bytes_per_line = ((int16_t)width);
-    pcx->palette_type = (2); // not a grey scale
-    memset(pcx->filler, 0, sizeof(pcx->filler));
-
-    // pack the image
-    pack = &pcx->data;
-
-    for (i = 0; i < height; i++)
-    {
-        for (j = 0; j < width; j++)
-        {
-            if ((*data & 0xc0) != 0xc0)
-                *pack++ = *data++;
-            else
-            {
-                *pack++ = 0xc1;
-                *pack++ = *data++;
-            }
-        }
-
-        data += rowbytes - width;
-    }
-
-    // write the palette
-    *pack++ = 0x0c; // palette ID byte
-    for (i = 0; i < 768; i++)
-        *pack++ = *palette++;
+    n = (int32_t)strtol(name + 5, &end, 10);
+    if (*end != '.' || (strcasecmp(end, ".pcx") && strcasecmp(end, ".png")))
+        return;
 
-    // write output file
-    length = pack - (uint8_t *)pcx;
-    COM_WriteFile(filename, pcx, length);
+    if (n > *highest)
+        *highest = n;
 }
 
 /*
 ==================
-SCR_ScreenShot_f
+SCR_ShotFormat
 ==================
 */
-void SCR_ScreenShot_f(void)
+static imageformat_t SCR_ShotFormat(char *name)
 {
-    int32_t i;
-    char pcxname[80];
-    char checkname[MAX_OSPATH];
+    return strcasecmp(name, "png") ? IMG_PCX : IMG_PNG;
+}
 
-    //
-    // find a file name to save it to
-    //
-    strcpy(pcxname, "quake00.pcx");
+/*
+==================
+SCR_CaptureShot
 
-    for (i = 0; i <= 99; i++)
-    {
-        pcxname[5] = i / 10 + '0';
-        pcxname[6] = i % 10 + '0';
-        sprintf(checkname, "%s/%s", com_gamedir, pcxname);
-        if (Sys_FileTime(checkname) == -1)
-            break; // file doesn't exist
-    }
-    if (i == 100)
+Copies the current frame out for the encoder thread.  The game directory
+is only listed once per session, after that names come from a counter.
+==================
+*/
+static void SCR_CaptureShot(imageformat_t format)
+{
+    char name[MAX_QPATH];
+    int32_t highest;
+
+    if (scr_shotnumber < 0)
     {
-        Con_Printf("SCR_ScreenShot_f: Couldn't create a PCX file\n");
-        return;
+        highest = -1;
+        Sys_FindFiles(com_gamedir, SCR_ScanShotName, &highest);
+        scr_shotnumber = highest + 1;
     }
 
-    //
-    // save the pcx file
-    //
+    sprintf(name, "quake%04d.%s", scr_shotnumber++, format == IMG_PNG ? "png" : "pcx");
+
     D_EnableBackBufferAccess(); // enable direct drawing of console to back
                                 //  buffer
 
-    WritePCXfile(pcxname, vid.buffer, vid.width, vid.height, vid.rowbytes, host_basepal);
+    Image_WriteAsync(name, format, vid.buffer, vid.width, vid.height, vid.rowbytes, host_basepal);
 
     D_DisableBackBufferAccess(); // for adapters that can't stay mapped in
                                  //  for linear writes all the time
+}
+
+/*
+==================
+SCR_ScreenShot_f
+
+screenshot [pcx | png]
+==================
+*/
+void SCR_ScreenShot_f(void)
+{
+    if (Cmd_Argc() > 1)
+        SCR_CaptureShot(SCR_ShotFormat(Cmd_Argv(1)));
+    else
+        SCR_CaptureShot(SCR_ShotFormat(scr_shotformat.string));
+}
+
+/*
+==================
+SCR_ScreenShotBurst_f
 
-    Con_Printf("Wrote %s\n", pcxname);
+screenshot_burst <frames> [pcx | png]
+
+Captures each of the next frames as it is finished
+==================
+*/
+void SCR_ScreenShotBurst_f(void)
+{
+    if (Cmd_Argc() < 2)
+    {
+        Con_Printf("screenshot_burst <frames> [pcx | png]\n");
+        return;
+    }
+
+    scr_burstframes = (int32_t)strtol(Cmd_Argv(1), NULL, 0);
+    if (Cmd_Argc() > 2)
+        scr_burstformat = SCR_ShotFormat(Cmd_Argv(2));
+    else
+        scr_burstformat = SCR_ShotFormat(scr_shotformat.string);
 }
 
 //=============================================================================
@@ -770,6 +758,8 @@ void SCR_UpdateScreen(void)
     static float oldlcd_x;
     vrect_t vrect;
 
+    Image_Poll();
+
     if (scr_skipupdate || block_drawing)
         return;
 
@@ -884,6 +874,7 @@ void SCR_UpdateScreen(void)
         SCR_DrawRam();
         SCR_DrawNet();
         SCR_DrawTurtle();
+        Counter_Draw();
         SCR_DrawPause();
         SCR_CheckDrawCenterString();
         Sbar_Draw();
@@ -934,6 +925,12 @@ void SCR_UpdateScreen(void)
 
         VID_Update(&vrect);
     }
+
+    if (scr_burstframes > 0)
+    {
+        scr_burstframes--;
+        SCR_CaptureShot(scr_burstformat);
+    }
 }
 
 /*
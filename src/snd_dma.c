@@ -15,6 +15,7 @@ void S_StopAllSoundsC(void);
 
 channel_t channels[MAX_CHANNELS];
 int32_t total_channels;
+int32_t snd_mixchannels;
 
 int32_t snd_blocked = 0;
 static bool snd_ambient = 1;
@@ -126,6 +127,19 @@ void S_Startup(void)
     sound_started = 1;
 }
 
+/*
+================
+S_BeginInit
+================
+*/
+void S_BeginInit(void)
+{
+    if (COM_CheckParm("-nosound") || COM_CheckParm("-simsound"))
+        return;
+
+    SNDDMA_BeginInit();
+}
+
 /*
 ================
 S_Init
@@ -152,12 +166,14 @@ void S_Init(void)
     Cvar_RegisterVariable(&volume);
     Cvar_RegisterVariable(&precache);
     Cvar_RegisterVariable(&loadas8bit);
+    Cvar_RegisterVariable(&snd_cache);
     Cvar_RegisterVariable(&bgmvolume);
     Cvar_RegisterVariable(&bgmbuffer);
     Cvar_RegisterVariable(&ambient_level);
     Cvar_RegisterVariable(&ambient_fade);
     Cvar_RegisterVariable(&snd_noextraupdate);
     Cvar_RegisterVariable(&snd_show);
+    Counter_Register("snd_channels", &snd_mixchannels, CNT_GAUGE);
     Cvar_RegisterVariable(&_snd_mixahead);
 
     if (host_parms.memsize < 0x800000)
@@ -299,9 +315,15 @@ sfx_t *S_PrecacheSound(char *name)
 
     sfx = S_FindName(name);
 
-    // cache it in
+    // cache it in.  Sounds named while the host starts up wait for the first
+    // map's precache, which resamples them on the workers with the rest
     if (precache.value)
-        S_LoadSound(sfx);
+    {
+        if (host_initialized)
+            S_LoadSound(sfx);
+        else
+            S_PrecacheLater(sfx);
+    }
 
     return sfx;
 }
@@ -448,7 +470,9 @@ void S_StartSound(int32_t entnum, int32_t entchannel, sfx_t *sfx, vec3_t origin,
     sc = S_LoadSound(sfx);
     if (!sc)
     {
-        target_chan->sfx = NULL;
+        // a sound still being read holds the channel with no end time yet,
+        // the mixer starts it once the data is in
+        target_chan->sfx = snd_loadpending ? sfx : NULL;
         return; // couldn't load the sound's data
     }
 
@@ -699,23 +723,25 @@ void S_Update(vec3_t origin, vec3_t forward, vec3_t right, vec3_t up)
         }
     }
 
+    //
+    // count the channels that will be mixed
+    //
+    total = 0;
+    ch = channels;
+    for (i = 0; i < total_channels; i++, ch++)
+        if (ch->sfx && (ch->leftvol || ch->rightvol))
+        {
+            // Con_Printf ("%3i %3i %s\n", ch->leftvol, ch->rightvol,
+            // ch->sfx->name);
+            total++;
+        }
+    snd_mixchannels = total;
+
     //
     // debugging output
     //
     if (snd_show.value)
-    {
-        total = 0;
-        ch = channels;
-        for (i = 0; i < total_channels; i++, ch++)
-            if (ch->sfx && (ch->leftvol || ch->rightvol))
-            {
-                // Con_Printf ("%3i %3i %s\n", ch->leftvol, ch->rightvol,
-                // ch->sfx->name);
-                total++;
-            }
-
         Con_Printf("----(%i)----\n", total);
-    }
 
     // mix some sound
     S_Update_();
@@ -886,12 +912,7 @@ void S_LocalSound(char *sound)
 
 void S_ClearPrecache(void)
 {
-}
-
-void S_BeginPrecaching(void)
-{
-}
-
-void S_EndPrecaching(void)
-{
+    // a Host_Error during signon skips S_EndPrecaching, and sounds loaded
+    // later would wait on a batch that never ends
+    S_EndPrecaching();
 }
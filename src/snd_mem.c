@@ -1,28 +1,58 @@
 // snd_mem.c: sound caching
 
+#include <unistd.h>
+
 #include "quakedef.h"
 
 static int32_t cache_full_cycle;
 
 uint8_t *S_Alloc(int32_t size);
 
+//
+// sounds whose samples sit in a mapped pak are resampled together on the
+// worker pool when precaching ends
+//
+#define MAX_DEFERRED_SFX 512
+
+typedef struct
+{
+    sfx_t *sfx;
+    sfxcache_t *sc; // looked up again once every allocation is done
+    int32_t inrate, inwidth;
+    int32_t length; // sc->length stays 0 until then, so nothing can play it
+    uint8_t *data;
+    uint32_t stamp; // the .wav's, for the sound cache
+    int32_t filesize;
+} sfxdecode_t;
+
+static sfxdecode_t snd_deferred[MAX_DEFERRED_SFX];
+static int32_t snd_numdeferred;
+static bool snd_precaching;
+
+#define MAX_LATER_SFX 32
+static sfx_t *snd_later[MAX_LATER_SFX]; // loaded with the next precache batch
+static int32_t snd_numlater;
+
+bool snd_loadpending;
+
+cvar_t snd_cache = {"snd_cache", "1"};
+
+static void S_WriteCachedSound(sfx_t *s, sfxcache_t *sc, uint32_t stamp, int32_t filesize);
+
 /*
 ================
-ResampleSfx
+S_Resample
+
+Touches nothing but sc and data, so it is safe on a worker
 ================
 */
-void ResampleSfx(sfx_t *sfx, int32_t inrate, int32_t inwidth, uint8_t *data)
+static void S_Resample(sfxcache_t *sc, int32_t inrate, int32_t inwidth, uint8_t *data)
 {
     int32_t outcount;
     int32_t srcsample;
     float stepscale;
     int32_t i;
     int32_t sample, samplefrac, fracstep;
-    sfxcache_t *sc;
-
-    sc = Cache_Check(&sfx->cache);
-    if (!sc)
-        return;
 
     stepscale = (float)inrate / shm->speed; // this is usually 0.5, 1, or 2
 
@@ -67,6 +97,419 @@ void ResampleSfx(sfx_t *sfx, int32_t inrate, int32_t inwidth, uint8_t *data)
     }
 }
 
+/*
+================
+ResampleSfx
+================
+*/
+void ResampleSfx(sfx_t *sfx, int32_t inrate, int32_t inwidth, uint8_t *data)
+{
+    sfxcache_t *sc;
+
+    sc = Cache_Check(&sfx->cache);
+    if (!sc)
+        return;
+
+    S_Resample(sc, inrate, inwidth, data);
+}
+
+/*
+================
+S_ResampleDeferred
+================
+*/
+static void S_ResampleDeferred(int32_t start, int32_t end, void *unused)
+{
+    sfxdecode_t *d;
+
+    for (d = snd_deferred + start; d < snd_deferred + end; d++)
+        if (d->sc)
+        {
+            d->sc->length = d->length;
+            S_Resample(d->sc, d->inrate, d->inwidth, d->data);
+        }
+}
+
+/*
+================
+S_FlushDeferred
+================
+*/
+static void S_FlushDeferred(void)
+{
+    int32_t i, j;
+
+    // a later allocation may have moved or thrown out an earlier sound, one
+    // that is gone just loads again when it is next needed
+    for (i = 0; i < snd_numdeferred; i++)
+        snd_deferred[i].sc = Cache_Check(&snd_deferred[i].sfx->cache);
+
+    // a sound thrown out and loaded again in the same batch is listed twice,
+    // only the last entry may write its samples
+    for (i = 0; i < snd_numdeferred; i++)
+        for (j = i + 1; snd_deferred[i].sc && j < snd_numdeferred; j++)
+            if (snd_deferred[j].sfx == snd_deferred[i].sfx)
+                snd_deferred[i].sc = NULL;
+
+    Task_ParallelRange(snd_numdeferred, 1, S_ResampleDeferred, NULL);
+
+    if (snd_cache.value)
+        for (i = 0; i < snd_numdeferred; i++)
+            if (snd_deferred[i].sc)
+                S_WriteCachedSound(snd_deferred[i].sfx, snd_deferred[i].sc, snd_deferred[i].stamp,
+                                   snd_deferred[i].filesize);
+    snd_numdeferred = 0;
+}
+
+/*
+================
+S_BeginPrecaching
+================
+*/
+void S_BeginPrecaching(void)
+{
+    int32_t i;
+
+    snd_precaching = true;
+
+    for (i = 0; i < snd_numlater; i++)
+        S_LoadSound(snd_later[i]);
+    snd_numlater = 0;
+}
+
+/*
+================
+S_PrecacheLater
+================
+*/
+void S_PrecacheLater(sfx_t *sfx)
+{
+    if (snd_numlater == MAX_LATER_SFX)
+    {
+        S_LoadSound(sfx);
+        return;
+    }
+    snd_later[snd_numlater++] = sfx;
+}
+
+/*
+================
+S_EndPrecaching
+================
+*/
+void S_EndPrecaching(void)
+{
+    S_FlushDeferred();
+    snd_precaching = false;
+}
+
+/*
+===============================================================================
+
+DECODED SOUND CACHE
+
+Resampled sounds are kept on disk, one file for each output rate and
+width, sndcache/<rate>_<bits>.sfc.  The file is mapped when the first sound
+is loaded and a sound found in it is copied straight into the cache, with
+no parsing or resampling, and without reading the .wav.  Sounds made this
+run are appended and are only used from the next run.  An entry matches a
+.wav by name, size and COM_FileStamp.
+
+===============================================================================
+*/
+
+#define SFC_VERSION 3
+#define SFC_HASHSIZE 1024 // must be a power of two
+
+typedef struct
+{
+    char id[4]; // "QSFC"
+    int32_t version;
+    int32_t speed;
+    int32_t eightbit;
+} sfcheader_t;
+
+typedef struct
+{
+    char name[MAX_QPATH];
+    uint32_t stamp;
+    int32_t filesize;
+    int32_t size; // of the sfxcache_t that follows, the entry is padded out to 4 bytes
+} sfcentry_t;
+
+typedef struct sfclink_s
+{
+    sfcentry_t *entry;
+    struct sfclink_s *next;
+    struct sfclink_s *nextadded; // written this run, the entry is malloced with its link
+    bool mapped;                 // the samples follow the entry, not so for one written this run
+} sfclink_t;
+
+static bool sfc_open;
+static int32_t sfc_speed, sfc_eightbit; // the output format the file is for
+static uint8_t *sfc_base;               // the mapped file, NULL if there was nothing usable
+static int32_t sfc_size;
+static sfclink_t *sfc_links;
+static sfclink_t *sfc_hash[SFC_HASHSIZE];
+static sfclink_t *sfc_added;
+static FILE *sfc_file; // new sounds are appended here
+
+/*
+================
+S_CloseSoundCache
+================
+*/
+static void S_CloseSoundCache(void)
+{
+    sfclink_t *link;
+
+    if (sfc_file)
+        fclose(sfc_file);
+    if (sfc_base)
+        Sys_FileUnmap(sfc_base, sfc_size);
+    free(sfc_links);
+    while (sfc_added)
+    {
+        link = sfc_added;
+        sfc_added = link->nextadded;
+        free(link);
+    }
+
+    sfc_file = NULL;
+    sfc_base = NULL;
+    sfc_links = NULL;
+    memset(sfc_hash, 0, sizeof(sfc_hash));
+    sfc_open = false;
+}
+
+/*
+================
+S_IndexSoundCache
+
+Links up every entry in the mapped file, false if the file is damaged
+================
+*/
+static bool S_IndexSoundCache(void)
+{
+    sfcheader_t *header;
+    sfcentry_t *entry;
+    sfxcache_t *sc;
+    sfclink_t *link;
+    int32_t pos, count, hash;
+
+    header = (sfcheader_t *)sfc_base;
+    if (sfc_size < (int32_t)sizeof(*header) || memcmp(header->id, "QSFC", 4) || header->version != SFC_VERSION ||
+        header->speed != sfc_speed || header->eightbit != sfc_eightbit)
+        return false;
+
+    // count them first
+    for (count = 0, pos = sizeof(*header); pos < sfc_size; count++)
+    {
+        entry = (sfcentry_t *)(sfc_base + pos);
+        if (sfc_size - pos < (int32_t)sizeof(*entry) || entry->size < (int32_t)sizeof(sfxcache_t) ||
+            entry->size > sfc_size - pos - (int32_t)sizeof(*entry) || entry->name[MAX_QPATH - 1])
+            return false;
+
+        sc = (sfxcache_t *)(entry + 1);
+        if (sc->width < 1 || sc->width > 2 || sc->length < 0 || sc->length > (entry->size - sizeof(*sc)) / sc->width)
+            return false;
+
+        pos += (sizeof(*entry) + entry->size + 3) & ~3;
+    }
+
+    sfc_links = malloc(count * sizeof(*sfc_links));
+    if (count && !sfc_links)
+        return false;
+
+    // later entries go in front, so they win over an older copy of a sound
+    link = sfc_links;
+    for (pos = sizeof(*header); pos < sfc_size; link++)
+    {
+        entry = (sfcentry_t *)(sfc_base + pos);
+        hash = COM_HashName(entry->name) & (SFC_HASHSIZE - 1);
+        link->entry = entry;
+        link->next = sfc_hash[hash];
+        link->mapped = true;
+        sfc_hash[hash] = link;
+        pos += (sizeof(*entry) + entry->size + 3) & ~3;
+    }
+
+    return true;
+}
+
+/*
+================
+S_OpenSoundCache
+
+Opens the file for the current output format, if it isn't already
+================
+*/
+static void S_OpenSoundCache(void)
+{
+    sfcheader_t header;
+    FILE *f;
+    int32_t h, len;
+    bool ok;
+    char name[MAX_OSPATH], tempname[MAX_OSPATH];
+
+    if (sfc_open && sfc_speed == shm->speed && sfc_eightbit == (loadas8bit.value != 0))
+        return;
+
+    S_CloseSoundCache();
+    sfc_open = true;
+    sfc_speed = shm->speed;
+    sfc_eightbit = loadas8bit.value != 0;
+
+    snprintf(name, sizeof(name), "%s/sndcache", com_gamedir);
+    Sys_mkdir(name);
+    snprintf(name, sizeof(name), "%s/sndcache/%d_%d.sfc", com_gamedir, sfc_speed, sfc_eightbit ? 8 : 16);
+
+    len = Sys_FileOpenRead(name, &h);
+    if (h != -1)
+    {
+        sfc_base = Sys_FileMap(h, len);
+        sfc_size = len;
+        Sys_FileClose(h);
+    }
+
+    if (sfc_base && !S_IndexSoundCache())
+    {
+        // written by another build, or cut off part way through an entry
+        Con_DPrintf("%s is out of date, starting it again\n", name);
+        Sys_FileUnmap(sfc_base, sfc_size);
+        sfc_base = NULL;
+        free(sfc_links);
+        sfc_links = NULL;
+        memset(sfc_hash, 0, sizeof(sfc_hash));
+    }
+
+    if (!sfc_base)
+    {
+        // another process may have the old file mapped, so it is replaced
+        // rather than cut short under it
+        snprintf(tempname, sizeof(tempname), "%s.%d", name, (int32_t)getpid());
+        f = fopen(tempname, "wb");
+        if (!f)
+            return;
+
+        memset(&header, 0, sizeof(header));
+        memcpy(header.id, "QSFC", 4);
+        header.version = SFC_VERSION;
+        header.speed = sfc_speed;
+        header.eightbit = sfc_eightbit;
+        ok = fwrite(&header, sizeof(header), 1, f) == 1;
+        ok = !fclose(f) && ok;
+        if (!ok || rename(tempname, name))
+        {
+            remove(tempname);
+            return;
+        }
+    }
+
+    // unbuffered, so each entry goes out in one append and entries from two
+    // processes can't interleave
+    sfc_file = fopen(name, "ab");
+    if (sfc_file)
+        setvbuf(sfc_file, NULL, _IONBF, 0);
+}
+
+/*
+================
+S_FindCachedSound
+
+The newest entry for the name
+================
+*/
+static sfclink_t *S_FindCachedSound(char *name)
+{
+    sfclink_t *link;
+
+    for (link = sfc_hash[COM_HashName(name) & (SFC_HASHSIZE - 1)]; link; link = link->next)
+        if (!strcmp(link->entry->name, name))
+            return link;
+
+    return NULL;
+}
+
+/*
+================
+S_LoadCachedSound
+================
+*/
+static sfxcache_t *S_LoadCachedSound(sfx_t *s, uint32_t stamp, int32_t filesize)
+{
+    sfclink_t *link;
+    sfcentry_t *entry;
+    sfxcache_t *sc;
+
+    link = S_FindCachedSound(s->name);
+    if (!link || !link->mapped)
+        return NULL; // not made yet, or only written this run
+    entry = link->entry;
+    if (entry->stamp != stamp || entry->filesize != filesize)
+        return NULL; // the .wav has changed since, a new entry will be added
+
+    sc = Cache_Alloc(&s->cache, entry->size, s->name, MEM_SOUNDS);
+    if (!sc)
+        return NULL;
+    memcpy(sc, entry + 1, entry->size);
+
+    return sc;
+}
+
+/*
+================
+S_WriteCachedSound
+================
+*/
+static void S_WriteCachedSound(sfx_t *s, sfxcache_t *sc, uint32_t stamp, int32_t filesize)
+{
+    sfcentry_t *entry;
+    sfclink_t *link;
+    uint8_t *buf;
+    int32_t size, padded, hash;
+    bool ok;
+
+    if (!sfc_file || sc->speed != sfc_speed || strlen(s->name) >= MAX_QPATH)
+        return;
+
+    // a sound thrown out of the cache and loaded again is already there
+    link = S_FindCachedSound(s->name);
+    if (link && link->entry->stamp == stamp && link->entry->filesize == filesize)
+        return;
+
+    size = sizeof(sfxcache_t) + sc->length * sc->width;
+    padded = (sizeof(*entry) + size + 3) & ~3;
+    buf = calloc(1, padded);
+    if (!buf)
+        return;
+    entry = (sfcentry_t *)buf;
+    strcpy(entry->name, s->name);
+    entry->stamp = stamp;
+    entry->filesize = filesize;
+    entry->size = size;
+    memcpy(entry + 1, sc, size);
+
+    ok = fwrite(buf, padded, 1, sfc_file) == 1;
+
+    // only the entry is kept, so the sound isn't written again this run
+    link = ok ? malloc(sizeof(*link) + sizeof(*entry)) : NULL;
+    if (link)
+    {
+        link->entry = (sfcentry_t *)(link + 1);
+        memcpy(link->entry, entry, sizeof(*entry));
+        link->mapped = false;
+
+        // in front of any older entry, as S_IndexSoundCache will put it next run
+        hash = COM_HashName(entry->name) & (SFC_HASHSIZE - 1);
+        link->next = sfc_hash[hash];
+        sfc_hash[hash] = link;
+        link->nextadded = sfc_added;
+        sfc_added = link;
+    }
+    free(buf);
+}
+
 //=============================================================================
 
 /*
@@ -82,21 +525,51 @@ sfxcache_t *S_LoadSound(sfx_t *s)
     int32_t len;
     float stepscale;
     sfxcache_t *sc;
-    uint8_t stackbuf[1 * 1024]; // avoid dirtying the cache heap
+    bool view;
+    uint32_t stamp;
+    int32_t filesize;
+
+    snd_loadpending = false;
 
     // see if still in memory
     sc = Cache_Check(&s->cache);
     if (sc)
         return sc;
 
-    // Con_Printf ("S_LoadSound: %x\n", (int)stackbuf);
     //  load it in
     strcpy(namebuffer, "sound/");
     strcat(namebuffer, s->name);
 
     //	Con_Printf ("loading %s\n",namebuffer);
 
-    data = COM_LoadStackFile(namebuffer, stackbuf, sizeof(stackbuf));
+    // a hit in the sound cache never reads the .wav
+    stamp = 0;
+    if (snd_cache.value)
+    {
+        S_OpenSoundCache();
+        stamp = COM_FileStamp(namebuffer);
+        if (com_filesize >= 0)
+        {
+            sc = S_LoadCachedSound(s, stamp, com_filesize);
+            if (sc)
+                return sc;
+        }
+    }
+
+    // in game a miss is read in the background and the sound starts late,
+    // rather than the whole frame waiting on the disk
+    if (!snd_precaching && cls.signon == SIGNONS)
+    {
+        data = COM_AsyncLoad(namebuffer);
+        if (!data && com_asyncpending)
+        {
+            snd_loadpending = true;
+            return NULL;
+        }
+    }
+    else
+        data = COM_ViewFile(namebuffer);
+    view = com_fileview;
 
     if (!data)
     {
@@ -104,7 +577,9 @@ sfxcache_t *S_LoadSound(sfx_t *s)
         return NULL;
     }
 
-    info = GetWavinfo(s->name, data, com_filesize);
+    filesize = com_filesize;
+
+    info = GetWavinfo(s->name, data, filesize);
     if (info.channels != 1)
     {
         Con_Printf("%s is a stereo sample\n", s->name);
@@ -116,7 +591,7 @@ sfxcache_t *S_LoadSound(sfx_t *s)
 
     len = len * info.width * info.channels;
 
-    sc = Cache_Alloc(&s->cache, len + sizeof(sfxcache_t), s->name);
+    sc = Cache_Alloc(&s->cache, len + sizeof(sfxcache_t), s->name, MEM_SOUNDS);
     if (!sc)
         return NULL;
 
@@ -126,7 +601,26 @@ sfxcache_t *S_LoadSound(sfx_t *s)
     sc->width = info.width;
     sc->stereo = info.channels;
 
+    // the temp hunk is reused by the next load, so only mapped data can wait
+    if (snd_precaching && view)
+    {
+        if (snd_numdeferred == MAX_DEFERRED_SFX)
+            S_FlushDeferred();
+        snd_deferred[snd_numdeferred].sfx = s;
+        snd_deferred[snd_numdeferred].inrate = sc->speed;
+        snd_deferred[snd_numdeferred].inwidth = sc->width;
+        snd_deferred[snd_numdeferred].length = sc->length;
+        snd_deferred[snd_numdeferred].data = data + info.dataofs;
+        snd_deferred[snd_numdeferred].stamp = stamp;
+        snd_deferred[snd_numdeferred].filesize = filesize;
+        snd_numdeferred++;
+        sc->length = 0;
+        return sc;
+    }
+
     ResampleSfx(s, sc->speed, sc->width, data + info.dataofs);
+    if (snd_cache.value)
+        S_WriteCachedSound(s, sc, stamp, filesize);
 
     return sc;
 }
@@ -147,6 +147,8 @@ void S_PaintChannels(int32_t endtime)
     sfxcache_t *sc;
     int32_t ltime, count;
 
+    HWPERF_BEGIN(HWP_MIXER);
+
     while (paintedtime < endtime)
     {
         // if paintbuffer is smaller than DMA buffer
@@ -167,7 +169,16 @@ void S_PaintChannels(int32_t endtime)
                 continue;
             sc = S_LoadSound(ch->sfx);
             if (!sc)
+            {
+                if (i >= NUM_AMBIENTS && !ch->end && !snd_loadpending)
+                    ch->sfx = NULL; // the read it was waiting on failed
                 continue;
+            }
+
+            // S_StartSound left the end open while the data was being read,
+            // ambients start with no end too but restart from their loop
+            if (i >= NUM_AMBIENTS && !ch->end)
+                ch->end = paintedtime + sc->length;
 
             ltime = paintedtime;
 
@@ -209,6 +220,8 @@ void S_PaintChannels(int32_t endtime)
         S_TransferPaintBuffer(end);
         paintedtime = end;
     }
+
+    HWPERF_END(HWP_MIXER);
 }
 
 void SND_InitScaletable(void)
@@ -10,19 +10,39 @@ static void *mixbuffer = NULL;
 extern int32_t desired_speed;
 extern int32_t desired_bits;
 
+static taskgroup_t snd_opengroup;
+static bool snd_opening; // the device is being opened on a worker
+
+static void SNDDMA_OpenTask(void *unused)
+{
+    InitAudioDevice();
+}
+
+void SNDDMA_BeginInit(void)
+{
+    snd_opening = true;
+    Task_Submit(&snd_opengroup, SNDDMA_OpenTask, NULL);
+}
+
 bool SNDDMA_Init(void)
 {
     int buffer_samples = 1024;
 
     snd_inited = 0;
 
+    // SNDDMA_BeginInit may have it opening already
+    if (snd_opening)
+        Task_Wait(&snd_opengroup);
+
     if (desired_bits != 8 && desired_bits != 16)
     {
         Con_Printf("Unknown number of audio bits: %d\n", desired_bits);
         return false;
     }
 
-    InitAudioDevice();
+    if (!snd_opening)
+        InitAudioDevice();
+    snd_opening = false;
     SetAudioStreamBufferSizeDefault(buffer_samples);
 
     stream = LoadAudioStream(desired_speed, desired_bits, 2);
@@ -70,6 +70,8 @@ typedef struct
     int32_t dataofs; // chunk starts this many bytes from file start
 } wavinfo_t;
 
+void S_BeginInit(void);
+// starts opening the audio device ahead of S_Init
 void S_Init(void);
 void S_Startup(void);
 void S_Shutdown(void);
@@ -86,6 +88,8 @@ void S_TouchSound(char *sample);
 void S_ClearPrecache(void);
 void S_BeginPrecaching(void);
 void S_EndPrecaching(void);
+void S_PrecacheLater(sfx_t *sfx);
+// loads the sound with the next precache batch
 void S_PaintChannels(int32_t endtime);
 void S_InitPaintChannels(void);
 
@@ -95,6 +99,9 @@ channel_t *SND_PickChannel(int32_t entnum, int32_t entchannel);
 // spatializes a channel
 void SND_Spatialize(channel_t *ch);
 
+// starts opening the device on the worker pool, SNDDMA_Init finishes it
+void SNDDMA_BeginInit(void);
+
 // initializes cycling through a DMA buffer and returns information on it
 bool SNDDMA_Init(void);
 
@@ -117,6 +124,7 @@ extern channel_t channels[MAX_CHANNELS];
 // MAX_DYNAMIC_CHANNELS + NUM_AMBIENTS to total_channels = static sounds
 
 extern int32_t total_channels;
+extern int32_t snd_mixchannels; // channels audible at the last S_Update
 
 //
 // Fake dma is a synchronous faking of the DMA progress used for
@@ -136,6 +144,7 @@ extern volatile dma_t sn;
 extern vec_t sound_nominal_clip_dist;
 
 extern cvar_t loadas8bit;
+extern cvar_t snd_cache;
 extern cvar_t bgmvolume;
 extern cvar_t volume;
 
@@ -145,6 +154,7 @@ extern int32_t snd_blocked;
 
 void S_LocalSound(char *s);
 sfxcache_t *S_LoadSound(sfx_t *s);
+extern bool snd_loadpending; // S_LoadSound returned NULL because the data is still being read
 
 wavinfo_t GetWavinfo(char *name, uint8_t *wav, int32_t wavlength);
 
@@ -39,6 +39,8 @@ void SV_Init(void)
     Cvar_RegisterVariable(&sv_aim);
     Cvar_RegisterVariable(&sv_nostep);
 
+    Counter_Register("sv_traces", &sv_tracecount, CNT_COUNT);
+
     for (i = 0; i < MAX_MODELS; i++)
         sprintf(localmodels[i], "*%i", i);
 }
@@ -990,6 +992,7 @@ void SV_SpawnServer(char *server)
 {
     edict_t *ent;
     int32_t i;
+    memcat_t oldcategory;
 
     // let's not have any servers with no name
     if (hostname.string[0] == 0)
@@ -1024,6 +1027,7 @@ void SV_SpawnServer(char *server)
     // set up the new server
     //
     Host_ClearMemory();
+    Memory_BeginMap();
 
     memset(&sv, 0, sizeof(sv));
 
@@ -1035,7 +1039,9 @@ void SV_SpawnServer(char *server)
     // allocate server memory
     sv.max_edicts = MAX_EDICTS;
 
+    oldcategory = Memory_SetCategory(MEM_EDICTS);
     sv.edicts = Hunk_AllocName(sv.max_edicts * pr_edict_size, "edicts");
+    Memory_SetCategory(oldcategory);
 
     sv.datagram.maxsize = sizeof(sv.datagram_buf);
     sv.datagram.cursize = 0;
@@ -1129,5 +1135,7 @@ void SV_SpawnServer(char *server)
         if (host_client->active)
             SV_SendServerinfo(host_client);
 
+    Memory_MapReport(false, sv.name);
+
     Con_DPrintf("Server spawned.\n");
 }
@@ -15,8 +15,48 @@ void Sys_FileSeek(int32_t handle, int32_t position);
 int32_t Sys_FileRead(int32_t handle, void *dest, int32_t count);
 int32_t Sys_FileWrite(int32_t handle, void *data, int32_t count);
 int32_t Sys_FileTime(char *path);
+void *Sys_FileMap(int32_t handle, int32_t size);
+// maps size bytes of the file read-only, NULL if it can't be mapped.  The
+// mapping outlives the handle.
+void Sys_FileUnmap(void *buf, int32_t size);
 void Sys_mkdir(char *path);
 
+int32_t Sys_FileReadAt(int32_t handle, int32_t position, void *dest, int32_t count);
+// reads without moving the handle's file position, so a worker can read
+// from a handle the main thread is also using.  -1 on an error
+
+typedef struct
+{
+    _Atomic int32_t done;
+    int32_t result; // bytes read, -1 on an error
+    int fd;
+    int32_t position;
+    void *dest;
+    int32_t count;
+} sysread_t;
+
+bool Sys_FileReadAsync(sysread_t *req, int32_t handle, int32_t position, void *dest, int32_t count);
+// starts reading count bytes from position into dest and returns straight
+// away, the handle's file position is left alone.  req, dest and the handle
+// must stay valid until Sys_FileReadDone says the read has finished.
+
+bool Sys_FileReadDone(sysread_t *req);
+// never blocks
+
+typedef void (*sys_findfunc_t)(char *name, void *data);
+void Sys_FindFiles(char *path, sys_findfunc_t func, void *data);
+// calls func with the name of every file in the directory path
+
+//
+// memory
+//
+void *Sys_ReserveMemory(int32_t size, bool hugepages);
+// returns size bytes of zeroed memory that the system only backs as it is
+// touched, hugepages asks for transparent huge pages
+
+void Sys_ReleaseMemory(void *buf, int32_t size);
+// zeroes the range, returning whole pages to the system where it can
+
 //
 // system IO
 //
@@ -28,7 +68,13 @@ void Sys_Error(char *error, ...);
 void Sys_Printf(char *fmt, ...);
 // send text to the console
 
+void Sys_InitCommands(void);
+// called by Host_Init while commands and cvars can still be added, before
+// config.cfg is run
+
 void Sys_Quit(void);
+void Sys_Exit(int32_t code);
+// shuts the host down and exits with code, Sys_Quit is Sys_Exit (0)
 
 double Sys_FloatTime(void);
 
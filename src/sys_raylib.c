@@ -1,10 +1,15 @@
+#include <dirent.h>
 #include <errno.h>
 #include <stdarg.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdatomic.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
 #include <sys/types.h>
+#include <time.h>
+#include <unistd.h>
 #include <raylib.h>
 
 #include "quakedef.h"
@@ -12,6 +17,10 @@
 bool isDedicated;
 char *basedir = ".";
 cvar_t sys_nostdout = {"sys_nostdout", "0"};
+static cvar_t sys_sleep = {"sys_sleep", "1", true}; // 0 = spin while waiting for the next frame
+
+#define DEFAULT_MEMORY (256 * 1024 * 1024) // reserved, only what is touched is used
+#define SYS_RELEASE_MIN (256 * 1024)       // smaller releases are just zeroed
 
 void Sys_DebugNumber(int32_t y, int32_t val) {}
 
@@ -28,12 +37,23 @@ void Sys_Printf(char *fmt, ...)
 }
 
 void Sys_Quit(void)
+{
+    Sys_Exit(0);
+}
+
+void Sys_Exit(int32_t code)
 {
     Host_Shutdown();
-    exit(0);
+    exit(code);
 }
 
-void Sys_Init(void) {}
+static void Sys_InitRing(void);
+
+void Sys_Init(void)
+{
+    Sys_FloatTime(); // starts the clock
+    Sys_InitRing();
+}
 
 void Sys_LowFPPrecision(void) {}
 
@@ -158,7 +178,11 @@ int32_t Sys_FileWrite(int32_t handle, void *src, int32_t count)
 
 int32_t Sys_FileTime(char *path)
 {
-    return FileExists(path) ? 1 : -1;
+    struct stat st;
+
+    if (stat(path, &st) == -1)
+        return -1;
+    return st.st_mtime;
 }
 
 void Sys_mkdir(char *path)
@@ -166,6 +190,385 @@ void Sys_mkdir(char *path)
     mkdir(path, 0777);
 }
 
+void Sys_FindFiles(char *path, sys_findfunc_t func, void *data)
+{
+    DIR *dir;
+    struct dirent *ent;
+
+    dir = opendir(path);
+    if (!dir)
+        return;
+
+    while ((ent = readdir(dir)) != NULL)
+    {
+        if (ent->d_name[0] == '.')
+            continue;
+        func(ent->d_name, data);
+    }
+
+    closedir(dir);
+}
+
+/*
+===============================================================================
+
+ASYNCHRONOUS READS
+
+Reads go through an io_uring when the kernel has one, nothing else submits
+to it or reaps from it so the main thread owns both ends of the ring.
+Without one, or while the ring is full, a worker does a pread instead.
+Neither moves the handle's own file position.
+
+===============================================================================
+*/
+
+#define SYS_RING_ENTRIES 64
+
+#ifdef __linux__
+
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+
+static struct
+{
+    int fd;
+    uint32_t *sqhead, *sqtail, *sqmask, *sqarray;
+    struct io_uring_sqe *sqes;
+    uint32_t *cqhead, *cqtail, *cqmask;
+    struct io_uring_cqe *cqes;
+    uint32_t entries;
+    uint32_t inflight; // never more than entries, so the completion ring can't overflow
+} sys_ring = {-1};
+
+/*
+================
+Sys_InitRing
+================
+*/
+static void Sys_InitRing(void)
+{
+    struct io_uring_params p;
+    uint8_t *sq, *cq;
+    size_t sqsize, cqsize;
+    int fd;
+
+    if (COM_CheckParm("-nouring"))
+        return;
+
+    memset(&p, 0, sizeof(p));
+    fd = (int)syscall(__NR_io_uring_setup, SYS_RING_ENTRIES, &p);
+    if (fd < 0)
+    {
+        Sys_Printf("io_uring unavailable (%s), reading on the worker pool\n", strerror(errno));
+        return;
+    }
+
+    // IORING_OP_READ arrived in the same kernel as this feature
+    if (!(p.features & IORING_FEAT_RW_CUR_POS))
+    {
+        Sys_Printf("io_uring too old, reading on the worker pool\n");
+        close(fd);
+        return;
+    }
+
+    sqsize = p.sq_off.array + p.sq_entries * sizeof(uint32_t);
+    cqsize = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    if (p.features & IORING_FEAT_SINGLE_MMAP)
+        sqsize = cqsize = sqsize > cqsize ? sqsize : cqsize;
+
+    sq = mmap(NULL, sqsize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+    if (sq == MAP_FAILED)
+    {
+        close(fd);
+        return;
+    }
+    cq = sq;
+    if (!(p.features & IORING_FEAT_SINGLE_MMAP))
+    {
+        cq = mmap(NULL, cqsize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+        if (cq == MAP_FAILED)
+        {
+            munmap(sq, sqsize);
+            close(fd);
+            return;
+        }
+    }
+    sys_ring.sqes = mmap(NULL, p.sq_entries * sizeof(struct io_uring_sqe), PROT_READ | PROT_WRITE,
+                         MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+    if (sys_ring.sqes == MAP_FAILED)
+    {
+        if (cq != sq)
+            munmap(cq, cqsize);
+        munmap(sq, sqsize);
+        close(fd);
+        return;
+    }
+
+    sys_ring.sqhead = (uint32_t *)(sq + p.sq_off.head);
+    sys_ring.sqtail = (uint32_t *)(sq + p.sq_off.tail);
+    sys_ring.sqmask = (uint32_t *)(sq + p.sq_off.ring_mask);
+    sys_ring.sqarray = (uint32_t *)(sq + p.sq_off.array);
+    sys_ring.cqhead = (uint32_t *)(cq + p.cq_off.head);
+    sys_ring.cqtail = (uint32_t *)(cq + p.cq_off.tail);
+    sys_ring.cqmask = (uint32_t *)(cq + p.cq_off.ring_mask);
+    sys_ring.cqes = (struct io_uring_cqe *)(cq + p.cq_off.cqes);
+    sys_ring.entries = p.sq_entries;
+    sys_ring.fd = fd;
+
+    Sys_Printf("io_uring: %u entries\n", p.sq_entries);
+}
+
+/*
+================
+Sys_RingSubmit
+================
+*/
+static bool Sys_RingSubmit(sysread_t *req)
+{
+    struct io_uring_sqe *sqe;
+    uint32_t tail, idx;
+
+    if (sys_ring.fd < 0 || sys_ring.inflight == sys_ring.entries)
+        return false;
+
+    tail = *sys_ring.sqtail;
+    idx = tail & *sys_ring.sqmask;
+    sqe = &sys_ring.sqes[idx];
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = IORING_OP_READ;
+    sqe->fd = req->fd;
+    sqe->off = req->position;
+    sqe->addr = (uintptr_t)req->dest;
+    sqe->len = req->count;
+    sqe->user_data = (uintptr_t)req;
+    sys_ring.sqarray[idx] = idx;
+    __atomic_store_n(sys_ring.sqtail, tail + 1, __ATOMIC_RELEASE);
+
+    if (syscall(__NR_io_uring_enter, sys_ring.fd, 1, 0, 0, NULL, 0) != 1)
+    {
+        // the kernel never saw it, take it back
+        __atomic_store_n(sys_ring.sqtail, tail, __ATOMIC_RELEASE);
+        return false;
+    }
+
+    sys_ring.inflight++;
+    return true;
+}
+
+/*
+================
+Sys_RingReap
+================
+*/
+static void Sys_RingReap(void)
+{
+    struct io_uring_cqe *cqe;
+    sysread_t *req;
+    uint32_t head, tail;
+
+    if (!sys_ring.inflight)
+        return;
+
+    head = *sys_ring.cqhead;
+    tail = __atomic_load_n(sys_ring.cqtail, __ATOMIC_ACQUIRE);
+    for (; head != tail; head++)
+    {
+        cqe = &sys_ring.cqes[head & *sys_ring.cqmask];
+        req = (sysread_t *)(uintptr_t)cqe->user_data;
+        req->result = cqe->res < 0 ? -1 : cqe->res;
+        atomic_store(&req->done, 1);
+        sys_ring.inflight--;
+    }
+    __atomic_store_n(sys_ring.cqhead, head, __ATOMIC_RELEASE);
+}
+
+#else
+
+static void Sys_InitRing(void) {}
+static bool Sys_RingSubmit(sysread_t *req) { return false; }
+static void Sys_RingReap(void) {}
+
+#endif
+
+/*
+================
+Sys_PRead
+================
+*/
+static int32_t Sys_PRead(int fd, int32_t position, void *dest, int32_t count)
+{
+    ssize_t r;
+    int32_t total;
+
+    total = 0;
+    while (total < count)
+    {
+        r = pread(fd, (uint8_t *)dest + total, count - total, position + total);
+        if (r < 0 && errno == EINTR)
+            continue;
+        if (r <= 0)
+            break;
+        total += r;
+    }
+
+    return total || count == 0 ? total : -1;
+}
+
+/*
+================
+Sys_ReadTask
+
+Fallback read on a worker
+================
+*/
+static void Sys_ReadTask(void *data)
+{
+    sysread_t *req;
+
+    req = data;
+    req->result = Sys_PRead(req->fd, req->position, req->dest, req->count);
+    atomic_store(&req->done, 1);
+}
+
+/*
+================
+Sys_FileReadAt
+================
+*/
+int32_t Sys_FileReadAt(int32_t handle, int32_t position, void *dest, int32_t count)
+{
+    if (handle < 0 || handle >= MAX_HANDLES || !sys_handles[handle])
+        return -1;
+
+    return Sys_PRead(fileno(sys_handles[handle]), position, dest, count);
+}
+
+/*
+================
+Sys_FileReadAsync
+================
+*/
+bool Sys_FileReadAsync(sysread_t *req, int32_t handle, int32_t position, void *dest, int32_t count)
+{
+    if (handle < 0 || handle >= MAX_HANDLES || !sys_handles[handle])
+        return false;
+
+    atomic_store(&req->done, 0);
+    req->result = 0;
+    req->fd = fileno(sys_handles[handle]);
+    req->position = position;
+    req->dest = dest;
+    req->count = count;
+
+    if (!Sys_RingSubmit(req))
+        Task_Submit(NULL, Sys_ReadTask, req);
+
+    return true;
+}
+
+/*
+================
+Sys_FileReadDone
+================
+*/
+bool Sys_FileReadDone(sysread_t *req)
+{
+    if (atomic_load(&req->done))
+        return true;
+
+    Sys_RingReap();
+    return atomic_load(&req->done) != 0;
+}
+
+/*
+================
+Sys_ReserveMemory
+
+Maps size bytes of address space.  Nothing is backed by real memory until
+it is first touched, so the reservation can be far bigger than the game
+needs.
+================
+*/
+void *Sys_ReserveMemory(int32_t size, bool hugepages)
+{
+    void *buf;
+    int flags;
+
+    flags = MAP_PRIVATE | MAP_ANONYMOUS;
+#ifdef MAP_NORESERVE
+    flags |= MAP_NORESERVE;
+#endif
+
+    buf = mmap(NULL, size, PROT_READ | PROT_WRITE, flags, -1, 0);
+    if (buf == MAP_FAILED)
+        return calloc(1, size);
+
+#ifdef MADV_HUGEPAGE
+    if (hugepages && madvise(buf, size, MADV_HUGEPAGE))
+        Sys_Printf("Sys_ReserveMemory: no transparent huge pages\n");
+#endif
+
+    return buf;
+}
+
+/*
+================
+Sys_FileMap
+
+Maps the first size bytes of an open file read-only and shared, so every
+process reading the same file uses the same page cache.  NULL if the file
+can't be mapped.
+================
+*/
+void *Sys_FileMap(int32_t handle, int32_t size)
+{
+    void *buf;
+
+    if (handle < 0 || handle >= MAX_HANDLES || !sys_handles[handle] || size <= 0)
+        return NULL;
+
+    buf = mmap(NULL, size, PROT_READ, MAP_SHARED, fileno(sys_handles[handle]), 0);
+    if (buf == MAP_FAILED)
+        return NULL;
+
+    return buf;
+}
+
+void Sys_FileUnmap(void *buf, int32_t size)
+{
+    munmap(buf, size);
+}
+
+/*
+================
+Sys_ReleaseMemory
+
+Zeroes size bytes at buf.  Whole pages in a large enough range are handed
+back to the system instead, they read as zero when next touched.
+================
+*/
+void Sys_ReleaseMemory(void *buf, int32_t size)
+{
+#ifdef __linux__
+    // only linux promises dropped anonymous pages come back zeroed
+    uintptr_t start, end, page;
+
+    page = sysconf(_SC_PAGESIZE);
+    start = ((uintptr_t)buf + page - 1) & ~(page - 1);
+    end = ((uintptr_t)buf + size) & ~(page - 1);
+
+    // small ranges aren't worth a system call, the pages would fault straight back in
+    if (size >= SYS_RELEASE_MIN && end > start && !madvise((void *)start, end - start, MADV_DONTNEED))
+    {
+        memset(buf, 0, start - (uintptr_t)buf);
+        memset((void *)end, 0, (uintptr_t)buf + size - end);
+        return;
+    }
+#endif
+
+    memset(buf, 0, size);
+}
+
 void Sys_DebugLog(char *file, char *fmt, ...)
 {
     va_list argptr;
@@ -184,17 +587,151 @@ void Sys_DebugLog(char *file, char *fmt, ...)
     }
 }
 
+/*
+================
+Sys_FloatTime
+
+Seconds since Sys_Init.  raylib's GetTime only starts once the window is
+open, so it would stand still through Host_Init and on a dedicated server.
+================
+*/
 double Sys_FloatTime(void)
 {
-    return GetTime();
+    static struct timespec start;
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    if (!start.tv_sec && !start.tv_nsec)
+        start = ts;
+    return (ts.tv_sec - start.tv_sec) + (ts.tv_nsec - start.tv_nsec) * 1e-9;
+}
+
+/*
+===============================================================================
+
+FRAME PACING
+
+The host only runs a frame once host_maxfps allows it, so the time in
+between is handed back to the OS.  Sleeps overshoot by a scheduler dependent
+amount, so the pacer sleeps until a margin before the deadline and spins
+the rest of the way.  The margin follows the overshoot it has seen.
+
+===============================================================================
+*/
+
+#define PACE_MINMARGIN 0.0001
+#define PACE_MAXMARGIN 0.002
+
+static double pace_margin = 0.0005; // seconds left to spin after sleeping
+
+static struct
+{
+    int32_t frames;
+    double slept;   // seconds given back to the OS
+    double spun;    // seconds burned waiting in a loop
+    double error;   // summed distance from the deadline on wakeup
+    double maxerror;
+    double starttime;
+    double startcpu;
+} pace;
+
+static double Sys_CPUTime(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/*
+================
+Sys_PaceFrame
+
+Waits until the absolute time deadline
+================
+*/
+static void Sys_PaceFrame(double deadline)
+{
+    struct timespec ts;
+    double start, now, want, slept, spinstart;
+
+    start = now = Sys_FloatTime();
+    if (now >= deadline)
+        return;
+
+    want = deadline - now - pace_margin;
+    if (sys_sleep.value && want > 0)
+    {
+        ts.tv_sec = (time_t)want;
+        ts.tv_nsec = (long)((want - ts.tv_sec) * 1e9);
+        while (nanosleep(&ts, &ts) == -1 && errno == EINTR)
+            ;
+
+        now = Sys_FloatTime();
+        slept = now - start;
+        pace.slept += slept;
+
+        // keep the margin a little above the recent overshoot
+        pace_margin = pace_margin * 0.9 + (slept - want) * 1.5 * 0.1;
+        if (pace_margin < PACE_MINMARGIN)
+            pace_margin = PACE_MINMARGIN;
+        if (pace_margin > PACE_MAXMARGIN)
+            pace_margin = PACE_MAXMARGIN;
+    }
+
+    spinstart = now;
+    while (now < deadline)
+        now = Sys_FloatTime();
+    pace.spun += now - spinstart;
+
+    pace.frames++;
+    pace.error += now - deadline;
+    if (now - deadline > pace.maxerror)
+        pace.maxerror = now - deadline;
+}
+
+/*
+================
+Sys_Pacing_f
+================
+*/
+static void Sys_Pacing_f(void)
+{
+    double wall, cpu;
+
+    wall = Sys_FloatTime() - pace.starttime;
+    cpu = Sys_CPUTime() - pace.startcpu;
+
+    if (pace.frames && wall > 0)
+    {
+        Con_Printf("%d paced frames over %.1f seconds\n", pace.frames, wall);
+        Con_Printf("jitter: %.3f ms average, %.3f ms worst\n", pace.error * 1000 / pace.frames,
+                   pace.maxerror * 1000);
+        Con_Printf("slept %.2f s, spun %.2f s, %.1f%% of the wait given back\n", pace.slept, pace.spun,
+                   pace.slept * 100 / (pace.slept + pace.spun));
+        Con_Printf("cpu: %.1f%% of one core, spin margin %.3f ms\n", cpu * 100 / wall, pace_margin * 1000);
+    }
+    else
+        Con_Printf("no frames paced\n");
+
+    memset(&pace, 0, sizeof(pace));
+    pace.starttime = Sys_FloatTime();
+    pace.startcpu = Sys_CPUTime();
+}
+
+void Sys_InitCommands(void)
+{
+    Cmd_AddCommand("pacing", Sys_Pacing_f);
+    Cvar_RegisterVariable(&sys_sleep);
 }
 
 int main(int argc, char *argv[])
 {
     quakeparms_t parms;
+    double oldtime, newtime;
+
+    int32_t p;
 
-    parms.memsize = 32 * 1024 * 1024;
-    parms.membase = malloc(parms.memsize);
     parms.basedir = basedir;
     parms.cachedir = NULL;
 
@@ -202,13 +739,34 @@ int main(int argc, char *argv[])
     parms.argc = com_argc;
     parms.argv = com_argv;
 
+    // -mem <megabytes> sets the size of the hunk
+    parms.memsize = DEFAULT_MEMORY;
+    p = COM_CheckParm("-mem");
+    if (p && p < com_argc - 1)
+    {
+        parms.memsize = (int32_t)strtol(com_argv[p + 1], NULL, 0);
+        if (parms.memsize < 1 || parms.memsize > 2047)
+            Sys_Error("-mem must be between 1 and 2047 megabytes");
+        parms.memsize *= 1024 * 1024;
+    }
+    parms.membase = Sys_ReserveMemory(parms.memsize, COM_CheckParm("-hugepages") != 0);
+    if (!parms.membase)
+        Sys_Error("Couldn't reserve %d megabytes", parms.memsize / (1024 * 1024));
+
     Sys_Init();
     Host_Init(&parms);
     Cvar_RegisterVariable(&sys_nostdout);
 
+    oldtime = pace.starttime = Sys_FloatTime();
+    pace.startcpu = Sys_CPUTime();
+
     while (!WindowShouldClose())
     {
-        Host_Frame(GetFrameTime());
+        newtime = Sys_FloatTime();
+        Host_Frame(newtime - oldtime);
+        oldtime = newtime;
+
+        Sys_PaceFrame(newtime + Host_FrameWait());
     }
 
     Host_Shutdown();
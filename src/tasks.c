@@ -0,0 +1,328 @@
+// tasks.c -- worker thread pool
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <unistd.h>
+
+#include "quakedef.h"
+
+#define MAX_QUEUED_TASKS 1024
+
+typedef struct
+{
+    task_func_t func;
+    void *data;
+    taskgroup_t *group;
+} task_t;
+
+static pthread_t task_threads[MAX_TASK_WORKERS];
+static int32_t task_numworkers;
+
+static pthread_mutex_t task_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t task_wake = PTHREAD_COND_INITIALIZER; // queue became non-empty
+static pthread_cond_t task_done = PTHREAD_COND_INITIALIZER; // some group count hit zero
+
+static task_t task_queue[MAX_QUEUED_TASKS];
+static int32_t task_head, task_tail; // tail == head means empty
+static bool task_shutdown;
+
+/*
+================
+Task_Run
+================
+*/
+static void Task_Run(task_t *task)
+{
+    task->func(task->data);
+
+    if (task->group && atomic_fetch_sub(&task->group->pending, 1) == 1)
+    {
+        pthread_mutex_lock(&task_lock);
+        pthread_cond_broadcast(&task_done);
+        pthread_mutex_unlock(&task_lock);
+    }
+}
+
+/*
+================
+Task_Pop
+
+task_lock must be held
+================
+*/
+static bool Task_Pop(task_t *task)
+{
+    if (task_head == task_tail)
+        return false;
+
+    *task = task_queue[task_head];
+    task_head = (task_head + 1) & (MAX_QUEUED_TASKS - 1);
+    return true;
+}
+
+/*
+================
+Task_PopGroup
+
+Takes the oldest queued task of the group, leaving the others in order.
+task_lock must be held
+================
+*/
+static bool Task_PopGroup(task_t *task, taskgroup_t *group)
+{
+    int32_t i, prev;
+
+    for (i = task_head; i != task_tail; i = (i + 1) & (MAX_QUEUED_TASKS - 1))
+    {
+        if (task_queue[i].group != group)
+            continue;
+
+        *task = task_queue[i];
+
+        // close the gap by moving the older tasks up one
+        for (; i != task_head; i = prev)
+        {
+            prev = (i - 1) & (MAX_QUEUED_TASKS - 1);
+            task_queue[i] = task_queue[prev];
+        }
+        task_head = (task_head + 1) & (MAX_QUEUED_TASKS - 1);
+        return true;
+    }
+
+    return false;
+}
+
+/*
+================
+Task_Worker
+================
+*/
+static void *Task_Worker(void *unused)
+{
+    task_t task;
+
+    pthread_mutex_lock(&task_lock);
+    while (1)
+    {
+        while (!task_shutdown && task_head == task_tail)
+            pthread_cond_wait(&task_wake, &task_lock);
+
+        if (!Task_Pop(&task))
+            break; // shutting down and nothing left to run
+
+        pthread_mutex_unlock(&task_lock);
+        Task_Run(&task);
+        pthread_mutex_lock(&task_lock);
+    }
+    pthread_mutex_unlock(&task_lock);
+
+    return NULL;
+}
+
+/*
+================
+Task_Submit
+================
+*/
+void Task_Submit(taskgroup_t *group, task_func_t func, void *data)
+{
+    task_t task;
+    int32_t next;
+
+    task.func = func;
+    task.data = data;
+    task.group = group;
+
+    if (group)
+        atomic_fetch_add(&group->pending, 1);
+
+    if (!task_numworkers)
+    {
+        Task_Run(&task);
+        return;
+    }
+
+    pthread_mutex_lock(&task_lock);
+    next = (task_tail + 1) & (MAX_QUEUED_TASKS - 1);
+    if (next == task_head)
+    {
+        // queue is full, so do the work here rather than block
+        pthread_mutex_unlock(&task_lock);
+        Task_Run(&task);
+        return;
+    }
+    task_queue[task_tail] = task;
+    task_tail = next;
+    pthread_cond_signal(&task_wake);
+    pthread_mutex_unlock(&task_lock);
+}
+
+/*
+================
+Task_Done
+
+True once every task in the group has run, never blocks
+================
+*/
+bool Task_Done(taskgroup_t *group)
+{
+    return !group || atomic_load(&group->pending) <= 0;
+}
+
+/*
+================
+Task_Wait
+
+Only helps with the group's own tasks, so a frame waiting on a short job
+never ends up running someone else's long file read
+================
+*/
+void Task_Wait(taskgroup_t *group)
+{
+    task_t task;
+
+    if (!group)
+        return;
+
+    pthread_mutex_lock(&task_lock);
+    while (atomic_load(&group->pending) > 0)
+    {
+        // run the group's queued work instead of sleeping while there is any
+        if (Task_PopGroup(&task, group))
+        {
+            pthread_mutex_unlock(&task_lock);
+            Task_Run(&task);
+            pthread_mutex_lock(&task_lock);
+            continue;
+        }
+        pthread_cond_wait(&task_done, &task_lock);
+    }
+    pthread_mutex_unlock(&task_lock);
+}
+
+typedef struct
+{
+    task_range_func_t func;
+    void *data;
+    int32_t start, end;
+} taskrange_t;
+
+static void Task_RunRange(void *data)
+{
+    taskrange_t *range = data;
+
+    range->func(range->start, range->end, range->data);
+}
+
+/*
+================
+Task_ParallelRange
+================
+*/
+void Task_ParallelRange(int32_t count, int32_t minchunk, task_range_func_t func, void *data)
+{
+    taskrange_t ranges[MAX_TASK_WORKERS + 1];
+    taskgroup_t group;
+    int32_t i, numchunks, chunk;
+
+    if (count <= 0)
+        return;
+
+    if (minchunk < 1)
+        minchunk = 1;
+
+    numchunks = task_numworkers + 1;
+    if (numchunks > count / minchunk)
+        numchunks = count / minchunk;
+
+    if (numchunks <= 1)
+    {
+        func(0, count, data);
+        return;
+    }
+
+    atomic_init(&group.pending, 0);
+    chunk = (count + numchunks - 1) / numchunks;
+
+    for (i = 0; i < numchunks; i++)
+    {
+        ranges[i].func = func;
+        ranges[i].data = data;
+        ranges[i].start = i * chunk;
+        ranges[i].end = (i + 1) * chunk;
+        if (ranges[i].end > count)
+            ranges[i].end = count;
+    }
+
+    // hand out all but the first chunk, which the caller runs itself
+    for (i = 1; i < numchunks; i++)
+        Task_Submit(&group, Task_RunRange, &ranges[i]);
+
+    Task_RunRange(&ranges[0]);
+    Task_Wait(&group);
+}
+
+/*
+================
+Tasks_NumWorkers
+================
+*/
+int32_t Tasks_NumWorkers(void)
+{
+    return task_numworkers;
+}
+
+/*
+================
+Tasks_Init
+================
+*/
+void Tasks_Init(void)
+{
+    int32_t i, want;
+
+    i = COM_CheckParm("-threads");
+    if (i && i < com_argc - 1)
+        want = (int32_t)strtol(com_argv[i + 1], NULL, 0);
+    else
+        want = (int32_t)sysconf(_SC_NPROCESSORS_ONLN) - 1;
+
+    if (want < 0)
+        want = 0;
+    if (want > MAX_TASK_WORKERS)
+        want = MAX_TASK_WORKERS;
+
+    task_shutdown = false;
+    task_head = task_tail = 0;
+
+    for (task_numworkers = 0; task_numworkers < want; task_numworkers++)
+    {
+        if (pthread_create(&task_threads[task_numworkers], NULL, Task_Worker, NULL))
+            break;
+    }
+
+    Con_Printf("%d worker threads\n", task_numworkers);
+}
+
+/*
+================
+Tasks_Shutdown
+================
+*/
+void Tasks_Shutdown(void)
+{
+    int32_t i;
+
+    if (!task_numworkers)
+        return;
+
+    pthread_mutex_lock(&task_lock);
+    task_shutdown = true;
+    pthread_cond_broadcast(&task_wake);
+    pthread_mutex_unlock(&task_lock);
+
+    for (i = 0; i < task_numworkers; i++)
+        pthread_join(task_threads[i], NULL);
+
+    task_numworkers = 0;
+}
@@ -0,0 +1,44 @@
+/*
+ tasks.h -- worker thread pool
+
+Task_??? Work that does not touch engine state owned by the main thread can
+be handed to a small pool of worker threads.  A task is a function pointer
+and a data pointer.  Tasks that the caller needs to wait for are submitted
+into a taskgroup_t; Task_Wait blocks until every task in the group has run,
+and the waiting thread runs the group's own queued tasks meanwhile, never
+unrelated ones that might take much longer.
+
+With no workers (-threads 0, or a single core machine) every task simply
+runs inline at submit time, so callers do not need a separate serial path.
+
+Workers must never call Con_Printf, Sys_Error, Hunk_* / Cache_* / Z_* or any
+other function that is not explicitly documented as thread safe.
+*/
+
+#define MAX_TASK_WORKERS 8
+
+typedef void (*task_func_t)(void *data);
+typedef void (*task_range_func_t)(int32_t start, int32_t end, void *data);
+
+typedef struct taskgroup_s
+{
+    _Atomic int32_t pending;
+} taskgroup_t;
+
+void Tasks_Init(void);
+void Tasks_Shutdown(void);
+
+int32_t Tasks_NumWorkers(void);
+// number of worker threads, 0 if everything runs on the main thread
+
+void Task_Submit(taskgroup_t *group, task_func_t func, void *data);
+// group may be NULL for fire and forget work
+
+void Task_Wait(taskgroup_t *group);
+
+bool Task_Done(taskgroup_t *group);
+// polls instead of waiting
+
+void Task_ParallelRange(int32_t count, int32_t minchunk, task_range_func_t func, void *data);
+// splits [0, count) into chunks of at least minchunk elements, runs func on
+// each chunk across the pool and returns when all of them have finished
@@ -120,6 +120,8 @@ void VID_Update(vrect_t *rects)
     unsigned char *src = (unsigned char *)vid.buffer;
     Color *dest = (Color *)image32bpp.data;
 
+    PROF_BEGIN("VID_Update");
+
     for (int i = 0; i < vid.width * vid.height; i++)
     {
         dest[i] = palette[src[i]];
@@ -132,6 +134,8 @@ void VID_Update(vrect_t *rects)
     DrawTexturePro(screenTexture, (Rectangle){0, 0, vid.width, vid.height},
                    (Rectangle){0, 0, GetScreenWidth(), GetScreenHeight()}, (Vector2){0, 0}, 0, WHITE);
     EndDrawing();
+
+    PROF_END();
 }
 
 static int TranslateKey(int key)
@@ -6,6 +6,11 @@ int32_t wad_numlumps;
 lumpinfo_t *wad_lumps;
 uint8_t *wad_base;
 
+#define WAD_HASHSIZE 256 // must be a power of two
+
+static int32_t wad_hash[WAD_HASHSIZE]; // first lump in each chain, -1 for none
+static int32_t *wad_hashnext;
+
 void SwapPic(qpic_t *pic);
 
 /*
@@ -48,7 +53,7 @@ void W_LoadWadFile(char *filename)
 {
     lumpinfo_t *lump_p;
     wadinfo_t *header;
-    uint32_t i;
+    uint32_t i, h;
     int32_t infotableofs;
 
     wad_base = COM_LoadHunkFile(filename);
@@ -73,6 +78,33 @@ void W_LoadWadFile(char *filename)
         if (lump_p->type == TYP_QPIC)
             SwapPic((qpic_t *)(wad_base + lump_p->filepos));
     }
+
+    // chain backwards so the first of two lumps with one name is found
+    wad_hashnext = Hunk_AllocName(wad_numlumps * sizeof(int32_t), "wadhash");
+    for (i = 0; i < WAD_HASHSIZE; i++)
+        wad_hash[i] = -1;
+    for (i = wad_numlumps; i-- > 0;)
+    {
+        h = COM_HashName(wad_lumps[i].name) & (WAD_HASHSIZE - 1);
+        wad_hashnext[i] = wad_hash[h];
+        wad_hash[h] = i;
+    }
+}
+
+/*
+=============
+W_FindLump
+=============
+*/
+static lumpinfo_t *W_FindLump(char *clean)
+{
+    int32_t i;
+
+    for (i = wad_hash[COM_HashName(clean) & (WAD_HASHSIZE - 1)]; i != -1; i = wad_hashnext[i])
+        if (!strcmp(clean, wad_lumps[i].name))
+            return &wad_lumps[i];
+
+    return NULL;
 }
 
 /*
@@ -82,20 +114,55 @@ W_GetLumpinfo
 */
 lumpinfo_t *W_GetLumpinfo(char *name)
 {
-    int32_t i;
     lumpinfo_t *lump_p;
     char clean[16];
 
     W_CleanupName(name, clean);
 
-    for (lump_p = wad_lumps, i = 0; i < wad_numlumps; i++, lump_p++)
-    {
-        if (!strcmp(clean, lump_p->name))
-            return lump_p;
-    }
+    lump_p = W_FindLump(clean);
+    if (!lump_p)
+        Sys_Error("W_GetLumpinfo: %s not found", name);
 
-    Sys_Error("W_GetLumpinfo: %s not found", name);
-    return NULL;
+    return lump_p;
+}
+
+/*
+=============
+W_Benchmark
+
+Compares the old scan over every lump with the hashed lookup
+=============
+*/
+void W_Benchmark(int32_t passes)
+{
+    int32_t i, j, pass, found;
+    double start, linear, hashed;
+
+    if (!wad_numlumps)
+        return;
+
+    found = 0;
+    start = Sys_FloatTime();
+    for (pass = 0; pass < passes; pass++)
+        for (i = 0; i < wad_numlumps; i++)
+            for (j = 0; j < wad_numlumps; j++)
+                if (!strcmp(wad_lumps[i].name, wad_lumps[j].name))
+                {
+                    found++;
+                    break;
+                }
+    linear = Sys_FloatTime() - start;
+
+    start = Sys_FloatTime();
+    for (pass = 0; pass < passes; pass++)
+        for (i = 0; i < wad_numlumps; i++)
+            if (W_FindLump(wad_lumps[i].name))
+                found++;
+    hashed = Sys_FloatTime() - start;
+
+    Con_Printf("%i wad lumps, %i found\n", wad_numlumps, found);
+    Con_Printf("scan  %10.0f lookups/sec\n", wad_numlumps * passes / (linear > 0 ? linear : 1e-9));
+    Con_Printf("index %10.0f lookups/sec\n", wad_numlumps * passes / (hashed > 0 ? hashed : 1e-9));
 }
 
 void *W_GetLumpName(char *name)
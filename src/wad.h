@@ -50,5 +50,6 @@ void W_CleanupName(char *in, char *out);
 lumpinfo_t *W_GetLumpinfo(char *name);
 void *W_GetLumpName(char *name);
 void *W_GetLumpNum(int32_t num);
+void W_Benchmark(int32_t passes);
 
 void SwapPic(qpic_t *pic);
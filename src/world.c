@@ -23,6 +23,8 @@ typedef struct
 
 int32_t SV_HullPointContents(hull_t *hull, int32_t num, vec3_t p);
 
+int32_t sv_tracecount;
+
 /*
 ===============================================================================
 
@@ -32,7 +34,7 @@ HULL BOXES
 */
 
 static hull_t box_hull;
-static dclipnode_t box_clipnodes[6];
+static mclipnode_t box_clipnodes[6];
 static mplane_t box_planes[6];
 
 /*
@@ -426,7 +428,7 @@ SV_HullPointContents
 int32_t SV_HullPointContents(hull_t *hull, int32_t num, vec3_t p)
 {
     float d;
-    dclipnode_t *node;
+    mclipnode_t *node;
     mplane_t *plane;
 
     while (num >= 0)
@@ -511,7 +513,7 @@ SV_RecursiveHullCheck
 */
 bool SV_RecursiveHullCheck(hull_t *hull, int32_t num, float p1f, float p2f, vec3_t p1, vec3_t p2, trace_t *trace)
 {
-    dclipnode_t *node;
+    mclipnode_t *node;
     mplane_t *plane;
     float t1, t2;
     float frac;
@@ -800,6 +802,8 @@ trace_t SV_Move(vec3_t start, vec3_t mins, vec3_t maxs, vec3_t end, int32_t type
     moveclip_t clip;
     int32_t i;
 
+    sv_tracecount++;
+
     memset(&clip, 0, sizeof(moveclip_t));
 
     // clip to world
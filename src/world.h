@@ -43,9 +43,15 @@ int32_t SV_TruePointContents(vec3_t p);
 
 edict_t *SV_TestEntityPosition(edict_t *ent);
 
+bool SV_RecursiveHullCheck(hull_t *hull, int32_t num, float p1f, float p2f, vec3_t p1, vec3_t p2, trace_t *trace);
+// traces p1 to p2 through the hull from node num, trace should start out
+// allsolid with a fraction of 1.  false if something was hit.
+
 trace_t SV_Move(vec3_t start, vec3_t mins, vec3_t maxs, vec3_t end, int32_t type, edict_t *passedict);
 // mins and maxs are reletive
 
+extern int32_t sv_tracecount; // SV_Move calls, for the counter registry
+
 // if the entire move stays in a solid volume, trace.allsolid will be set
 
 // if the starting point is in a solid, it will be allowed to move out
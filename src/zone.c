@@ -7,65 +7,312 @@
 #define ZONEID 0x1d4a11
 #define MINFRAGMENT 64
 
+// two level segregated fit: each power of two size range is split into
+// ZONE_SLCOUNT lists, and sizes below ZONE_SMALLBLOCK share the first range
+#define ZONE_ALIGNBITS 3
+#define ZONE_SLBITS 4
+#define ZONE_SLCOUNT (1 << ZONE_SLBITS)
+#define ZONE_FLSHIFT (ZONE_SLBITS + ZONE_ALIGNBITS)
+#define ZONE_SMALLBLOCK (1 << ZONE_FLSHIFT)
+#define ZONE_FLCOUNT (32 - ZONE_FLSHIFT)
+
 typedef struct memblock_s
 {
     int32_t size; // including the header and possibly tiny fragments
     int32_t tag;  // a tag of 0 is a free block
     int32_t id;   // should be ZONEID
-    struct memblock_s *next, *prev;
-    int32_t pad; // pad to 64 bit boundary
+    memcat_t category;
+    struct memblock_s *prev;               // block just below this one in its arena, NULL for the first
+    struct memblock_s *nextfree, *prevfree; // size class list, only while free
 } memblock_t;
 
+typedef struct memarena_s
+{
+    int32_t size; // including this header and the end cap
+    bool malloced;
+    struct memarena_s *next;
+} memarena_t;
+
 typedef struct
 {
-    int32_t size;         // total bytes malloced, including header
-    memblock_t blocklist; // start / end cap for linked list
-    memblock_t *rover;
+    int32_t size; // total bytes in every arena
+    memarena_t *arenas;
+
+    uint32_t flbitmap;               // bit set for each first level with a free block
+    uint32_t slbitmap[ZONE_FLCOUNT]; // bit set for each second level list that isn't empty
+    memblock_t *free[ZONE_FLCOUNT][ZONE_SLCOUNT];
+
+    int32_t used; // bytes in allocated blocks, headers included
+    int32_t highwater;
+    int32_t numused;
+    int32_t numfree;
+    int32_t numarenas;
 } memzone_t;
 
 void Cache_FreeLow(int32_t new_low_hunk);
 void Cache_FreeHigh(int32_t new_high_hunk);
 
+memcat_t mem_category; // what hunk and zone allocations are counted as
+
+static char *mem_categorynames[MEM_NUMCATEGORIES] = {"misc",     "models", "sounds", "pics",   "world", "textures",
+                                                     "lighting", "edicts", "progs",  "render", "temp"};
+
+static int32_t mem_hunk[MEM_NUMCATEGORIES]; // bytes in use, headers included
+static int32_t mem_cache[MEM_NUMCATEGORIES];
+static int32_t mem_zone[MEM_NUMCATEGORIES];
+static int32_t mem_peak[MEM_NUMCATEGORIES]; // most of hunk + cache + zone since Memory_BeginMap
+static int32_t mem_total, mem_totalpeak;
+
+/*
+========================
+Memory_Account
+
+Adds delta bytes to a category in one of the mem_ arrays.  Anything counted
+as MEM_NUMCATEGORIES or above isn't counted at all.
+========================
+*/
+static void Memory_Account(int32_t *counts, memcat_t category, int32_t delta)
+{
+    int32_t sum;
+
+    if (category >= MEM_NUMCATEGORIES)
+        return;
+
+    counts[category] += delta;
+    mem_total += delta;
+
+    sum = mem_hunk[category] + mem_cache[category] + mem_zone[category];
+    if (sum > mem_peak[category])
+        mem_peak[category] = sum;
+    if (mem_total > mem_totalpeak)
+        mem_totalpeak = mem_total;
+}
+
+/*
+========================
+Memory_SetCategory
+
+Returns the category that was being used, so it can be put back
+========================
+*/
+memcat_t Memory_SetCategory(memcat_t category)
+{
+    memcat_t old;
+
+    old = mem_category;
+    mem_category = category;
+    return old;
+}
+
 /*
 ==============================================================================
 
                                                 ZONE MEMORY ALLOCATION
 
 There is never any space between memblocks, and there will never be two
-contiguous free memblocks.
+contiguous free memblocks within an arena.
+
+Free blocks are kept on a list for their size class, with a bitmap of the
+lists that aren't empty, so finding a block and freeing one both take a
+fixed number of steps no matter how many blocks there are.  A request is
+rounded up to the start of the next class, so any block on a list found
+through the bitmaps is big enough.
 
-The rover can be left pointing at a non-empty block
+The first arena comes from the bottom of the hunk.  If it fills up, more
+arenas are malloced rather than failing, and zone prints how far it got.
 
 The zone calls are pretty much only used for small strings and structures,
 all big things are allocated on the hunk.
 ==============================================================================
 */
 
-static memzone_t *mainzone;
+static memzone_t mainzone;
+static int32_t zone_growsize;
+static bool zone_check; // -zonecheck, check the whole heap on every allocation
 
-void Z_ClearZone(memzone_t *zone, int32_t size);
+#define Z_FirstBlock(arena) ((memblock_t *)((uint8_t *)(arena) + ((sizeof(memarena_t) + 15) & ~15)))
+#define Z_EndCap(arena) ((memblock_t *)((uint8_t *)(arena) + (arena)->size - sizeof(memblock_t)))
 
 /*
 ========================
-Z_ClearZone
+Z_Mapping
+
+Works out the size class lists a block of the given size belongs on
 ========================
 */
-void Z_ClearZone(memzone_t *zone, int32_t size)
+static void Z_Mapping(uint32_t size, int32_t *fl, int32_t *sl)
 {
-    memblock_t *block;
+    int32_t f;
+
+    if (size < ZONE_SMALLBLOCK)
+    {
+        *fl = 0;
+        *sl = size >> ZONE_ALIGNBITS;
+        return;
+    }
+
+    f = 31 - __builtin_clz(size);
+    *sl = (size >> (f - ZONE_SLBITS)) ^ ZONE_SLCOUNT;
+    *fl = f - ZONE_FLSHIFT + 1;
+}
+
+/*
+========================
+Z_InsertFree
+========================
+*/
+static void Z_InsertFree(memzone_t *zone, memblock_t *block)
+{
+    int32_t fl, sl;
+
+    Z_Mapping(block->size, &fl, &sl);
+
+    block->tag = 0;
+    block->prevfree = NULL;
+    block->nextfree = zone->free[fl][sl];
+    if (block->nextfree)
+        block->nextfree->prevfree = block;
+    zone->free[fl][sl] = block;
+
+    zone->flbitmap |= 1u << fl;
+    zone->slbitmap[fl] |= 1u << sl;
+    zone->numfree++;
+}
+
+/*
+========================
+Z_RemoveFree
+========================
+*/
+static void Z_RemoveFree(memzone_t *zone, memblock_t *block)
+{
+    int32_t fl, sl;
+
+    Z_Mapping(block->size, &fl, &sl);
+
+    if (block->nextfree)
+        block->nextfree->prevfree = block->prevfree;
+    if (block->prevfree)
+        block->prevfree->nextfree = block->nextfree;
+    else
+    {
+        zone->free[fl][sl] = block->nextfree;
+        if (!block->nextfree)
+        {
+            zone->slbitmap[fl] &= ~(1u << sl);
+            if (!zone->slbitmap[fl])
+                zone->flbitmap &= ~(1u << fl);
+        }
+    }
+    zone->numfree--;
+}
+
+/*
+========================
+Z_FindFree
+
+Returns the first block on the lowest list that only holds blocks of at
+least size, or NULL
+========================
+*/
+static memblock_t *Z_FindFree(memzone_t *zone, uint32_t size)
+{
+    int32_t fl, sl;
+    uint32_t map;
+
+    if (size >= ZONE_SMALLBLOCK)
+        size += (1u << (31 - __builtin_clz(size) - ZONE_SLBITS)) - 1;
+    if (size > INT32_MAX)
+        return NULL;
+
+    Z_Mapping(size, &fl, &sl);
+
+    map = zone->slbitmap[fl] & (~0u << sl);
+    if (!map)
+    {
+        if (fl + 1 >= ZONE_FLCOUNT)
+            return NULL;
+        map = zone->flbitmap & (~0u << (fl + 1));
+        if (!map)
+            return NULL;
+        fl = __builtin_ctz(map);
+        map = zone->slbitmap[fl];
+    }
+    sl = __builtin_ctz(map);
+
+    return zone->free[fl][sl];
+}
+
+/*
+========================
+Z_AddArena
 
-    // set the entire zone to one free block
+Turns a piece of memory into one free block, with an allocated end cap
+after it so nothing merges past the end
+========================
+*/
+static void Z_AddArena(memzone_t *zone, void *buf, int32_t size, bool malloced)
+{
+    memarena_t *arena;
+    memblock_t *block, *cap;
+
+    arena = buf;
+    arena->size = size;
+    arena->malloced = malloced;
+    arena->next = zone->arenas;
+    zone->arenas = arena;
 
-    zone->blocklist.next = zone->blocklist.prev = block = (memblock_t *)((uint8_t *)zone + sizeof(memzone_t));
-    zone->blocklist.tag = 1; // in use block
-    zone->blocklist.id = 0;
-    zone->blocklist.size = 0;
-    zone->rover = block;
+    block = Z_FirstBlock(arena);
+    cap = Z_EndCap(arena);
 
-    block->prev = block->next = &zone->blocklist;
-    block->tag = 0; // free block
+    block->size = (uint8_t *)cap - (uint8_t *)block;
     block->id = ZONEID;
-    block->size = size - sizeof(memzone_t);
+    block->prev = NULL;
+
+    cap->size = sizeof(memblock_t);
+    cap->tag = 1;
+    cap->id = ZONEID;
+    cap->prev = block;
+
+    Z_InsertFree(zone, block);
+
+    zone->size += size;
+    zone->numarenas++;
+}
+
+/*
+========================
+Z_ClearZone
+========================
+*/
+void Z_ClearZone(memzone_t *zone, void *buf, int32_t size)
+{
+    memset(zone, 0, sizeof(*zone));
+    Z_AddArena(zone, buf, size, false);
+}
+
+/*
+========================
+Z_Grow
+
+Mallocs another arena with room for at least size bytes
+========================
+*/
+static void Z_Grow(memzone_t *zone, int32_t size)
+{
+    int32_t arenasize;
+    void *buf;
+
+    arenasize = zone_growsize;
+    if (arenasize < size + 256)
+        arenasize = (size + 256 + 4095) & ~4095;
+
+    buf = malloc(arenasize);
+    if (!buf)
+        Sys_Error("Z_Malloc: failed to grow the zone by %i bytes", arenasize);
+
+    Z_AddArena(zone, buf, arenasize, true);
+    Con_DPrintf("zone grew to %i bytes in %i arenas\n", zone->size, zone->numarenas);
 }
 
 /*
@@ -85,29 +332,31 @@ void Z_Free(void *ptr)
         Sys_Error("Z_Free: freed a pointer without ZONEID");
     if (block->tag == 0)
         Sys_Error("Z_Free: freed a freed pointer");
+    if (*(int32_t *)((uint8_t *)block + block->size - 4) != ZONEID)
+        Sys_Error("Z_Free: memory trashed past the end of a block");
 
-    block->tag = 0; // mark as free
+    mainzone.used -= block->size;
+    mainzone.numused--;
+    Memory_Account(mem_zone, block->category, -block->size);
 
     other = block->prev;
-    if (!other->tag)
+    if (other && !other->tag)
     { // merge with previous free block
+        Z_RemoveFree(&mainzone, other);
         other->size += block->size;
-        other->next = block->next;
-        other->next->prev = other;
-        if (block == mainzone->rover)
-            mainzone->rover = other;
         block = other;
     }
 
-    other = block->next;
+    other = (memblock_t *)((uint8_t *)block + block->size);
     if (!other->tag)
     { // merge the next free block onto the end
+        Z_RemoveFree(&mainzone, other);
         block->size += other->size;
-        block->next = other->next;
-        block->next->prev = block;
-        if (other == mainzone->rover)
-            mainzone->rover = block;
     }
+
+    ((memblock_t *)((uint8_t *)block + block->size))->prev = block;
+
+    Z_InsertFree(&mainzone, block);
 }
 
 /*
@@ -119,7 +368,8 @@ void *Z_Malloc(int32_t size)
 {
     void *buf;
 
-    Z_CheckHeap(); // DEBUG
+    if (zone_check)
+        Z_CheckHeap();
     buf = Z_TagMalloc(size, 1);
     if (!buf)
         Sys_Error("Z_Malloc: failed on allocation of %i bytes", size);
@@ -131,31 +381,26 @@ void *Z_Malloc(int32_t size)
 void *Z_TagMalloc(int32_t size, int32_t tag)
 {
     int32_t extra;
-    memblock_t *start, *rover, *new, *base;
+    memblock_t *base, *new;
 
     if (!tag)
         Sys_Error("Z_TagMalloc: tried to use a 0 tag");
+    if (size < 0 || size > INT32_MAX / 2)
+        return NULL;
 
-    //
-    // scan through the block list looking for the first free block
-    // of sufficient size
-    //
     size += sizeof(memblock_t); // account for size of block header
     size += 4;                  // space for memory trash tester
     size = (size + 7) & ~7;     // align to 8-byte boundary
 
-    base = rover = mainzone->rover;
-    start = base->prev;
-
-    do
+    base = Z_FindFree(&mainzone, size);
+    if (!base)
     {
-        if (rover == start) // scaned all the way around the list
+        Z_Grow(&mainzone, size);
+        base = Z_FindFree(&mainzone, size);
+        if (!base)
             return NULL;
-        if (rover->tag)
-            base = rover = rover->next;
-        else
-            rover = rover->next;
-    } while (base->tag || base->size < size);
+    }
+    Z_RemoveFree(&mainzone, base);
 
     //
     // found a block big enough
@@ -165,20 +410,22 @@ void *Z_TagMalloc(int32_t size, int32_t tag)
     { // there will be a free fragment after the allocated block
         new = (memblock_t *)((uint8_t *)base + size);
         new->size = extra;
-        new->tag = 0; // free block
-        new->prev = base;
         new->id = ZONEID;
-        new->next = base->next;
-        new->next->prev = new;
-        base->next = new;
+        new->prev = base;
+        ((memblock_t *)((uint8_t *)new + extra))->prev = new;
         base->size = size;
+        Z_InsertFree(&mainzone, new);
     }
 
     base->tag = tag; // no longer a free block
-
-    mainzone->rover = base->next; // next allocation will start looking here
-
     base->id = ZONEID;
+    base->category = mem_category;
+    Memory_Account(mem_zone, base->category, base->size);
+
+    mainzone.used += base->size;
+    mainzone.numused++;
+    if (mainzone.used > mainzone.highwater)
+        mainzone.highwater = mainzone.used;
 
     // marker for memory trash testing
     *(int32_t *)((uint8_t *)base + base->size - 4) = ZONEID;
@@ -188,28 +435,85 @@ void *Z_TagMalloc(int32_t size, int32_t tag)
 
 /*
 ========================
-Z_Print
+Z_LargestFree
 ========================
 */
-void Z_Print(memzone_t *zone)
+static int32_t Z_LargestFree(memzone_t *zone)
 {
+    int32_t fl, sl, largest;
     memblock_t *block;
 
-    Con_Printf("zone size: %i  location: %p\n", mainzone->size, mainzone);
+    if (!zone->flbitmap)
+        return 0;
+
+    // only the highest list that isn't empty needs looking through
+    fl = 31 - __builtin_clz(zone->flbitmap);
+    sl = 31 - __builtin_clz(zone->slbitmap[fl]);
+
+    largest = 0;
+    for (block = zone->free[fl][sl]; block; block = block->nextfree)
+        if (block->size > largest)
+            largest = block->size;
+
+    return largest;
+}
+
+/*
+========================
+Z_FreeMemory
+========================
+*/
+int32_t Z_FreeMemory(void)
+{
+    return mainzone.size - mainzone.used;
+}
+
+/*
+========================
+Z_Print
+========================
+*/
+void Z_Print(memzone_t *zone, bool all)
+{
+    memarena_t *arena;
+    memblock_t *block, *end;
+    int32_t freebytes, largest;
 
-    for (block = zone->blocklist.next;; block = block->next)
+    freebytes = 0;
+    for (arena = zone->arenas; arena; arena = arena->next)
     {
-        Con_Printf("block:%p    size:%7i    tag:%3i\n", block, block->size, block->tag);
+        if (all)
+            Con_Printf("arena:%p    size:%7i%s\n", arena, arena->size, arena->malloced ? "" : " (hunk)");
 
-        if (block->next == &zone->blocklist)
-            break; // all blocks have been hit
-        if ((uint8_t *)block + block->size != (uint8_t *)block->next)
-            Con_Printf("ERROR: block size does not touch the next block\n");
-        if (block->next->prev != block)
-            Con_Printf("ERROR: next block doesn't have proper back link\n");
-        if (!block->tag && !block->next->tag)
-            Con_Printf("ERROR: two consecutive free blocks\n");
+        end = Z_EndCap(arena);
+        for (block = Z_FirstBlock(arena); block != end; block = (memblock_t *)((uint8_t *)block + block->size))
+        {
+            if (!block->tag)
+                freebytes += block->size;
+            if (all)
+                Con_Printf("block:%p    size:%7i    tag:%3i\n", block, block->size, block->tag);
+        }
     }
+
+    largest = Z_LargestFree(zone);
+
+    Con_Printf("zone size: %i in %i arena%s\n", zone->size, zone->numarenas, zone->numarenas == 1 ? "" : "s");
+    Con_Printf("%8i bytes in %i blocks\n", zone->used, zone->numused);
+    Con_Printf("%8i bytes free in %i blocks, largest %i\n", freebytes, zone->numfree, largest);
+    Con_Printf("%8i high water mark\n", zone->highwater);
+    Con_Printf("fragmentation: %.1f%%\n", freebytes ? 100.0 * (1.0 - (double)largest / freebytes) : 0.0);
+}
+
+/*
+========================
+Z_Print_f
+
+zone [all]
+========================
+*/
+static void Z_Print_f(void)
+{
+    Z_Print(&mainzone, Cmd_Argc() > 1 && !strcmp(Cmd_Argv(1), "all"));
 }
 
 /*
@@ -219,18 +523,26 @@ Z_CheckHeap
 */
 void Z_CheckHeap(void)
 {
-    memblock_t *block;
+    memarena_t *arena;
+    memblock_t *block, *next, *end;
 
-    for (block = mainzone->blocklist.next;; block = block->next)
+    for (arena = mainzone.arenas; arena; arena = arena->next)
     {
-        if (block->next == &mainzone->blocklist)
-            break; // all blocks have been hit
-        if ((uint8_t *)block + block->size != (uint8_t *)block->next)
-            Sys_Error("Z_CheckHeap: block size does not touch the next block\n");
-        if (block->next->prev != block)
-            Sys_Error("Z_CheckHeap: next block doesn't have proper back link\n");
-        if (!block->tag && !block->next->tag)
-            Sys_Error("Z_CheckHeap: two consecutive free blocks\n");
+        end = Z_EndCap(arena);
+        for (block = Z_FirstBlock(arena); block != end; block = next)
+        {
+            if (block->id != ZONEID)
+                Sys_Error("Z_CheckHeap: block without ZONEID\n");
+            if (block->size < (int32_t)sizeof(memblock_t) || (uint8_t *)block + block->size > (uint8_t *)end)
+                Sys_Error("Z_CheckHeap: bad block size\n");
+            next = (memblock_t *)((uint8_t *)block + block->size);
+            if (next->prev != block)
+                Sys_Error("Z_CheckHeap: next block doesn't have proper back link\n");
+            if (!block->tag && !next->tag)
+                Sys_Error("Z_CheckHeap: two consecutive free blocks\n");
+            if (block->tag && *(int32_t *)((uint8_t *)block + block->size - 4) != ZONEID)
+                Sys_Error("Z_CheckHeap: memory trashed past the end of a block\n");
+        }
     }
 }
 
@@ -243,6 +555,8 @@ typedef struct
     int32_t sentinal;
     int32_t size; // including sizeof(hunk_t), -1 = not allocated
     char name[8];
+    memcat_t category;
+    int32_t pad[3]; // keep the data 16 byte aligned
 } hunk_t;
 
 static uint8_t *hunk_base;
@@ -254,6 +568,23 @@ static int32_t hunk_high_used;
 static bool hunk_tempactive;
 static int32_t hunk_tempmark;
 
+#define RETAINED_CHUNK (1024 * 1024)
+
+typedef struct retainchunk_s
+{
+    struct retainchunk_s *next;
+    int32_t size, used; // including this header
+} retainchunk_t;
+
+static bool hunk_retaining;
+static retainchunk_t *hunk_retained;
+static int32_t hunk_retainedbytes[MEM_NUMCATEGORIES];
+
+// the tier as it was at Hunk_BeginRetained, for Hunk_AbortRetained
+static retainchunk_t *hunk_retainstart;
+static int32_t hunk_retainstartused;
+static int32_t hunk_retainstartbytes[MEM_NUMCATEGORIES];
+
 void R_FreeTextures(void);
 
 /*
@@ -362,6 +693,147 @@ void Hunk_Print(bool all)
     Con_Printf("%8i total blocks\n", totalblocks);
 }
 
+/*
+===================
+Hunk_RetainedAlloc
+
+Takes low hunk allocations while a retained asset is loading.  The memory
+comes from malloced chunks that Hunk_FreeToLowMark never touches.
+===================
+*/
+static void *Hunk_RetainedAlloc(int32_t size, char *name)
+{
+    retainchunk_t *chunk;
+    uint8_t *buf;
+    int32_t chunksize;
+
+    size = (size + 15) & ~15;
+
+    chunk = hunk_retained;
+    if (!chunk || chunk->size - chunk->used < size)
+    {
+        chunksize = size + ((sizeof(retainchunk_t) + 15) & ~15);
+        if (chunksize < RETAINED_CHUNK)
+            chunksize = RETAINED_CHUNK;
+
+        chunk = malloc(chunksize);
+        if (!chunk)
+            Sys_Error("Hunk_RetainedAlloc: failed on %i bytes for %s", size, name);
+        chunk->next = hunk_retained;
+        chunk->size = chunksize;
+        chunk->used = (sizeof(retainchunk_t) + 15) & ~15;
+        hunk_retained = chunk;
+    }
+
+    buf = (uint8_t *)chunk + chunk->used;
+    chunk->used += size;
+    memset(buf, 0, size);
+
+    if (mem_category < MEM_NUMCATEGORIES)
+        hunk_retainedbytes[mem_category] += size;
+    Memory_Account(mem_hunk, mem_category, size);
+
+    Prof_Mark("hunk", "%s %d retained", name, size);
+
+    return buf;
+}
+
+/*
+===================
+Hunk_BeginRetained
+===================
+*/
+void Hunk_BeginRetained(void)
+{
+    hunk_retaining = true;
+    hunk_retainstart = hunk_retained;
+    hunk_retainstartused = hunk_retained ? hunk_retained->used : 0;
+    memcpy(hunk_retainstartbytes, hunk_retainedbytes, sizeof(hunk_retainedbytes));
+}
+
+/*
+===================
+Hunk_EndRetained
+===================
+*/
+void Hunk_EndRetained(void)
+{
+    hunk_retaining = false;
+}
+
+/*
+===================
+Hunk_AbortRetained
+
+Drops what a retained load that was cut short by an error had allocated
+===================
+*/
+void Hunk_AbortRetained(void)
+{
+    retainchunk_t *next;
+    int32_t i;
+
+    if (!hunk_retaining)
+        return;
+    hunk_retaining = false;
+
+    while (hunk_retained != hunk_retainstart)
+    {
+        next = hunk_retained->next;
+        free(hunk_retained);
+        hunk_retained = next;
+    }
+    if (hunk_retained)
+        hunk_retained->used = hunk_retainstartused;
+
+    for (i = 0; i < MEM_NUMCATEGORIES; i++)
+    {
+        Memory_Account(mem_hunk, i, hunk_retainstartbytes[i] - hunk_retainedbytes[i]);
+        hunk_retainedbytes[i] = hunk_retainstartbytes[i];
+    }
+}
+
+/*
+===================
+Hunk_FlushRetained
+
+Frees everything that was loaded as retained, whatever was using it must
+already have been forgotten
+===================
+*/
+void Hunk_FlushRetained(void)
+{
+    retainchunk_t *chunk, *next;
+    int32_t i;
+
+    for (chunk = hunk_retained; chunk; chunk = next)
+    {
+        next = chunk->next;
+        free(chunk);
+    }
+    hunk_retained = NULL;
+
+    for (i = 0; i < MEM_NUMCATEGORIES; i++)
+    {
+        Memory_Account(mem_hunk, i, -hunk_retainedbytes[i]);
+        hunk_retainedbytes[i] = 0;
+    }
+}
+
+/*
+===================
+Hunk_RetainedSize
+===================
+*/
+int32_t Hunk_RetainedSize(void)
+{
+    int32_t i, total;
+
+    for (i = 0, total = 0; i < MEM_NUMCATEGORIES; i++)
+        total += hunk_retainedbytes[i];
+    return total;
+}
+
 /*
 ===================
 Hunk_AllocName
@@ -374,6 +846,9 @@ void *Hunk_AllocName(int32_t size, char *name)
     if (size < 0)
         Sys_Error("Hunk_Alloc: bad size: %i", size);
 
+    if (hunk_retaining)
+        return Hunk_RetainedAlloc(size, name);
+
     size = sizeof(hunk_t) + ((size + 15) & ~15);
 
     if (hunk_size - hunk_low_used - hunk_high_used < size)
@@ -389,6 +864,10 @@ void *Hunk_AllocName(int32_t size, char *name)
     h->size = size;
     h->sentinal = HUNK_SENTINAL;
     strncpy(h->name, name, 8);
+    h->category = mem_category;
+    Memory_Account(mem_hunk, h->category, size);
+
+    Prof_Mark("hunk", "%s %d", name, size);
 
     return (void *)(h + 1);
 }
@@ -408,11 +887,40 @@ int32_t Hunk_LowMark(void)
     return hunk_low_used;
 }
 
+/*
+===================
+Hunk_MarkPointer
+
+The address a low mark stands for, so a run of allocations can be copied
+out whole
+===================
+*/
+void *Hunk_MarkPointer(int32_t mark)
+{
+    return hunk_base + mark;
+}
+
+/*
+===================
+Hunk_Uncount
+
+Takes the blocks between two points off their categories' totals
+===================
+*/
+static void Hunk_Uncount(uint8_t *start, uint8_t *end)
+{
+    hunk_t *h;
+
+    for (h = (hunk_t *)start; (uint8_t *)h < end; h = (hunk_t *)((uint8_t *)h + h->size))
+        Memory_Account(mem_hunk, h->category, -h->size);
+}
+
 void Hunk_FreeToLowMark(int32_t mark)
 {
     if (mark < 0 || mark > hunk_low_used)
         Sys_Error("Hunk_FreeToLowMark: bad mark %i", mark);
-    memset(hunk_base + mark, 0, hunk_low_used - mark);
+    Hunk_Uncount(hunk_base + mark, hunk_base + hunk_low_used);
+    Sys_ReleaseMemory(hunk_base + mark, hunk_low_used - mark);
     hunk_low_used = mark;
 }
 
@@ -436,7 +944,8 @@ void Hunk_FreeToHighMark(int32_t mark)
     }
     if (mark < 0 || mark > hunk_high_used)
         Sys_Error("Hunk_FreeToHighMark: bad mark %i", mark);
-    memset(hunk_base + hunk_size - hunk_high_used, 0, hunk_high_used - mark);
+    Hunk_Uncount(hunk_base + hunk_size - hunk_high_used, hunk_base + hunk_size - mark);
+    Sys_ReleaseMemory(hunk_base + hunk_size - hunk_high_used, hunk_high_used - mark);
     hunk_high_used = mark;
 }
 
@@ -475,6 +984,10 @@ void *Hunk_HighAllocName(int32_t size, char *name)
     h->size = size;
     h->sentinal = HUNK_SENTINAL;
     strncpy(h->name, name, 8);
+    h->category = mem_category;
+    Memory_Account(mem_hunk, h->category, size);
+
+    Prof_Mark("hunk", "%s %d high", name, size);
 
     return (void *)(h + 1);
 }
@@ -489,6 +1002,7 @@ Return space from the top of the hunk
 void *Hunk_TempAlloc(int32_t size)
 {
     void *buf;
+    memcat_t old;
 
     size = (size + 15) & ~15;
 
@@ -500,7 +1014,9 @@ void *Hunk_TempAlloc(int32_t size)
 
     hunk_tempmark = Hunk_HighMark();
 
+    old = Memory_SetCategory(MEM_TEMP);
     buf = Hunk_HighAllocName(size, "temp");
+    Memory_SetCategory(old);
 
     hunk_tempactive = true;
 
@@ -520,14 +1036,210 @@ typedef struct cache_system_s
     int32_t size; // including this header
     cache_user_t *user;
     char name[16];
+    memcat_t category;
+    bool pinned;                                // reloaded too often, evicted last
+    int32_t gapclass;                           // free list of the gap after this block, -1 if on none
     struct cache_system_s *prev, *next;
     struct cache_system_s *lru_prev, *lru_next; // for LRU flushing
+    struct cache_system_s *gap_prev, *gap_next; // blocks with a similar sized gap after them
 } cache_system_t;
 
+// the free space between two cache blocks is filed by the power of two
+// below its size, gaps too small to hold anything aren't filed at all
+#define CACHE_GAPCLASSES 32
+#define CACHE_MINGAP (int32_t)(sizeof(cache_system_t) + 64)
+#define CACHE_GAPSEARCH 8 // blocks looked at in the class a request falls in
+
+typedef struct
+{
+    int32_t used; // bytes, headers included
+    int32_t entries;
+    int32_t pinned;
+    int32_t evictions;
+    int32_t reloads;
+} cachestats_t;
+
 cache_system_t *Cache_TryAlloc(int32_t size, bool nobottom);
+void Cache_MakeLRU(cache_system_t *cs);
 
 static cache_system_t cache_head;
 
+static cache_system_t *cache_gaps[CACHE_GAPCLASSES];
+static uint32_t cache_gapbitmap;
+
+static cachestats_t cache_stats[MEM_NUMCATEGORIES];
+static int32_t cache_used;
+static int32_t cache_evictcount; // since the last frame, for the counters
+static int32_t cache_reloadcount;
+static int32_t cache_usedkb;
+
+static cvar_t cache_budget_models = {"cache_budget_models", "0"}; // kilobytes, 0 = no limit
+static cvar_t cache_budget_sounds = {"cache_budget_sounds", "0"};
+static cvar_t cache_budget_pics = {"cache_budget_pics", "0"};
+static cvar_t cache_autopin = {"cache_autopin", "3"}; // evictions before a reload pins an entry, 0 = never
+
+static cvar_t *cache_budgets[MEM_NUMCATEGORIES] = {
+    [MEM_MODELS] = &cache_budget_models,
+    [MEM_SOUNDS] = &cache_budget_sounds,
+    [MEM_PICS] = &cache_budget_pics,
+};
+
+/*
+===========
+Cache_UnindexGap
+===========
+*/
+static void Cache_UnindexGap(cache_system_t *cs)
+{
+    if (cs->gapclass < 0)
+        return;
+
+    if (cs->gap_next)
+        cs->gap_next->gap_prev = cs->gap_prev;
+    if (cs->gap_prev)
+        cs->gap_prev->gap_next = cs->gap_next;
+    else
+    {
+        cache_gaps[cs->gapclass] = cs->gap_next;
+        if (!cs->gap_next)
+            cache_gapbitmap &= ~(1u << cs->gapclass);
+    }
+
+    cs->gap_prev = cs->gap_next = NULL;
+    cs->gapclass = -1;
+}
+
+/*
+===========
+Cache_IndexGap
+
+Files the block under the size of the free space between it and the next
+block.  Must be called whenever the block's next link changes.  The space
+below the first block and above the last one depends on the hunk marks, so
+Cache_TryAlloc checks those directly instead.
+===========
+*/
+static void Cache_IndexGap(cache_system_t *cs)
+{
+    int32_t gap;
+
+    Cache_UnindexGap(cs);
+
+    if (cs == &cache_head || cs->next == &cache_head)
+        return;
+
+    gap = (uint8_t *)cs->next - ((uint8_t *)cs + cs->size);
+    if (gap < CACHE_MINGAP)
+        return;
+
+    cs->gapclass = 31 - __builtin_clz(gap);
+    cs->gap_prev = NULL;
+    cs->gap_next = cache_gaps[cs->gapclass];
+    if (cs->gap_next)
+        cs->gap_next->gap_prev = cs;
+    cache_gaps[cs->gapclass] = cs;
+    cache_gapbitmap |= 1u << cs->gapclass;
+}
+
+/*
+===========
+Cache_FindGap
+
+Returns a block with at least size free bytes after it, or NULL
+===========
+*/
+static cache_system_t *Cache_FindGap(int32_t size)
+{
+    cache_system_t *cs;
+    int32_t class, i;
+    uint32_t map;
+
+    // the class size falls in may hold gaps either side of it
+    class = 31 - __builtin_clz(size);
+    for (cs = cache_gaps[class], i = 0; cs && i < CACHE_GAPSEARCH; cs = cs->gap_next, i++)
+        if ((uint8_t *)cs->next - ((uint8_t *)cs + cs->size) >= size)
+            return cs;
+
+    // every gap in a higher class is big enough
+    if (class == CACHE_GAPCLASSES - 1)
+        return NULL;
+    map = cache_gapbitmap & (~0u << (class + 1));
+    if (!map)
+        return NULL;
+
+    return cache_gaps[__builtin_ctz(map)];
+}
+
+/*
+===========
+Cache_Link
+
+Makes a new block at the given address, after prev in the block list
+===========
+*/
+static cache_system_t *Cache_Link(void *buf, int32_t size, cache_system_t *prev)
+{
+    cache_system_t *new;
+
+    new = buf;
+    memset(new, 0, sizeof(*new));
+    new->size = size;
+    new->gapclass = -1;
+
+    new->prev = prev;
+    new->next = prev->next;
+    prev->next->prev = new;
+    prev->next = new;
+
+    Cache_IndexGap(prev);
+    Cache_IndexGap(new);
+
+    Cache_MakeLRU(new);
+
+    return new;
+}
+
+/*
+===========
+Cache_Account
+
+Adds the block to its category's totals, or takes it off them if sign is -1
+===========
+*/
+static void Cache_Account(cache_system_t *cs, int32_t sign)
+{
+    cachestats_t *st;
+
+    st = &cache_stats[cs->category];
+    st->used += sign * cs->size;
+    st->entries += sign;
+    st->pinned += sign * cs->pinned;
+
+    cache_used += sign * cs->size;
+    cache_usedkb = cache_used / 1024;
+
+    Memory_Account(mem_cache, cs->category, sign * cs->size);
+}
+
+/*
+===========
+Cache_Evict
+
+Throws out an entry to make room, remembering that it happened so a reload
+can be noticed
+===========
+*/
+static void Cache_Evict(cache_system_t *cs, char *reason)
+{
+    Prof_Mark("evict", "%s for %s", cs->name, reason);
+
+    cache_stats[cs->category].evictions++;
+    cache_evictcount++;
+    cs->user->evictions++;
+
+    Cache_Free(cs->user);
+}
+
 /*
 ===========
 Cache_Move
@@ -546,14 +1258,17 @@ void Cache_Move(cache_system_t *c)
         memcpy(new + 1, c + 1, c->size - sizeof(cache_system_t));
         new->user = c->user;
         memcpy(new->name, c->name, sizeof(new->name));
+        new->category = c->category;
+        new->pinned = c->pinned;
         Cache_Free(c->user);
         new->user->data = (void *)(new + 1);
+        Cache_Account(new, 1);
     }
     else
     {
         //		Con_Printf ("cache_move failed\n");
 
-        Cache_Free(c->user); // tough luck...
+        Cache_Evict(c, "hunk"); // tough luck...
     }
 }
 
@@ -599,7 +1314,7 @@ void Cache_FreeHigh(int32_t new_high_hunk)
         if ((uint8_t *)c + c->size <= hunk_base + hunk_size - new_high_hunk)
             return; // there is space to grow the hunk
         if (c == prev)
-            Cache_Free(c->user); // didn't move out of the way
+            Cache_Evict(c, "hunk"); // didn't move out of the way
         else
         {
             Cache_Move(c); // try to move it
@@ -640,72 +1355,38 @@ Size should already include the header and padding
 */
 cache_system_t *Cache_TryAlloc(int32_t size, bool nobottom)
 {
-    cache_system_t *cs, *new;
+    cache_system_t *cs;
+    uint8_t *bottom, *top, *end;
+
+    bottom = hunk_base + hunk_low_used;
+    top = hunk_base + hunk_size - hunk_high_used;
 
     // is the cache completely empty?
 
     if (!nobottom && cache_head.prev == &cache_head)
     {
-        if (hunk_size - hunk_high_used - hunk_low_used < size)
+        if (top - bottom < size)
             Sys_Error("Cache_TryAlloc: %i is greater then free hunk", size);
 
-        new = (cache_system_t *)(hunk_base + hunk_low_used);
-        memset(new, 0, sizeof(*new));
-        new->size = size;
-
-        cache_head.prev = cache_head.next = new;
-        new->prev = new->next = &cache_head;
-
-        Cache_MakeLRU(new);
-        return new;
+        return Cache_Link(bottom, size, &cache_head);
     }
 
-    // search from the bottom up for space
-
-    new = (cache_system_t *)(hunk_base + hunk_low_used);
-    cs = cache_head.next;
-
-    do
-    {
-        if (!nobottom || cs != cache_head.next)
-        {
-            if ((uint8_t *)cs - (uint8_t *)new >= size)
-            { // found space
-                memset(new, 0, sizeof(*new));
-                new->size = size;
-
-                new->next = cs;
-                new->prev = cs->prev;
-                cs->prev->next = new;
-                cs->prev = new;
-
-                Cache_MakeLRU(new);
+    // the space under the first block
 
-                return new;
-            }
-        }
+    if (!nobottom && (uint8_t *)cache_head.next - bottom >= size)
+        return Cache_Link(bottom, size, &cache_head);
 
-        // continue looking
-        new = (cache_system_t *)((uint8_t *)cs + cs->size);
-        cs = cs->next;
+    // a gap between two blocks
 
-    } while (cs != &cache_head);
+    cs = Cache_FindGap(size);
+    if (cs)
+        return Cache_Link((uint8_t *)cs + cs->size, size, cs);
 
     // try to allocate one at the very end
-    if (hunk_base + hunk_size - hunk_high_used - (uint8_t *)new >= size)
-    {
-        memset(new, 0, sizeof(*new));
-        new->size = size;
-
-        new->next = &cache_head;
-        new->prev = cache_head.prev;
-        cache_head.prev->next = new;
-        cache_head.prev = new;
-
-        Cache_MakeLRU(new);
-
-        return new;
-    }
+    cs = cache_head.prev;
+    end = (uint8_t *)cs + cs->size;
+    if (top - end >= size)
+        return Cache_Link(end, size, cs);
 
     return NULL; // couldn't allocate
 }
@@ -721,6 +1402,9 @@ void Cache_Flush(void)
 {
     while (cache_head.next != &cache_head)
         Cache_Free(cache_head.next->user); // reclaim the space
+
+    // give the pages back until something is cached again
+    Sys_ReleaseMemory(hunk_base + hunk_low_used, hunk_size - hunk_low_used - hunk_high_used);
 }
 
 /*
@@ -750,6 +1434,34 @@ void Cache_Report(void)
     Con_DPrintf("%4.1f megabyte data cache\n", (hunk_size - hunk_high_used - hunk_low_used) / (float)(1024 * 1024));
 }
 
+/*
+============
+Cache_Stats_f
+
+Lists what each kind of data is using, so the budgets can be sized
+============
+*/
+static void Cache_Stats_f(void)
+{
+    int32_t i, gaps, gapbytes;
+    cachestats_t *st;
+    cache_system_t *cs;
+
+    Con_Printf("category     used KB  budget  entries pinned evicted reloaded\n");
+    for (i = 0, st = cache_stats; i < MEM_NUMCATEGORIES; i++, st++)
+        if (st->entries || st->evictions || cache_budgets[i])
+            Con_Printf("%-10s %9i %7i %8i %6i %7i %8i\n", mem_categorynames[i], st->used / 1024,
+                       cache_budgets[i] ? (int32_t)cache_budgets[i]->value : 0, st->entries, st->pinned,
+                       st->evictions, st->reloads);
+
+    gaps = gapbytes = 0;
+    for (i = 0; i < CACHE_GAPCLASSES; i++)
+        for (cs = cache_gaps[i]; cs; cs = cs->gap_next, gaps++)
+            gapbytes += (uint8_t *)cs->next - ((uint8_t *)cs + cs->size);
+    Con_Printf("%i KB free between entries in %i gaps, %i KB free in all\n", gapbytes / 1024, gaps,
+               (hunk_size - hunk_high_used - hunk_low_used - cache_used) / 1024);
+}
+
 /*
 ============
 Cache_Compact
@@ -770,8 +1482,14 @@ void Cache_Init(void)
 {
     cache_head.next = cache_head.prev = &cache_head;
     cache_head.lru_next = cache_head.lru_prev = &cache_head;
+    cache_head.gapclass = -1;
 
     Cmd_AddCommand("flush", Cache_Flush);
+    Cmd_AddCommand("cachestats", Cache_Stats_f);
+
+    Counter_Register("cache_evictions", &cache_evictcount, CNT_COUNT);
+    Counter_Register("cache_reloads", &cache_reloadcount, CNT_COUNT);
+    Counter_Register("cache_kb", &cache_usedkb, CNT_GAUGE);
 }
 
 /*
@@ -783,17 +1501,24 @@ Frees the memory and removes it from the LRU list
 */
 void Cache_Free(cache_user_t *c)
 {
-    cache_system_t *cs;
+    cache_system_t *cs, *prev;
 
     if (!c->data)
         Sys_Error("Cache_Free: not allocated");
 
     cs = ((cache_system_t *)c->data) - 1;
 
+    Cache_Account(cs, -1);
+
+    Cache_UnindexGap(cs);
+
+    prev = cs->prev;
     cs->prev->next = cs->next;
     cs->next->prev = cs->prev;
     cs->next = cs->prev = NULL;
 
+    Cache_IndexGap(prev);
+
     c->data = NULL;
 
     Cache_UnlinkLRU(cs);
@@ -820,12 +1545,40 @@ void *Cache_Check(cache_user_t *c)
     return c->data;
 }
 
+/*
+==============
+Cache_EvictCategory
+
+Throws out the least recently used entries of one kind until size more
+bytes fit in its budget.  Pinned entries only go if that isn't enough.
+==============
+*/
+static void Cache_EvictCategory(memcat_t category, int32_t size, char *name)
+{
+    cache_system_t *cs, *prev;
+    int32_t budget, pass;
+
+    if (!cache_budgets[category] || cache_budgets[category]->value <= 0)
+        return;
+
+    budget = cache_budgets[category]->value * 1024;
+    for (pass = 0; pass < 2; pass++)
+    {
+        for (cs = cache_head.lru_prev; cs != &cache_head && cache_stats[category].used + size > budget; cs = prev)
+        {
+            prev = cs->lru_prev;
+            if (cs->category == category && (pass || !cs->pinned))
+                Cache_Evict(cs, name);
+        }
+    }
+}
+
 /*
 ==============
 Cache_Alloc
 ==============
 */
-void *Cache_Alloc(cache_user_t *c, int32_t size, char *name)
+void *Cache_Alloc(cache_user_t *c, int32_t size, char *name, memcat_t category)
 {
     cache_system_t *cs;
 
@@ -837,6 +1590,8 @@ void *Cache_Alloc(cache_user_t *c, int32_t size, char *name)
 
     size = (size + sizeof(cache_system_t) + 15) & ~15;
 
+    Cache_EvictCategory(category, size, name);
+
     // find memory for it
     while (1)
     {
@@ -846,21 +1601,164 @@ void *Cache_Alloc(cache_user_t *c, int32_t size, char *name)
             strncpy(cs->name, name, sizeof(cs->name) - 1);
             c->data = (void *)(cs + 1);
             cs->user = c;
+            cs->category = category;
             break;
         }
 
-        // free the least recently used cahedat
-        if (cache_head.lru_prev == &cache_head)
+        // free the least recently used cahedat, keeping pinned entries
+        // for as long as there is anything else
+        for (cs = cache_head.lru_prev; cs != &cache_head && cs->pinned; cs = cs->lru_prev)
+            ;
+        if (cs == &cache_head)
+            cs = cache_head.lru_prev;
+        if (cs == &cache_head)
             Sys_Error("Cache_Alloc: out of memory");
         // not enough memory at all
-        Cache_Free(cache_head.lru_prev->user);
+        Cache_Evict(cs, name);
+    }
+
+    if (c->evictions)
+    {
+        // this has been thrown out before and is being loaded again
+        cache_stats[category].reloads++;
+        cache_reloadcount++;
+        if (cache_autopin.value > 0 && c->evictions >= cache_autopin.value)
+            cs->pinned = true;
     }
 
+    Cache_Account(cs, 1);
+
+    Prof_Mark("cache", "%s %d", name, size);
+
     return Cache_Check(c);
 }
 
 //============================================================================
 
+static cvar_t mem_report = {"mem_report", "1"}; // 1 = a line after each map load, 2 = every category
+static cvar_t mem_log = {"mem_log", "0"};       // append every map load report to memory.log
+
+static int32_t mem_lastmap[2][MEM_NUMCATEGORIES]; // after the last server and client map loads
+
+/*
+========================
+Memory_BeginMap
+
+Starts the peaks over from what is in use now
+========================
+*/
+void Memory_BeginMap(void)
+{
+    int32_t i;
+
+    for (i = 0; i < MEM_NUMCATEGORIES; i++)
+        mem_peak[i] = mem_hunk[i] + mem_cache[i] + mem_zone[i];
+    mem_totalpeak = mem_total;
+    mem_category = MEM_MISC; // in case a Host_Error left a loader's set
+}
+
+/*
+========================
+Memory_PrintTable
+========================
+*/
+static void Memory_PrintTable(FILE *f, int32_t *last)
+{
+    int32_t i, now;
+    char line[128];
+
+    snprintf(line, sizeof(line), "category     hunk KB cache KB  zone KB  peak KB  change KB\n");
+    f ? (void)fputs(line, f) : Con_Printf("%s", line);
+
+    for (i = 0; i < MEM_NUMCATEGORIES; i++)
+    {
+        now = mem_hunk[i] + mem_cache[i] + mem_zone[i];
+        if (!now && !mem_peak[i] && !(last && last[i]))
+            continue;
+
+        snprintf(line, sizeof(line), "%-10s %9i %8i %8i %8i %+10i\n", mem_categorynames[i], mem_hunk[i] / 1024,
+                 mem_cache[i] / 1024, mem_zone[i] / 1024, mem_peak[i] / 1024, last ? (now - last[i]) / 1024 : 0);
+        f ? (void)fputs(line, f) : Con_Printf("%s", line);
+    }
+}
+
+/*
+========================
+Memory_MapReport
+
+Called once a map is loaded.  The change from the last map load on the
+same side shows memory that wasn't given back.
+========================
+*/
+void Memory_MapReport(bool client, char *mapname)
+{
+    int32_t i, last, now;
+    int32_t *prev;
+    FILE *f;
+    char name[MAX_OSPATH];
+
+    prev = mem_lastmap[client];
+    for (i = 0, last = 0; i < MEM_NUMCATEGORIES; i++)
+        last += prev[i];
+
+    if (mem_report.value >= 2)
+    {
+        Con_Printf("memory after %s loaded %s:\n", client ? "client" : "server", mapname);
+        Memory_PrintTable(NULL, prev);
+    }
+    else if (mem_report.value)
+        Con_Printf("%s memory: %i KB, peak %i KB, %+i KB since the last map\n", mapname, mem_total / 1024,
+                   mem_totalpeak / 1024, (mem_total - last) / 1024);
+
+    if (mem_log.value)
+    {
+        snprintf(name, sizeof(name), "%s/memory.log", com_gamedir);
+        f = fopen(name, "a");
+        if (f)
+        {
+            fprintf(f, "%s %s: %i KB, peak %i KB, %i KB hunk free\n", client ? "client" : "server", mapname,
+                    mem_total / 1024, mem_totalpeak / 1024, (hunk_size - hunk_low_used - hunk_high_used) / 1024);
+            Memory_PrintTable(f, prev);
+            fclose(f);
+        }
+    }
+
+    for (i = 0; i < MEM_NUMCATEGORIES; i++)
+    {
+        now = mem_hunk[i] + mem_cache[i] + mem_zone[i];
+        prev[i] = now;
+    }
+}
+
+/*
+========================
+Memory_Stats_f
+========================
+*/
+static void Memory_Stats_f(void)
+{
+    Memory_PrintTable(NULL, NULL);
+    Con_Printf("%i KB in use, peak %i KB since the map began, %i KB of the hunk free\n", mem_total / 1024,
+               mem_totalpeak / 1024, (hunk_size - hunk_low_used - hunk_high_used) / 1024);
+}
+
+/*
+========================
+Memory_InitCvars
+
+The cvars need the zone, which comes after the hunk and cache
+========================
+*/
+static void Memory_InitCvars(void)
+{
+    Cvar_RegisterVariable(&cache_budget_models);
+    Cvar_RegisterVariable(&cache_budget_sounds);
+    Cvar_RegisterVariable(&cache_budget_pics);
+    Cvar_RegisterVariable(&cache_autopin);
+    Cvar_RegisterVariable(&mem_report);
+    Cvar_RegisterVariable(&mem_log);
+}
+
 /*
 ========================
 Memory_Init
@@ -885,6 +1783,15 @@ void Memory_Init(void *buf, int32_t size)
         else
             Sys_Error("Memory_Init: you must specify a size in KB after -zone");
     }
-    mainzone = Hunk_AllocName(zonesize, "zone");
-    Z_ClearZone(mainzone, zonesize);
+    // the zone's blocks are counted rather than its arena
+    mem_category = MEM_NUMCATEGORIES;
+    Z_ClearZone(&mainzone, Hunk_AllocName(zonesize, "zone"), zonesize);
+    mem_category = MEM_MISC;
+    zone_growsize = zonesize;
+    zone_check = COM_CheckParm("-zonecheck") != 0;
+
+    Memory_InitCvars();
+
+    Cmd_AddCommand("zone", Z_Print_f);
+    Cmd_AddCommand("memstats", Memory_Stats_f);
 }
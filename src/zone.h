@@ -3,7 +3,10 @@
 
 
 H_??? The hunk manages the entire memory block given to quake.  It must be
-contiguous.  Memory can be allocated from either the low or high end in a
+contiguous.  It is reserved address space (256 megs, -mem <megs> to change
+it, -hugepages to ask for transparent huge pages) that only takes real
+memory as it is touched, and large stretches freed back to a mark are
+returned to the system.  Memory can be allocated from either the low or high end in a
 stack fashion.  The only way memory is released is by resetting one of the
 pointers.
 
@@ -17,8 +20,10 @@ server allocations when changing to a higher video mode.
 
 
 Z_??? Zone memory functions used for small, dynamic allocations like text
-strings from command input.  There is only about 48K for it, allocated at
-the very bottom of the hunk.
+strings from command input.  It starts as 48K (-zone to change it) at the
+very bottom of the hunk, and mallocs more whenever that runs out.  The zone
+command prints its usage, high water mark and fragmentation, zone all lists
+every block, and -zonecheck checks the whole heap on every allocation.
 
 Cache_??? Cache memory is for objects that can be dynamically loaded and
 can usefully stay persistant between levels.  The size of the cache
@@ -26,6 +31,10 @@ fluctuates from level to level.
 
 To allocate a cachable object
 
+Free space between cache objects is filed by size, so finding room doesn't
+walk every object.  cachestats lists each category's use, evictions and
+reloads.
+
 
 Temp_??? Temp memory is used for file loading and surface caching.  The size
 of the cache memory is adjusted so that there is a minimum of 512k remaining
@@ -81,17 +90,58 @@ void *Hunk_HighAllocName(int32_t size, char *name);
 
 int32_t Hunk_LowMark(void);
 void Hunk_FreeToLowMark(int32_t mark);
+void *Hunk_MarkPointer(int32_t mark);
 
 int32_t Hunk_HighMark(void);
 void Hunk_FreeToHighMark(int32_t mark);
 
 void *Hunk_TempAlloc(int32_t size);
 
+void Hunk_BeginRetained(void);
+void Hunk_EndRetained(void);
+// low hunk allocations made in between come from a retained tier that
+// survives Hunk_FreeToLowMark, for assets that every map uses.  Marks can't
+// be used in between.
+void Hunk_AbortRetained(void);
+// after an error, drops a retained load that never reached Hunk_EndRetained
+void Hunk_FlushRetained(void);
+int32_t Hunk_RetainedSize(void);
+
 void Hunk_Check(void);
 
+typedef enum
+{
+    MEM_MISC,
+    MEM_MODELS, // alias and sprite models
+    MEM_SOUNDS,
+    MEM_PICS,
+    MEM_WORLD, // brush model geometry, visibility and entities
+    MEM_TEXTURES,
+    MEM_LIGHTING,
+    MEM_EDICTS,
+    MEM_PROGS,
+    MEM_RENDER, // video buffers and renderer tables
+    MEM_TEMP,
+    MEM_NUMCATEGORIES
+} memcat_t;
+
+extern memcat_t mem_category;
+
+memcat_t Memory_SetCategory(memcat_t category);
+// hunk and zone allocations are counted against the category until it is
+// set again, returns the previous one so a loader can put it back
+
+void Memory_BeginMap(void);
+void Memory_MapReport(bool client, char *mapname);
+// the peak of each category is kept from Memory_BeginMap, and
+// Memory_MapReport prints (mem_report) and logs (mem_log) what loading a
+// map cost and how it compares with the last map.  memstats prints it
+// whenever.
+
 typedef struct cache_user_s
 {
     void *data;
+    int32_t evictions; // times the data was thrown out to make room
 } cache_user_t;
 
 void Cache_Flush(void);
@@ -102,8 +152,10 @@ void *Cache_Check(cache_user_t *c);
 
 void Cache_Free(cache_user_t *c);
 
-void *Cache_Alloc(cache_user_t *c, int32_t size, char *name);
+void *Cache_Alloc(cache_user_t *c, int32_t size, char *name, memcat_t category);
 // Returns NULL if all purgable data was tossed and there still
-// wasn't enough room.
+// wasn't enough room.  A cache_budget_<category> cvar (in KB) makes the
+// category throw out its own entries before anyone else's, and an entry that
+// has been evicted cache_autopin times is pinned when it is loaded again.
 
 void Cache_Report(void);